@@ -0,0 +1,245 @@
+/** @file altitude.c
+ *  @brief Implementation of altitude.h
+ *
+ *  The aggregation kernels work on ALTITUDE_LANES independent accumulators
+ *  with branch-free selects, so the compiler can map each block onto SIMD
+ *  registers without needing -ffast-math to reorder the reductions.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include "altitude.h"
+#include "emalloc.h"
+
+/**
+ * @brief Converts a yaml altitude value such as '17.0' into a float.
+ *
+ * @param value The raw value text, optionally wrapped in single or double quotes.
+ * @param valid Set to 1 if the value was a finite number, 0 otherwise.
+ * @return float The parsed altitude, or 0 if the value is invalid.
+ *
+ */
+float parse_altitude(const char *value, int *valid) {
+    char *end;
+    char quote = '\0';
+
+    // Skip leading spaces and an opening quote
+    while (*value == ' ') value++;
+    if (*value == '\'' || *value == '"') {
+        quote = *value++;
+    }
+
+    // Convert the number itself
+    float result = strtof(value, &end);
+    if (end == value) {
+        *valid = 0;
+        return 0.0f;
+    }
+
+    // Allow the matching closing quote and trailing whitespace, nothing else
+    if (quote != '\0' && *end == quote) end++;
+    while (*end == ' ' || *end == '\r' || *end == '\n') end++;
+
+    if (*end != '\0' || !isfinite(result)) {
+        *valid = 0;
+        return 0.0f;
+    }
+    *valid = 1;
+    return result;
+}
+
+/**
+ * @brief Initializes an empty set of altitude columns.
+ *
+ * @param cols The columns to initialize.
+ * @return void: nothing
+ *
+ */
+void altitude_columns_init(altitude_columns *cols) {
+    memset(cols, 0, sizeof(altitude_columns));
+}
+
+/**
+ * @brief Grows one column to a new capacity, keeping its contents.
+ *
+ * @param column The column to grow.
+ * @param old_size The number of bytes currently in use.
+ * @param new_size The number of bytes to allocate.
+ * @return void*: the grown column
+ *
+ */
+static void *grow_column(void *column, size_t old_size, size_t new_size) {
+    void *grown = emalloc(new_size);
+    if (column != NULL) {
+        memcpy(grown, column, old_size);
+        free(column);
+    }
+    return grown;
+}
+
+/**
+ * @brief Appends the altitudes of one record to the columns.
+ *
+ * @param cols The columns to append to.
+ * @param from_altitude The origin airport altitude.
+ * @param to_altitude The destination airport altitude.
+ * @param altitude_flags The FROM_ALTITUDE_VALID / TO_ALTITUDE_VALID bits of the record.
+ * @return void: nothing
+ *
+ */
+void altitude_columns_append(altitude_columns *cols, float from_altitude, float to_altitude, int altitude_flags) {
+    // Double the capacity of every column when they are full
+    if (cols->size == cols->capacity) {
+        int capacity = cols->capacity == 0 ? 64 : cols->capacity * 2;
+        cols->from_altitude = grow_column(cols->from_altitude, cols->size * sizeof(float), capacity * sizeof(float));
+        cols->to_altitude = grow_column(cols->to_altitude, cols->size * sizeof(float), capacity * sizeof(float));
+        cols->from_valid = grow_column(cols->from_valid, cols->size, capacity);
+        cols->to_valid = grow_column(cols->to_valid, cols->size, capacity);
+        cols->capacity = capacity;
+    }
+
+    cols->from_altitude[cols->size] = from_altitude;
+    cols->to_altitude[cols->size] = to_altitude;
+    cols->from_valid[cols->size] = (altitude_flags & FROM_ALTITUDE_VALID) != 0;
+    cols->to_valid[cols->size] = (altitude_flags & TO_ALTITUDE_VALID) != 0;
+    cols->size++;
+}
+
+/**
+ * @brief Frees the memory held by the columns.
+ *
+ * @param cols The columns to free.
+ * @return void: nothing
+ *
+ */
+void altitude_columns_free(altitude_columns *cols) {
+    free(cols->from_altitude);
+    free(cols->to_altitude);
+    free(cols->from_valid);
+    free(cols->to_valid);
+    altitude_columns_init(cols);
+}
+
+/**
+ * @brief Computes min, max, mean and a histogram over one contiguous group of a column.
+ *
+ * @param values The first value of the group.
+ * @param valid The validity flag of the first value of the group.
+ * @param count The number of records in the group.
+ * @param stats The aggregates of the group.
+ * @return void: nothing
+ *
+ */
+void altitude_group_stats(const float *values, const unsigned char *valid, int count, altitude_stats *stats) {
+    float lane_min[ALTITUDE_LANES];
+    float lane_max[ALTITUDE_LANES];
+    double lane_sum[ALTITUDE_LANES];
+    int lane_count[ALTITUDE_LANES];
+    int histogram[ALTITUDE_BUCKETS + 1]; // The extra bucket collects invalid values
+    int i = 0;
+
+    for (int j = 0; j < ALTITUDE_LANES; j++) {
+        lane_min[j] = FLT_MAX;
+        lane_max[j] = -FLT_MAX;
+        lane_sum[j] = 0.0;
+        lane_count[j] = 0;
+    }
+    memset(histogram, 0, sizeof(histogram));
+
+    // Main loop: one block of ALTITUDE_LANES values per iteration, no branches
+    for (; i + ALTITUDE_LANES <= count; i += ALTITUDE_LANES) {
+        int bucket[ALTITUDE_LANES];
+        for (int j = 0; j < ALTITUDE_LANES; j++) {
+            float v = values[i + j];
+            int ok = valid[i + j];
+            float lo = ok ? v : FLT_MAX;
+            float hi = ok ? v : -FLT_MAX;
+            float scaled = v / ALTITUDE_BUCKET_WIDTH;
+
+            lane_min[j] = lo < lane_min[j] ? lo : lane_min[j];
+            lane_max[j] = hi > lane_max[j] ? hi : lane_max[j];
+            lane_sum[j] += ok ? v : 0.0f;
+            lane_count[j] += ok;
+
+            // Clamp the bucket before converting, sending invalid values to the extra bucket
+            scaled = scaled < 0.0f ? 0.0f : scaled;
+            scaled = scaled > ALTITUDE_BUCKETS - 1 ? ALTITUDE_BUCKETS - 1 : scaled;
+            bucket[j] = ok ? (int)scaled : ALTITUDE_BUCKETS;
+        }
+        for (int j = 0; j < ALTITUDE_LANES; j++) {
+            histogram[bucket[j]]++;
+        }
+    }
+
+    // Tail: the remaining values go through lane 0
+    for (; i < count; i++) {
+        if (!valid[i]) {
+            histogram[ALTITUDE_BUCKETS]++;
+            continue;
+        }
+        float scaled = values[i] / ALTITUDE_BUCKET_WIDTH;
+        scaled = scaled < 0.0f ? 0.0f : scaled;
+        scaled = scaled > ALTITUDE_BUCKETS - 1 ? ALTITUDE_BUCKETS - 1 : scaled;
+        histogram[(int)scaled]++;
+
+        lane_min[0] = values[i] < lane_min[0] ? values[i] : lane_min[0];
+        lane_max[0] = values[i] > lane_max[0] ? values[i] : lane_max[0];
+        lane_sum[0] += values[i];
+        lane_count[0]++;
+    }
+
+    // Reduce the lanes into the final aggregates
+    double sum = 0.0;
+    stats->min = FLT_MAX;
+    stats->max = -FLT_MAX;
+    stats->count = 0;
+    for (int j = 0; j < ALTITUDE_LANES; j++) {
+        stats->min = lane_min[j] < stats->min ? lane_min[j] : stats->min;
+        stats->max = lane_max[j] > stats->max ? lane_max[j] : stats->max;
+        sum += lane_sum[j];
+        stats->count += lane_count[j];
+    }
+    stats->invalid = histogram[ALTITUDE_BUCKETS];
+    memcpy(stats->buckets, histogram, sizeof(stats->buckets));
+
+    // A group without valid values has no meaningful min, max or mean
+    if (stats->count == 0) {
+        stats->min = 0.0f;
+        stats->max = 0.0f;
+        stats->mean = 0.0f;
+    } else {
+        stats->mean = (float)(sum / stats->count);
+    }
+}
+/**
+ * @brief Combines the aggregates of the same group computed over two disjoint sets of records.
+ *
+ * @param into The aggregates to update.
+ * @param from The aggregates to add into them.
+ * @return void: nothing
+ *
+ */
+void altitude_stats_merge(altitude_stats *into, const altitude_stats *from) {
+    int count = into->count + from->count;
+
+    // min, max and mean only describe valid values, so empty sides are skipped
+    if (from->count > 0) {
+        if (into->count == 0) {
+            into->min = from->min;
+            into->max = from->max;
+        } else {
+            into->min = from->min < into->min ? from->min : into->min;
+            into->max = from->max > into->max ? from->max : into->max;
+        }
+        into->mean = (float)(((double)into->mean * into->count + (double)from->mean * from->count) / count);
+    }
+    into->count = count;
+    into->invalid += from->invalid;
+
+    for (int b = 0; b < ALTITUDE_BUCKETS; b++) {
+        into->buckets[b] += from->buckets[b];
+    }
+}
\ No newline at end of file
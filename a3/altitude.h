@@ -0,0 +1,52 @@
+/** @file altitude.h
+ *  @brief Packed numeric altitude columns and per-group aggregation kernels.
+ *
+ */
+#ifndef ALTITUDE_H
+#define ALTITUDE_H
+
+#define ALTITUDE_BUCKETS 8            // Number of histogram buckets
+#define ALTITUDE_BUCKET_WIDTH 1000.0f // Width of each histogram bucket (feet)
+#define ALTITUDE_LANES 8              // Accumulator lanes used by the vectorized kernels
+
+// Bits of Route.altitude_flags, set when the altitude value parsed cleanly
+#define FROM_ALTITUDE_VALID 0x1
+#define TO_ALTITUDE_VALID 0x2
+
+/**
+ * @brief Struct holding the altitudes of many routes as packed, contiguous columns.
+ */
+typedef struct {
+    float *from_altitude;          // Origin airport altitude of each record
+    float *to_altitude;            // Destination airport altitude of each record
+    unsigned char *from_valid;     // 1 if from_altitude[i] is a real value, 0 otherwise
+    unsigned char *to_valid;       // 1 if to_altitude[i] is a real value, 0 otherwise
+    int size;                      // Number of records stored
+    int capacity;                  // Number of records allocated
+} altitude_columns;
+
+/**
+ * @brief Struct representing the numeric aggregates of one group of altitudes.
+ */
+typedef struct {
+    float min;
+    float max;
+    float mean;
+    int count;                          // Number of valid values in the group
+    int invalid;                        // Number of values that could not be parsed
+    int buckets[ALTITUDE_BUCKETS];      // Histogram of valid values
+} altitude_stats;
+
+/**
+ * Function protypes associated with altitude columns.
+ */
+float parse_altitude(const char *value, int *valid);
+
+void altitude_columns_init(altitude_columns *cols);
+void altitude_columns_append(altitude_columns *cols, float from_altitude, float to_altitude, int altitude_flags);
+void altitude_columns_free(altitude_columns *cols);
+
+void altitude_group_stats(const float *values, const unsigned char *valid, int count, altitude_stats *stats);
+void altitude_stats_merge(altitude_stats *into, const altitude_stats *from);
+
+#endif // ALTITUDE_H
\ No newline at end of file
@@ -0,0 +1,221 @@
+/** @file cache.c
+ *  @brief Implementation of cache.h
+ *
+ *  Each query over a list of input files has one entry file, named by a
+ *  hash of the query and the file names. The entry starts with the size,
+ *  modification time and content hash of every input file, followed by
+ *  the output.csv the query produced. An entry is only used if the sizes
+ *  and times still match, and only then are the files re-hashed to make
+ *  sure the contents match too. A result for n rows also answers every
+ *  smaller n, since the rows are already in rank order.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "cache.h"
+#include "emalloc.h"
+
+#define CACHE_MAGIC "route_manager cache 1"
+#define CACHE_LINE 4352         // Longest header line: a path plus its size and time
+
+/**
+ * @brief Adds bytes to a 64-bit FNV-1a hash.
+ *
+ */
+static unsigned long long hash_bytes(unsigned long long hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Hashes the contents of every input file.
+ *
+ * @param data_files The input files.
+ * @param hash Set to the hash.
+ * @return int 1 if every file could be read, 0 otherwise.
+ *
+ */
+static int hash_contents(glob_t *data_files, unsigned long long *hash) {
+    char *buffer = (char *)emalloc(1 << 16);
+    size_t got;
+
+    *hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < data_files->gl_pathc; i++) {
+        FILE *file = fopen(data_files->gl_pathv[i], "rb");
+        if (file == NULL) {
+            free(buffer);
+            return 0;
+        }
+        while ((got = fread(buffer, 1, 1 << 16, file)) > 0) {
+            *hash = hash_bytes(*hash, buffer, got);
+        }
+        fclose(file);
+    }
+    free(buffer);
+    return 1;
+}
+
+/**
+ * @brief Names the cache entry of a query over a list of input files and makes sure the cache
+ *        directory exists.
+ *
+ * @param entry The entry to initialize.
+ * @param directory The cache directory.
+ * @param query The query parameters apart from n, such as "question=1".
+ * @param data_files The input files.
+ * @param n The number of rows asked for, or CACHE_ALL_ROWS.
+ * @return void: nothing
+ *
+ */
+void cache_entry_init(cache_entry *entry, const char *directory, const char *query, glob_t *data_files, int n) {
+    unsigned long long name = 14695981039346656037ULL;
+
+    strncpy(entry->query, query, sizeof(entry->query) - 1);
+    entry->query[sizeof(entry->query) - 1] = '\0';
+    entry->data_files = data_files;
+    entry->n = n;
+
+    // The entry is named by the query and the file names; the file contents are checked on load
+    name = hash_bytes(name, entry->query, strlen(entry->query) + 1);
+    for (size_t i = 0; i < data_files->gl_pathc; i++) {
+        name = hash_bytes(name, data_files->gl_pathv[i], strlen(data_files->gl_pathv[i]) + 1);
+    }
+    mkdir(directory, 0777);
+    snprintf(entry->path, sizeof(entry->path), "%s/%016llx.csv", directory, name);
+}
+
+/**
+ * @brief Reads one header line, dropping its newline.
+ *
+ */
+static int read_header_line(FILE *file, char *line) {
+    if (fgets(line, CACHE_LINE, file) == NULL) {
+        return 0;
+    }
+    line[strcspn(line, "\n")] = '\0';
+    return 1;
+}
+
+/**
+ * @brief Writes the cached result of a query to the output file, if the cache holds a result that is
+ *        still valid for the current input files and has at least the rows asked for.
+ *
+ * @param entry The cache entry of the query.
+ * @param output The output file to write, such as "output.csv".
+ * @return int 1 if the output was written from the cache, 0 if the query has to be run.
+ *
+ */
+int cache_load(cache_entry *entry, const char *output) {
+    char *line = (char *)emalloc(CACHE_LINE);
+    char *expected = (char *)emalloc(CACHE_LINE);
+    int hit = 0;
+    int stored_n;
+    unsigned long long stored_hash, hash;
+    struct stat st;
+
+    FILE *file = fopen(entry->path, "r");
+    if (file == NULL) {
+        free(line);
+        free(expected);
+        return 0;
+    }
+
+    // The entry must be for this query and these files, unchanged in size and time
+    if (!read_header_line(file, line) || strcmp(line, CACHE_MAGIC) != 0) goto done;
+    if (!read_header_line(file, line) || strncmp(line, "query ", 6) != 0 || strcmp(line + 6, entry->query) != 0) goto done;
+    if (!read_header_line(file, line) || sscanf(line, "n %d", &stored_n) != 1) goto done;
+    for (size_t i = 0; i < entry->data_files->gl_pathc; i++) {
+        if (stat(entry->data_files->gl_pathv[i], &st) != 0) goto done;
+        snprintf(expected, CACHE_LINE, "file %lld %lld %ld %s", (long long)st.st_size, (long long)st.st_mtim.tv_sec,
+                 st.st_mtim.tv_nsec, entry->data_files->gl_pathv[i]);
+        if (!read_header_line(file, line) || strcmp(line, expected) != 0) goto done;
+    }
+
+    // Sizes and times can match after an edit, so the contents decide
+    if (!read_header_line(file, line) || sscanf(line, "hash %llx", &stored_hash) != 1) goto done;
+    if (!hash_contents(entry->data_files, &hash) || hash != stored_hash) goto done;
+
+    // Read the stored csv: one header line, then the rows in rank order
+    long start = ftell(file);
+    int rows = -1;
+    while (fgets(line, CACHE_LINE, file) != NULL) {
+        if (strchr(line, '\n') != NULL) rows++;
+    }
+
+    // A stored result answers any n up to its own, or any n at all if it has fewer rows than it asked for
+    int complete = (stored_n == CACHE_ALL_ROWS) || (rows < stored_n);
+    if (!complete && (entry->n == CACHE_ALL_ROWS || entry->n > stored_n)) goto done;
+
+    FILE *out = fopen(output, "w");
+    if (out == NULL) goto done;
+    fseek(file, start, SEEK_SET);
+    int limit = (entry->n == CACHE_ALL_ROWS) ? rows : entry->n;
+    for (int written = -1; written < limit && fgets(line, CACHE_LINE, file) != NULL; ) {
+        fputs(line, out);
+        if (strchr(line, '\n') != NULL) written++;
+    }
+    fclose(out);
+    hit = 1;
+
+done:
+    fclose(file);
+    free(line);
+    free(expected);
+    return hit;
+}
+
+/**
+ * @brief Stores the output file of a query in its cache entry, replacing any older result.
+ *
+ * @param entry The cache entry of the query.
+ * @param output The output file the query wrote, such as "output.csv".
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int cache_store(cache_entry *entry, const char *output) {
+    char temp_path[sizeof(entry->path) + 32];
+    unsigned long long hash;
+    struct stat st;
+    char buffer[4096];
+    size_t got;
+
+    FILE *in = fopen(output, "r");
+    if (in == NULL || !hash_contents(entry->data_files, &hash)) {
+        if (in != NULL) fclose(in);
+        return 1;
+    }
+
+    // Write to a temporary file first, so a reader never sees half an entry
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld.tmp", entry->path, (long)getpid());
+    FILE *file = fopen(temp_path, "w");
+    if (file == NULL) {
+        fclose(in);
+        return 1;
+    }
+    fprintf(file, "%s\nquery %s\nn %d\n", CACHE_MAGIC, entry->query, entry->n);
+    for (size_t i = 0; i < entry->data_files->gl_pathc; i++) {
+        if (stat(entry->data_files->gl_pathv[i], &st) != 0) {
+            memset(&st, 0, sizeof(st));
+        }
+        fprintf(file, "file %lld %lld %ld %s\n", (long long)st.st_size, (long long)st.st_mtim.tv_sec,
+                st.st_mtim.tv_nsec, entry->data_files->gl_pathv[i]);
+    }
+    fprintf(file, "hash %016llx\n", hash);
+    while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        fwrite(buffer, 1, got, file);
+    }
+    fclose(in);
+
+    if (fclose(file) != 0 || rename(temp_path, entry->path) != 0) {
+        remove(temp_path);
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
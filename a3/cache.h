@@ -0,0 +1,29 @@
+/** @file cache.h
+ *  @brief On-disk cache of query results keyed by the query and a fingerprint of its input files.
+ *
+ */
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <glob.h>
+
+#define CACHE_ALL_ROWS -1   // The n of a result that is not cut off, such as a full pivot matrix
+
+/**
+ * @brief Struct representing the cache entry of one query over one list of input files.
+ */
+typedef struct {
+    char path[4096];        // The entry file inside the cache directory
+    char query[1536];       // The query parameters, apart from n, with the --WHERE= predicates
+    glob_t *data_files;
+    int n;                  // The number of rows asked for, or CACHE_ALL_ROWS
+} cache_entry;
+
+/**
+ * Function protypes associated with the result cache.
+ */
+void cache_entry_init(cache_entry *entry, const char *directory, const char *query, glob_t *data_files, int n);
+int cache_load(cache_entry *entry, const char *output);
+int cache_store(cache_entry *entry, const char *output);
+
+#endif // CACHE_H
\ No newline at end of file
@@ -0,0 +1,288 @@
+/** @file concurrent_map.c
+ *  @brief Implementation of concurrent_map.h
+ *
+ *  A key is inserted by building its entry privately and publishing it into
+ *  the first empty slot of its probe sequence with compare-and-swap. A
+ *  thread that loses the race compares keys with the winner and, if they
+ *  match, frees its own entry. Counts are only ever changed with atomic
+ *  fetch-add, so no lock is taken on either path.
+ *
+ *  When a table is half full, one thread publishes a larger table as its
+ *  successor and walks the old one, freezing every empty slot with MOVED
+ *  and copying every entry pointer across. Slots only ever fill, so a key
+ *  already in the old table is found there before any frozen slot of its
+ *  probe sequence; a key that meets a frozen slot is not in the old table
+ *  and goes on to the larger one. Only the thread replacing a table takes
+ *  a lock.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "concurrent_map.h"
+#include "hugemem.h"
+
+static map_entry moved;     // Freezes an empty slot of a table being replaced
+#define MOVED (&moved)
+
+/**
+ * @brief Computes the FNV-1a hash of a string.
+ *
+ */
+static unsigned int hash_key(const char *str) {
+    unsigned int hash = 2166136261u;
+    while (*str != '\0') {
+        hash ^= (unsigned char)*str++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Creates a table with room for capacity entries, rounded up to a power of two.
+ *
+ */
+static map_table *table_try_create(size_t capacity) {
+    map_table *table = (map_table *)malloc(sizeof(map_table));
+    if (table == NULL) {
+        return NULL;
+    }
+
+    table->capacity = 64;
+    while (table->capacity < capacity) {
+        table->capacity *= 2;
+    }
+    table->slots = (map_entry **)hugemem_try_alloc(table->capacity * sizeof(map_entry *));
+    if (table->slots == NULL) {
+        free(table);
+        return NULL;
+    }
+    memset(table->slots, 0, table->capacity * sizeof(map_entry *));
+    table->next = NULL;
+    return table;
+}
+
+/**
+ * @brief Creates a map whose first table has room for twice the expected number of keys. More keys than
+ *        that still fit; the map grows as they arrive.
+ *
+ * @param expected_keys The number of distinct keys expected, or 0 for MAP_DEFAULT_KEYS.
+ * @return concurrent_map* The new map, or NULL if its memory could not be allocated.
+ *
+ */
+concurrent_map *concurrent_map_try_create(size_t expected_keys) {
+    concurrent_map *map = (concurrent_map *)malloc(sizeof(concurrent_map));
+    if (map == NULL) {
+        return NULL;
+    }
+
+    // Keep the load factor at or below one half
+    map->tables = table_try_create(2 * (expected_keys > MAP_DEFAULT_KEYS ? expected_keys : MAP_DEFAULT_KEYS));
+    if (map->tables == NULL) {
+        free(map);
+        return NULL;
+    }
+    map->current = map->tables;
+    map->size = 0;
+    pthread_mutex_init(&map->grow_lock, NULL);
+    return map;
+}
+
+/**
+ * @brief Replaces a table with one MAP_GROWTH times as large, unless another thread already has. Returns
+ *        once the entries have moved, with table->next set, or 0 if the larger table could not be allocated.
+ *
+ */
+static int map_grow(concurrent_map *map, map_table *table) {
+    int grown = 1;
+
+    pthread_mutex_lock(&map->grow_lock);
+    if (__atomic_load_n(&table->next, __ATOMIC_ACQUIRE) == NULL) {
+        map_table *larger = table_try_create(table->capacity * MAP_GROWTH);
+        if (larger == NULL) {
+            grown = 0;
+        } else {
+            // Publish the larger table first, so a key that meets a frozen slot has somewhere to go
+            __atomic_store_n(&table->next, larger, __ATOMIC_RELEASE);
+            size_t mask = larger->capacity - 1;
+            for (size_t i = 0; i < table->capacity; i++) {
+                map_entry *entry = NULL;
+                if (__atomic_compare_exchange_n(&table->slots[i], &entry, MOVED, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                    continue;
+                }
+                // The slot holds an entry: copy it into the first empty slot of its probe sequence
+                for (size_t j = entry->hash & mask;; j = (j + 1) & mask) {
+                    map_entry *empty = NULL;
+                    if (__atomic_compare_exchange_n(&larger->slots[j], &empty, entry, 0, __ATOMIC_ACQ_REL,
+                                                    __ATOMIC_ACQUIRE)) {
+                        break;
+                    }
+                }
+            }
+            __atomic_store_n(&map->current, larger, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&map->grow_lock);
+    return grown;
+}
+
+/**
+ * @brief Creates a map like concurrent_map_try_create, ending the program if it could not be allocated.
+ *
+ * @param expected_keys The number of distinct keys expected, or 0 for MAP_DEFAULT_KEYS.
+ * @return concurrent_map* The new map.
+ *
+ */
+concurrent_map *concurrent_map_create(size_t expected_keys) {
+    concurrent_map *map = concurrent_map_try_create(expected_keys);
+    if (map == NULL) {
+        fprintf(stderr, "Error: could not allocate a map of %zu keys\n", expected_keys);
+        exit(EXIT_FAILURE);
+    }
+    return map;
+}
+
+/**
+ * @brief Adds amount to the counter of key, inserting the key if it is new. Safe to call from many
+ *        threads at once.
+ *
+ * @param map The map.
+ * @param key The key to count.
+ * @param amount The amount to add.
+ * @param init Fills in the value of a new entry; may be NULL when value_size is 0.
+ * @param ctx Passed through to init.
+ * @param value_size The number of bytes of value stored with each entry.
+ * @return map_entry* The entry of key, or NULL if a new entry or table could not be allocated.
+ *
+ */
+map_entry *concurrent_map_add(concurrent_map *map, const char *key, int amount,
+                              void (*init)(void *value, const void *ctx), const void *ctx, size_t value_size) {
+    unsigned int hash = hash_key(key);
+    map_entry *mine = NULL;
+
+    for (map_table *table = __atomic_load_n(&map->current, __ATOMIC_ACQUIRE);;) {
+        size_t mask = table->capacity - 1;
+
+        for (size_t probe = 0, i = hash & mask; probe < table->capacity; probe++, i = (i + 1) & mask) {
+            map_entry *entry = __atomic_load_n(&table->slots[i], __ATOMIC_ACQUIRE);
+
+            if (entry == NULL) {
+                // Build the entry once, then try to publish it in this slot
+                if (mine == NULL) {
+                    size_t key_len = strlen(key) + 1;
+                    size_t offset = (key_len + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *);
+                    mine = (map_entry *)malloc(sizeof(map_entry) + offset + value_size);
+                    if (mine == NULL) {
+                        return NULL;
+                    }
+                    mine->hash = hash;
+                    mine->count = amount;
+                    mine->key = mine->data;
+                    mine->value = mine->data + offset;
+                    memcpy(mine->key, key, key_len);
+                    if (init != NULL) {
+                        init(mine->value, ctx);
+                    }
+                }
+                if (__atomic_compare_exchange_n(&table->slots[i], &entry, mine, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                    // Replace the table once it is half full; a table being replaced already has a successor
+                    size_t size = __atomic_add_fetch(&map->size, 1, __ATOMIC_RELAXED);
+                    if (2 * size > table->capacity && __atomic_load_n(&table->next, __ATOMIC_ACQUIRE) == NULL) {
+                        map_grow(map, table);
+                    }
+                    return mine;
+                }
+                // Another thread filled the slot first; entry now holds its entry
+            }
+
+            if (entry == MOVED) {
+                // The table is being replaced and the key is not in it
+                break;
+            }
+            if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+                free(mine);
+                __atomic_fetch_add(&entry->count, amount, __ATOMIC_RELAXED);
+                return entry;
+            }
+        }
+
+        // Go on to the table replacing this one, replacing it now if it is full and no thread has yet
+        map_table *next = __atomic_load_n(&table->next, __ATOMIC_ACQUIRE);
+        if (next == NULL) {
+            if (!map_grow(map, table)) {
+                free(mine);
+                return NULL;
+            }
+            next = __atomic_load_n(&table->next, __ATOMIC_ACQUIRE);
+        }
+        table = next;
+    }
+}
+
+/**
+ * @brief Collects the entries of the map. Only call once every writer has finished.
+ *
+ * @param map The map.
+ * @param count Set to the number of entries.
+ * @return map_entry** A new array of the entries, to be freed by the caller, or NULL if it could not be allocated.
+ *
+ */
+map_entry **concurrent_map_try_entries(concurrent_map *map, size_t *count) {
+    map_entry **entries = (map_entry **)malloc((map->size > 0 ? map->size : 1) * sizeof(map_entry *));
+    size_t n = 0;
+
+    if (entries == NULL) {
+        return NULL;
+    }
+    // Every entry has moved on to the newest table
+    map_table *table = map->current;
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->slots[i] != NULL) {
+            entries[n++] = table->slots[i];
+        }
+    }
+    *count = n;
+    return entries;
+}
+
+/**
+ * @brief Collects the entries of the map like concurrent_map_try_entries, ending the program if the array
+ *        could not be allocated.
+ *
+ * @param map The map.
+ * @param count Set to the number of entries.
+ * @return map_entry** A new array of the entries, to be freed by the caller.
+ *
+ */
+map_entry **concurrent_map_entries(concurrent_map *map, size_t *count) {
+    map_entry **entries = concurrent_map_try_entries(map, count);
+    if (entries == NULL) {
+        fprintf(stderr, "Error: could not allocate the entries of a map of %zu keys\n", map->size);
+        exit(EXIT_FAILURE);
+    }
+    return entries;
+}
+
+/**
+ * @brief Frees the map and every entry in it.
+ *
+ * @param map The map to free.
+ * @return void: nothing
+ *
+ */
+void concurrent_map_free(concurrent_map *map) {
+    for (size_t i = 0; i < map->current->capacity; i++) {
+        free(map->current->slots[i]);
+    }
+
+    // The replaced tables hold only copies of the pointers and MOVED
+    map_table *table = map->tables;
+    while (table != NULL) {
+        map_table *next = table->next;
+        hugemem_free(table->slots, table->capacity * sizeof(map_entry *));
+        free(table);
+        table = next;
+    }
+    pthread_mutex_destroy(&map->grow_lock);
+    free(map);
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+/** @file concurrent_map.h
+ *  @brief Lock-free open-addressing hash map of string keys to shared counters.
+ *
+ */
+#ifndef CONCURRENT_MAP_H
+#define CONCURRENT_MAP_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#define MAP_DEFAULT_KEYS 256    // Keys the first table has room for when the caller expects fewer or gives 0
+#define MAP_GROWTH 2            // How much larger each table is than the one it replaces
+
+/**
+ * @brief Struct representing one key of the map, its counter and its caller-defined value.
+ *        The key and value live in the same allocation as the struct.
+ */
+typedef struct {
+    unsigned int hash;
+    int count;          // Only updated with atomic fetch-add
+    char *key;
+    void *value;        // Filled in once, before the entry is published
+    char data[];
+} map_entry;
+
+/**
+ * @brief Struct representing one table of the map. Once half full it is replaced by a larger one: the
+ *        entries are moved over and the table's empty slots are frozen, so a key is never added to it again.
+ */
+typedef struct map_table {
+    map_entry **slots;          // Published with compare-and-swap; an entry is never removed
+    size_t capacity;            // A power of two
+    struct map_table *next;     // The table replacing this one, or NULL; published before the move starts
+} map_table;
+
+/**
+ * @brief Struct representing the map. It starts small and grows with the number of distinct keys, so its
+ *        memory follows the keys rather than the size of the input. Entries never move in memory.
+ */
+typedef struct {
+    map_table *current;         // The newest table, which holds every entry once no table is being replaced
+    map_table *tables;          // The first table; the others follow it through next
+    size_t size;                // Number of published entries, updated atomically
+    pthread_mutex_t grow_lock;  // Held while a table is replaced, so only one thread moves entries
+} concurrent_map;
+
+/**
+ * Function protypes associated with the concurrent map.
+ */
+concurrent_map *concurrent_map_try_create(size_t expected_keys);
+concurrent_map *concurrent_map_create(size_t expected_keys);
+map_entry *concurrent_map_add(concurrent_map *map, const char *key, int amount,
+                              void (*init)(void *value, const void *ctx), const void *ctx, size_t value_size);
+map_entry **concurrent_map_try_entries(concurrent_map *map, size_t *count);
+map_entry **concurrent_map_entries(concurrent_map *map, size_t *count);
+void concurrent_map_free(concurrent_map *map);
+
+#endif // CONCURRENT_MAP_H
\ No newline at end of file
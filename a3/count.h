@@ -1,34 +1,65 @@
-#ifndef COUNT_H
-#define COUNT_H
-
-#define BUFFER_SIZE 256
-
-/**
- * @brief Struct representing the count of airline routes for question 1.
- */
-typedef struct {
-    char airline_name[BUFFER_SIZE];           
-    char airline_icao_unique_code[BUFFER_SIZE]; 
-    int count; // The count of routes associated with the airline
-} Q1_count;
-
-/**
- * @brief Struct representing the count of destination countries for question 2.
- */
-typedef struct {
-    char to_airport_country[BUFFER_SIZE];     
-    int count; // The count of routes to the destination country
-} Q2_count;
-
-/**
- * @brief Struct representing the count of destination airports for question 3.
- */
-typedef struct {
-    char to_airport_name[BUFFER_SIZE];
-    char to_airport_icao_unique_code[BUFFER_SIZE]; 
-    char to_airport_city[BUFFER_SIZE];      
-    char to_airport_country[BUFFER_SIZE];     
-    int count; // The count of routes to the destination airport
-} Q3_count;
-
+#ifndef COUNT_H
+#define COUNT_H
+
+#include "altitude.h"
+
+#define BUFFER_SIZE 256
+
+/**
+ * @brief Tables of the route fields copied into the count of each question. The first field is the one
+ *        the routes are grouped by. The structs below and the code that fills them are generated from
+ *        these tables.
+ */
+#define Q1_COUNT_FIELDS(X) \
+    X(airline_name) \
+    X(airline_icao_unique_code)
+
+#define Q2_COUNT_FIELDS(X) \
+    X(to_airport_country)
+
+#define Q3_COUNT_FIELDS(X) \
+    X(to_airport_name) \
+    X(to_airport_icao_unique_code) \
+    X(to_airport_city) \
+    X(to_airport_country)
+
+#define COUNT_FIELD_MEMBER(name) char name[BUFFER_SIZE];
+
+/**
+ * @brief Copies every field of a count table from a route (or another count) into a count.
+ */
+#define COUNT_FIELD_COPY(name) \
+    strncpy(dst->name, src->name, sizeof(dst->name) - 1); \
+    dst->name[sizeof(dst->name) - 1] = '\0';
+
+/**
+ * @brief Struct representing the names of an airline counted for question 1. The count itself is kept
+ *        with the airline's key in the hot part of its count node.
+ */
+typedef struct {
+    Q1_COUNT_FIELDS(COUNT_FIELD_MEMBER)
+} Q1_count;
+
+/**
+ * @brief Struct representing the name of a destination country counted for question 2.
+ */
+typedef struct {
+    Q2_COUNT_FIELDS(COUNT_FIELD_MEMBER)
+} Q2_count;
+
+/**
+ * @brief Struct representing the names of a destination airport counted for question 3.
+ */
+typedef struct {
+    Q3_COUNT_FIELDS(COUNT_FIELD_MEMBER)
+} Q3_count;
+
+/**
+ * @brief Struct representing the destination altitude statistics of a country for question 4.
+ */
+typedef struct {
+    char to_airport_country[BUFFER_SIZE];
+    altitude_stats stats; // Min, max, mean and histogram of the destination altitudes
+} Q4_count;
+
 #endif // COUNT_H
\ No newline at end of file
@@ -0,0 +1,261 @@
+/** @file count_bench.c
+ *  @brief Cache-miss benchmark of the loops that update and rank the q3 count list.
+ *
+ *  Two partitions of the same airports, each in its own random order and
+ *  with its own counts, are aggregated the way q3 does it: every airport is
+ *  added to its partition's list with the sorted insert, the two lists are
+ *  merged, and the TOP airports are selected from the merged list. "inline"
+ *  runs these loops over the layout count nodes had before, with the count
+ *  and the 1 KB of names in one malloc'd node, and selects by walking the
+ *  list once per airport taken. "packed" runs the count list kernels over
+ *  32-byte nodes holding the count and leading key bytes, and selects from a
+ *  count table. The count, merge and output phases of the perf report give
+ *  the cache and TLB misses of the insert, merge and selection loops, or
+ *  their times when the hardware counters are unavailable.
+ *
+ *  Usage: ./count_bench inline|packed [GROUPS] [TOP]
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "count_list.h"
+#include "perf.h"
+#include "emalloc.h"
+
+/**
+ * @brief Struct representing a count node laid out as before the hot and cold split.
+ */
+typedef struct inline_node {
+    struct inline_node *next;
+    int count;
+    Q3_count names;
+} inline_node;
+
+/**
+ * @brief Fills in the names of airport id; the airports are spread over 200 countries.
+ *
+ */
+static void make_names(Q3_count *names, long id) {
+    memset(names, 0, sizeof(Q3_count));
+    snprintf(names->to_airport_name, BUFFER_SIZE, "Airport %06ld", id);
+    snprintf(names->to_airport_icao_unique_code, BUFFER_SIZE, "K%03ld", id % 1000);
+    snprintf(names->to_airport_city, BUFFER_SIZE, "City %ld", id);
+    snprintf(names->to_airport_country, BUFFER_SIZE, "Country %03ld", id % 200);
+}
+
+/**
+ * @brief Shuffles the ids of a partition into a random order.
+ *
+ */
+static void shuffle(long *ids, long count) {
+    for (long i = count - 1; i > 0; i--) {
+        long j = rand() % (i + 1);
+        long id = ids[i];
+        ids[i] = ids[j];
+        ids[j] = id;
+    }
+}
+
+/**
+ * @brief Adds a node to an inline list in q3 order, as the count lists did before the split.
+ *
+ */
+static inline_node *inline_add_inorder(inline_node *list, inline_node *new_node) {
+    inline_node *prev = NULL;
+    inline_node *curr = list;
+
+    while (curr != NULL && q3_count_compare(&new_node->names, &curr->names) > 0) {
+        prev = curr;
+        curr = curr->next;
+    }
+    new_node->next = curr;
+    if (prev == NULL) {
+        return new_node;
+    }
+    prev->next = new_node;
+    return list;
+}
+
+/**
+ * @brief Merges two inline lists, adding up the counts of the airports found in both.
+ *
+ */
+static inline_node *inline_merge(inline_node *a, inline_node *b) {
+    inline_node *merged = NULL;
+    inline_node **tail = &merged;
+
+    while (a != NULL && b != NULL) {
+        int cmp = q3_count_compare(&a->names, &b->names);
+        if (cmp == 0) {
+            inline_node *next = b->next;
+            a->count += b->count;
+            free(b);
+            b = next;
+            continue;
+        }
+        if (cmp < 0) {
+            *tail = a;
+            a = a->next;
+        } else {
+            *tail = b;
+            b = b->next;
+        }
+        tail = &(*tail)->next;
+    }
+    *tail = (a != NULL) ? a : b;
+    return merged;
+}
+
+/**
+ * @brief Selects the top airports of an inline list by walking it once per airport taken.
+ *
+ */
+static long inline_select(inline_node *head, int top) {
+    long checksum = 0;
+
+    for (int i = 0; i < top; i++) {
+        inline_node *best = NULL;
+        for (inline_node *node = head; node != NULL; node = node->next) {
+            if (node->count >= 0 && (best == NULL || node->count > best->count)) {
+                best = node;
+            }
+        }
+        if (best == NULL) {
+            break;
+        }
+        checksum = checksum * 31 + best->count + best->names.to_airport_name[13];
+        best->count = -1;
+    }
+    return checksum;
+}
+
+/**
+ * @brief Runs the three loops over the inline layout.
+ *
+ */
+static long run_inline(long *ids[2], int *counts[2], long groups, int top) {
+    inline_node *lists[2] = { NULL, NULL };
+    perf_mark mark;
+
+    perf_begin(&mark);
+    for (int p = 0; p < 2; p++) {
+        for (long i = 0; i < groups; i++) {
+            inline_node *node = (inline_node *)emalloc(sizeof(inline_node));
+            make_names(&node->names, ids[p][i]);
+            node->count = counts[p][i];
+            lists[p] = inline_add_inorder(lists[p], node);
+        }
+    }
+    perf_end(&mark, PERF_COUNT);
+
+    perf_begin(&mark);
+    inline_node *head = inline_merge(lists[0], lists[1]);
+    perf_end(&mark, PERF_MERGE);
+
+    perf_begin(&mark);
+    long checksum = inline_select(head, top);
+    perf_end(&mark, PERF_OUTPUT);
+
+    while (head != NULL) {
+        inline_node *next = head->next;
+        free(head);
+        head = next;
+    }
+    return checksum;
+}
+
+/**
+ * @brief Runs the three loops over the packed count list.
+ *
+ */
+static long run_packed(long *ids[2], int *counts[2], long groups, int top) {
+    q3_count_node *lists[2] = { NULL, NULL };
+    count_arena arenas[2];
+    perf_mark mark;
+    Q3_count names;
+
+    perf_begin(&mark);
+    for (int p = 0; p < 2; p++) {
+        count_arena_init(&arenas[p]);
+        for (long i = 0; i < groups; i++) {
+            make_names(&names, ids[p][i]);
+            lists[p] = q3_count_add_inorder(lists[p], q3_count_new_node(&arenas[p], &names, counts[p][i]));
+        }
+    }
+    perf_end(&mark, PERF_COUNT);
+
+    perf_begin(&mark);
+    q3_count_node *head = q3_count_merge(lists[0], lists[1]);
+    count_arena_join(&arenas[0], &arenas[1]);
+    perf_end(&mark, PERF_MERGE);
+
+    perf_begin(&mark);
+    long checksum = 0;
+    count_table table;
+    q3_count_table(head, &table);
+    for (int i = 0; i < top; i++) {
+        int taken = count_table_take(&table, 1);
+        if (taken < 0) {
+            break;
+        }
+        q3_count_node *node = (q3_count_node *)table.nodes[taken];
+        checksum = checksum * 31 + node->count + node->q3_count->to_airport_name[13];
+    }
+    count_table_free(&table);
+    perf_end(&mark, PERF_OUTPUT);
+
+    count_arena_free(&arenas[0]);
+    return checksum;
+}
+
+/**
+ * @brief The main function and entry point of the program.
+ *
+ * @param argc The number of arguments passed to the program.
+ * @param argv The layout to measure, then the airport count and the airports selected, both optional.
+ * @return int 0: The loops ran; 1: Bad arguments.
+ *
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2 || (strcmp(argv[1], "inline") != 0 && strcmp(argv[1], "packed") != 0)) {
+        fprintf(stderr, "Usage: %s inline|packed [GROUPS] [TOP]\n", argv[0]);
+        return 1;
+    }
+    int packed = (strcmp(argv[1], "packed") == 0);
+    long groups = (argc > 2) ? atol(argv[2]) : 4000;
+    int top = (argc > 3) ? atoi(argv[3]) : 100;
+    if (groups < 1 || top < 1) {
+        fprintf(stderr, "Error: GROUPS and TOP must be positive\n");
+        return 1;
+    }
+
+    // Both partitions hold every airport, each in its own order and with its own counts
+    long *ids[2];
+    int *counts[2];
+    srand(1);
+    for (int p = 0; p < 2; p++) {
+        ids[p] = (long *)emalloc(groups * sizeof(long));
+        counts[p] = (int *)emalloc(groups * sizeof(int));
+        for (long i = 0; i < groups; i++) {
+            ids[p][i] = i;
+            counts[p][i] = 1 + rand() % 1000;
+        }
+        shuffle(ids[p], groups);
+    }
+
+    // Measure only the three loops
+    perf_enable();
+    perf_add_records(2 * groups);
+    long checksum = packed ? run_packed(ids, counts, groups, top) : run_inline(ids, counts, groups, top);
+
+    printf("%s layout: %ld groups per partition, top %d, checksum %ld\n", argv[1], groups, top, checksum);
+    perf_report(stdout);
+    perf_shutdown();
+    for (int p = 0; p < 2; p++) {
+        free(ids[p]);
+        free(counts[p]);
+    }
+    return 0;
+}
\ No newline at end of file
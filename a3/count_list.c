@@ -1,166 +1,248 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include "count_list.h"
-
-/**
- * @brief Dynamically allocates memory for a new q1_count_node and initializes it with a given Q1_count.
- *
- * @param q1_count The Q1_count to initialize the new node with.
- * @return q1_count_node* Pointer to the newly allocated and initialized node.
- */
-q1_count_node *q1_count_new_node(Q1_count q1_count) {
-    // Dynamically allocate memory for a new node
-    q1_count_node *temp = (q1_count_node *)malloc(sizeof(q1_count_node));
-    if (temp == NULL) {
-        // Handle memory allocation failure
-        fprintf(stderr, "Memory allocation failed\n");
-        exit(EXIT_FAILURE);
-    }
-    
-    // Initialize the new node with the provided Q1_count
-    temp->q1_count = q1_count;
-    temp->next = NULL;
-    temp->freed = 0; // Initialize the flag
-    
-    return temp;
-}
-
-/**
- * @brief Adds a new q1_count_node into the list in sorted order based on a specified field.
- *
- * @param list The head of the linked list.
- * @param new_node The new node to be added to the list.
- * @param field The field by which the list should be sorted ("airline_name").
- * @return q1_count_node* The head of the updated linked list.
- */
-q1_count_node *q1_count_add_inorder(q1_count_node *list, q1_count_node *new_node, char field[]) {
-    q1_count_node *prev = NULL;
-    q1_count_node *curr = list;
-
-    // Traverse the list to find the correct position based on airline_name
-    while (curr != NULL && strcmp(new_node->q1_count.airline_name, curr->q1_count.airline_name) > 0) {
-        prev = curr;
-        curr = curr->next;
-    }
-
-    // Insert the new node into the list
-    new_node->next = curr;
-
-    // If the new node is to be the new head of the list
-    if (prev == NULL) {
-        return new_node;
-    } else {
-        // Otherwise, insert the new node after the previous node
-        prev->next = new_node;
-        return list;
-    }
-}
-
-/**
- * @brief Dynamically allocates memory for a new q2_count_node and initializes it with a given Q2_count.
- *
- * @param q2_count The Q2_count to initialize the new node with.
- * @return q2_count_node* Pointer to the newly allocated and initialized node.
- */
-q2_count_node *q2_count_new_node(Q2_count q2_count) {
-    // Dynamically allocate memory for a new node
-    q2_count_node *temp = (q2_count_node *)malloc(sizeof(q2_count_node));
-    if (temp == NULL) {
-        // Handle memory allocation failure
-        fprintf(stderr, "Memory allocation failed\n");
-        exit(EXIT_FAILURE);
-    }
-    
-    // Initialize the new node with the provided Q2_count
-    temp->q2_count = q2_count;
-    temp->next = NULL;
-    temp->freed = 0; // Initialize the flag
-    
-    return temp;
-}
-
-/**
- * @brief Adds a new q2_count_node into the list in sorted order based on a specified field.
- *
- * @param list The head of the linked list.
- * @param new_node The new node to be added to the list.
- * @param field The field by which the list should be sorted ("to_airport_country").
- * @return q2_count_node* The head of the updated linked list.
- */
-q2_count_node *q2_count_add_inorder(q2_count_node *list, q2_count_node *new_node, char field[]) {
-    q2_count_node *prev = NULL;
-    q2_count_node *curr = list;
-
-    // Traverse the list to find the correct position based on to_airport_country
-    while (curr != NULL && strcmp(new_node->q2_count.to_airport_country, curr->q2_count.to_airport_country) > 0) {
-        prev = curr;
-        curr = curr->next;
-    }
-    
-    // Insert the new node into the list
-    new_node->next = curr;
-
-    // If the new node is to be the new head of the list
-    if (prev == NULL) {
-        return new_node;
-    } else {
-        // Otherwise, insert the new node after the previous node
-        prev->next = new_node;
-        return list;
-    }
-}
-
-/**
- * @brief Dynamically allocates memory for a new q3_count_node and initializes it with a given Q3_count.
- *
- * @param q3_count The Q3_count to initialize the new node with.
- * @return q3_count_node* Pointer to the newly allocated and initialized node.
- */
-q3_count_node *q3_count_new_node(Q3_count q3_count) {
-    // Dynamically allocate memory for a new node
-    q3_count_node *temp = (q3_count_node *)malloc(sizeof(q3_count_node));
-    if (temp == NULL) {
-        // Handle memory allocation failure
-        fprintf(stderr, "Memory allocation failed\n");
-        exit(EXIT_FAILURE);
-    }
-    
-    // Initialize the new node with the provided Q3_count
-    temp->q3_count = q3_count;
-    temp->next = NULL;
-    temp->freed = 0; // Initialize the flag
-    
-    return temp;
-}
-
-/**
- * @brief Adds a new q3_count_node into the list in sorted order based on a specified field.
- *
- * @param list The head of the linked list.
- * @param new_node The new node to be added to the list.
- * @param field The field by which the list should be sorted ("to_airport_country").
- * @return q3_count_node* The head of the updated linked list.
- */
-q3_count_node *q3_count_add_inorder(q3_count_node *list, q3_count_node *new_node, char field[]) {
-    q3_count_node *prev = NULL;
-    q3_count_node *curr = list;
-
-    // Traverse the list to find the correct position based on to_airport_country
-    while (curr != NULL && strcmp(new_node->q3_count.to_airport_country, curr->q3_count.to_airport_country) > 0) {
-        prev = curr;
-        curr = curr->next;
-    }
-    
-    // Insert the new node into the list
-    new_node->next = curr;
-
-    // If the new node is to be the new head of the list
-    if (prev == NULL) {
-        return new_node;
-    } else {
-        // Otherwise, insert the new node after the previous node
-        prev->next = new_node;
-        return list;
-    }
-}
\ No newline at end of file
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "count_list.h"
+
+/**
+ * @brief Initializes an empty count arena.
+ *
+ * @param arena The arena.
+ * @return void: nothing
+ */
+void count_arena_init(count_arena *arena) {
+    arena->hot = NULL;
+    arena->cold = NULL;
+}
+
+/**
+ * @brief Hands out size bytes from a chunk list of a count arena, starting a new chunk when the one being
+ *        filled has no room. Blocks are rounded up to 32 bytes, so a count node never straddles two cache
+ *        lines.
+ *
+ * @param chunks The hot or cold chunk list of the arena.
+ * @param size The bytes needed, at most COUNT_CHUNK_SIZE minus a block.
+ * @return void* The block.
+ */
+void *count_arena_alloc(count_chunk **chunks, size_t size) {
+    const size_t block = 32;
+    size = (size + block - 1) / block * block;
+
+    count_chunk *chunk = *chunks;
+    if (chunk == NULL || chunk->used + size > COUNT_CHUNK_SIZE) {
+        // The header takes the first block, so every block after it stays aligned
+        if (posix_memalign((void **)&chunk, COUNT_TABLE_ALIGN, COUNT_CHUNK_SIZE) != 0) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        chunk->next = *chunks;
+        chunk->used = block;
+        *chunks = chunk;
+    }
+    void *memory = (char *)chunk + chunk->used;
+    chunk->used += size;
+    return memory;
+}
+
+/**
+ * @brief Moves every chunk of one arena into another, so the nodes of a merged list are freed with it.
+ *
+ * @param into The arena kept.
+ * @param from The arena emptied.
+ * @return void: nothing
+ */
+void count_arena_join(count_arena *into, count_arena *from) {
+    count_chunk **lists[2][2] = { { &into->hot, &from->hot }, { &into->cold, &from->cold } };
+
+    for (int i = 0; i < 2; i++) {
+        count_chunk *chunk = *lists[i][1];
+        if (chunk == NULL) {
+            continue;
+        }
+        // Keep the chunk being filled at the front and hang the other list behind the joined one
+        while (chunk->next != NULL) {
+            chunk = chunk->next;
+        }
+        chunk->next = *lists[i][0];
+        *lists[i][0] = *lists[i][1];
+        *lists[i][1] = NULL;
+    }
+}
+
+/**
+ * @brief Frees every chunk of a count arena, and with them every node and name of its list.
+ *
+ * @param arena The arena.
+ * @return void: nothing
+ */
+void count_arena_free(count_arena *arena) {
+    count_chunk *lists[2] = { arena->hot, arena->cold };
+
+    for (int i = 0; i < 2; i++) {
+        while (lists[i] != NULL) {
+            count_chunk *next = lists[i]->next;
+            free(lists[i]);
+            lists[i] = next;
+        }
+    }
+    count_arena_init(arena);
+}
+
+/**
+ * @brief Allocates the arrays of a count table with room for size groups.
+ *
+ * @param table The table to allocate.
+ * @param size The number of groups.
+ * @return void: nothing
+ */
+static void count_table_alloc(count_table *table, int size) {
+    size_t bytes = (size_t)(size > 0 ? size : 1) * sizeof(int);
+
+    // Round up to whole cache lines so the array shares none with other data
+    bytes = (bytes + COUNT_TABLE_ALIGN - 1) / COUNT_TABLE_ALIGN * COUNT_TABLE_ALIGN;
+    if (posix_memalign((void **)&table->counts, COUNT_TABLE_ALIGN, bytes) != 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    table->nodes = (void **)malloc((size > 0 ? size : 1) * sizeof(void *));
+    if (table->nodes == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    table->size = size;
+    table->remaining = size;
+}
+
+/**
+ * @brief Takes the group with the highest (or lowest) count out of a count table. Of equal counts the
+ *        one earliest in list order is taken, like the scans of the count lists did.
+ *
+ * @param table The table.
+ * @param highest 1 to take the highest count, 0 the lowest.
+ * @return int The index of the group taken, or -1 if every group has been taken.
+ */
+int count_table_take(count_table *table, int highest) {
+    const int *counts = table->counts;
+    int best = -1;
+
+    if (table->remaining == 0) {
+        return -1;
+    }
+
+    // Taken groups hold a count that never wins, so the scan only reads the hot array
+    int best_count = highest ? INT_MIN : INT_MAX;
+    for (int i = 0; i < table->size; i++) {
+        if (highest ? (counts[i] > best_count) : (counts[i] < best_count)) {
+            best_count = counts[i];
+            best = i;
+        }
+    }
+    table->counts[best] = highest ? INT_MIN : INT_MAX;
+    table->remaining--;
+    return best;
+}
+
+/**
+ * @brief Frees the arrays of a count table; the count nodes stay with their list.
+ *
+ * @param table The table.
+ * @return void: nothing
+ */
+void count_table_free(count_table *table) {
+    free(table->counts);
+    free(table->nodes);
+}
+
+/**
+ * @brief Generates the kernels of the count list of one question from its prefix, its names struct, the
+ *        field it sorts by first and its inlined prefix##_count_node_compare order:
+ *
+ *        prefix##_count_new_node hands out a new node and a copy of the names from an arena.
+ *
+ *        prefix##_count_add_inorder adds a new node into the list in sorted order.
+ *
+ *        prefix##_count_merge merges two sorted lists into one, adding up the counts of groups found in both;
+ *        the duplicate nodes of the second list are left to its arena, which the caller joins to the first.
+ *
+ *        prefix##_count_table lays a list out as a count table for ranking.
+ */
+#define COUNT_LIST_KERNELS(prefix, type, key_field) \
+prefix##_count_node *prefix##_count_new_node(count_arena *arena, const type *names, int count) { \
+    prefix##_count_node *temp = (prefix##_count_node *)count_arena_alloc(&arena->hot, sizeof(prefix##_count_node)); \
+    temp->prefix##_count = (type *)count_arena_alloc(&arena->cold, sizeof(type)); \
+ \
+    /* Initialize the new node with the provided names and count, and copy the leading key bytes next to it */ \
+    *temp->prefix##_count = *names; \
+    temp->count = count; \
+    strncpy(temp->key, names->key_field, COUNT_KEY_SIZE); \
+    temp->next = NULL; \
+ \
+    return temp; \
+} \
+ \
+prefix##_count_node *prefix##_count_add_inorder(prefix##_count_node *list, prefix##_count_node *new_node) { \
+    prefix##_count_node *prev = NULL; \
+    prefix##_count_node *curr = list; \
+ \
+    /* Traverse the list to find the correct position */ \
+    while (curr != NULL && prefix##_count_node_compare(new_node, curr) > 0) { \
+        prev = curr; \
+        curr = curr->next; \
+    } \
+ \
+    /* Insert the new node into the list */ \
+    new_node->next = curr; \
+ \
+    /* If the new node is to be the new head of the list */ \
+    if (prev == NULL) { \
+        return new_node; \
+    } \
+    /* Otherwise, insert the new node after the previous node */ \
+    prev->next = new_node; \
+    return list; \
+} \
+ \
+prefix##_count_node *prefix##_count_merge(prefix##_count_node *a, prefix##_count_node *b) { \
+    prefix##_count_node *merged = NULL; \
+    prefix##_count_node **tail = &merged; \
+ \
+    /* Take the smaller node from either list until one runs out */ \
+    while (a != NULL && b != NULL) { \
+        int cmp = prefix##_count_node_compare(a, b); \
+        if (cmp == 0) { \
+            /* Same group in both lists: keep a's node and add b's count to it */ \
+            a->count += b->count; \
+            b = b->next; \
+            continue; \
+        } \
+        if (cmp < 0) { \
+            *tail = a; \
+            a = a->next; \
+        } else { \
+            *tail = b; \
+            b = b->next; \
+        } \
+        tail = &(*tail)->next; \
+    } \
+ \
+    /* Append whatever is left */ \
+    *tail = (a != NULL) ? a : b; \
+    return merged; \
+} \
+ \
+void prefix##_count_table(prefix##_count_node *head, count_table *table) { \
+    int size = 0; \
+    for (prefix##_count_node *node = head; node != NULL; node = node->next) { \
+        size++; \
+    } \
+    count_table_alloc(table, size); \
+ \
+    /* Copy the counts into the hot array and keep a pointer to the rest */ \
+    int i = 0; \
+    for (prefix##_count_node *node = head; node != NULL; node = node->next, i++) { \
+        table->counts[i] = node->count; \
+        table->nodes[i] = node; \
+    } \
+}
+
+COUNT_LISTS(COUNT_LIST_KERNELS)
\ No newline at end of file
@@ -1,45 +1,136 @@
-#ifndef COUNT_LIST_H
-#define COUNT_LIST_H
-
-#include "count.h"
-
-/**
- * @brief Struct representing a node in the linked list for Q1_count
- */
-typedef struct q1_count_node {
-    Q1_count q1_count;               // Data for Q1_count
-    struct q1_count_node *next;
-    int freed;                       // Flag to indicate if the node has been freed
-} q1_count_node;
-
-/**
- * @brief Struct representing a node in the linked list for Q2_count
- */
-typedef struct q2_count_node {
-    Q2_count q2_count;               // Data for Q2_count
-    struct q2_count_node *next;
-    int freed;                       // Flag to indicate if the node has been freed
-} q2_count_node;
-
-/**
- * @brief Struct representing a node in the linked list for Q3_count
- */ 
-typedef struct q3_count_node {
-    Q3_count q3_count;               // Data for Q3_count
-    struct q3_count_node *next;  
-    int freed;                       // Flag to indicate if the node has been freed
-} q3_count_node;
-
-/**
- * Function protypes associated with a linked list.
- */
-q1_count_node *q1_count_new_node(Q1_count q1_count);
-q1_count_node *q1_count_add_inorder(q1_count_node *list, q1_count_node *new_node, char field[]);
-
-q2_count_node *q2_count_new_node(Q2_count q2_count);
-q2_count_node *q2_count_add_inorder(q2_count_node *list, q2_count_node *new_node, char field[]);
-
-q3_count_node *q3_count_new_node(Q3_count q3_count);
-q3_count_node *q3_count_add_inorder(q3_count_node *list, q3_count_node *new_node, char field[]);
-
+#ifndef COUNT_LIST_H
+#define COUNT_LIST_H
+
+#include <string.h>
+#include "count.h"
+
+#define COUNT_KEY_SIZE 12         // Leading bytes of the sort key kept in the hot part of a count node
+#define COUNT_CHUNK_SIZE (64 * 1024) // Bytes of one chunk of a count_arena
+#define COUNT_TABLE_ALIGN 64     // Alignment of the hot count array: one cache line
+
+/**
+ * @brief Generates the node struct of the count list of one question, e.g. q1_count_node pointing at a
+ *        Q1_count. A node is only the hot part of a group, 32 bytes: the walks of the sorted insert and
+ *        the merge read next, count and the leading bytes of the key from nodes packed two to a cache
+ *        line, and follow the pointer to the cold names only when two keys share those bytes.
+ */
+#define COUNT_LIST_NODE(prefix, type, key_field) \
+typedef struct prefix##_count_node { \
+    struct prefix##_count_node *next; \
+    type *prefix##_count;            /* Cold: the names of the group */ \
+    int count;                       /* Hot: the count of the group */ \
+    char key[COUNT_KEY_SIZE];        /* Hot: key_field, cut or zero-padded to COUNT_KEY_SIZE bytes */ \
+} prefix##_count_node;
+
+/**
+ * @brief Declares the new node, sorted insert, merge and table kernels of the count list of one question.
+ */
+#define COUNT_LIST_PROTOTYPES(prefix, type, key_field) \
+prefix##_count_node *prefix##_count_new_node(count_arena *arena, const type *names, int count); \
+prefix##_count_node *prefix##_count_add_inorder(prefix##_count_node *list, prefix##_count_node *new_node); \
+prefix##_count_node *prefix##_count_merge(prefix##_count_node *a, prefix##_count_node *b); \
+void prefix##_count_table(prefix##_count_node *head, count_table *table);
+
+/**
+ * @brief Struct representing one block of memory handed out by a count_arena.
+ */
+typedef struct count_chunk {
+    struct count_chunk *next;   // The chunk filled before this one
+    size_t used;                // Bytes handed out from this chunk, counting this header
+} count_chunk;
+
+/**
+ * @brief Struct representing the memory of one count list. The hot nodes and the cold names are handed
+ *        out from separate chunks, so the nodes a walk reads sit next to each other; the whole list is
+ *        freed at once, and merging two lists joins their arenas.
+ */
+typedef struct {
+    count_chunk *hot;       // Chunks of count nodes
+    count_chunk *cold;      // Chunks of names
+} count_arena;
+
+/**
+ * @brief Struct representing a count list laid out for ranking. The counts are packed in one
+ *        cache-line-aligned array, so a top-N scan reads 16 groups per cache line; the names that are only
+ *        needed once a group is written stay in the cold nodes.
+ */
+typedef struct {
+    int *counts;        // Hot: counts[i] is the count of group i, in list order
+    void **nodes;       // Cold: nodes[i] is the count node holding the names of group i
+    int size;
+    int remaining;      // Groups not yet taken by count_table_take
+} count_table;
+
+/**
+ * @brief Table of the count lists: their prefix, the names struct they point at and the field their
+ *        groups are sorted by first.
+ */
+#define COUNT_LISTS(X) \
+    X(q1, Q1_count, airline_name) \
+    X(q2, Q2_count, to_airport_country) \
+    X(q3, Q3_count, to_airport_country)
+
+COUNT_LISTS(COUNT_LIST_NODE)
+
+/**
+ * @brief Orders two Q1_counts by airline_name.
+ *
+ * @param a The first count.
+ * @param b The second count.
+ * @return int Negative, zero or positive like strcmp.
+ */
+static inline int q1_count_compare(const Q1_count *a, const Q1_count *b) {
+    return strcmp(a->airline_name, b->airline_name);
+}
+
+/**
+ * @brief Orders two Q2_counts by to_airport_country.
+ *
+ * @param a The first count.
+ * @param b The second count.
+ * @return int Negative, zero or positive like strcmp.
+ */
+static inline int q2_count_compare(const Q2_count *a, const Q2_count *b) {
+    return strcmp(a->to_airport_country, b->to_airport_country);
+}
+
+/**
+ * @brief Orders two Q3_counts by to_airport_country, with the airports of one country in descending
+ *        name order. make_q3_count_list sees the airports in ascending name order and inserts each one
+ *        in front of the airports of its country, which is what produces the descending names.
+ *
+ * @param a The first count.
+ * @param b The second count.
+ * @return int Negative, zero or positive like strcmp.
+ */
+static inline int q3_count_compare(const Q3_count *a, const Q3_count *b) {
+    int cmp = strcmp(a->to_airport_country, b->to_airport_country);
+    return (cmp != 0) ? cmp : strcmp(b->to_airport_name, a->to_airport_name);
+}
+
+/**
+ * @brief Generates prefix##_count_node_compare, which orders two count nodes like prefix##_count_compare
+ *        orders their names. The leading key bytes decide unless they are equal, and strcmp agrees with
+ *        memcmp on them because both compare unsigned bytes and the key is zero-padded.
+ */
+#define COUNT_NODE_COMPARE(prefix, type, key_field) \
+static inline int prefix##_count_node_compare(const prefix##_count_node *a, const prefix##_count_node *b) { \
+    int cmp = memcmp(a->key, b->key, COUNT_KEY_SIZE); \
+    return (cmp != 0) ? cmp : prefix##_count_compare(a->prefix##_count, b->prefix##_count); \
+}
+
+COUNT_LISTS(COUNT_NODE_COMPARE)
+
+/**
+ * Function protypes associated with a linked list.
+ */
+COUNT_LISTS(COUNT_LIST_PROTOTYPES)
+
+void count_arena_init(count_arena *arena);
+void *count_arena_alloc(count_chunk **chunks, size_t size);
+void count_arena_join(count_arena *into, count_arena *from);
+void count_arena_free(count_arena *arena);
+int count_table_take(count_table *table, int highest);
+void count_table_free(count_table *table);
+
 #endif // COUNT_LIST_H
\ No newline at end of file
@@ -0,0 +1,41 @@
+/** @file dedup.h
+ *  @brief Set of route fingerprints shared by the readers, so a route that appears twice is counted once.
+ *
+ */
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <stddef.h>
+
+#define DEDUP_SEED 14695981039346656037ull  // Fingerprint of a route before its first line
+#define DEDUP_PROBES 16                     // Slots probed in one table before moving on to the next
+#define DEDUP_GROWTH 4                      // How much larger each table is than the one before it
+
+/**
+ * @brief Struct representing one table of fingerprints. A fingerprint whose probe window is full moves on to
+ *        the next, larger table, which is created when it is first needed.
+ */
+typedef struct dedup_table {
+    unsigned long long *slots;  // 64-bit fingerprints published with compare-and-swap; 0 marks an empty slot
+    size_t capacity;            // A power of two
+    struct dedup_table *next;   // DEDUP_GROWTH times as large, or NULL; published with compare-and-swap
+} dedup_table;
+
+/**
+ * @brief Struct representing the fingerprints seen so far. It grows by chaining larger tables, so it never
+ *        fills up however many routes an unsized input brings.
+ */
+typedef struct {
+    dedup_table *tables;        // The first table, sized from the expected routes
+    long removed;               // Routes dropped as repeats, updated atomically
+} route_dedup;
+
+/**
+ * Function protypes associated with duplicate elimination.
+ */
+route_dedup *dedup_create(size_t expected_routes);
+unsigned long long dedup_line(unsigned long long fingerprint, const char *line);
+int dedup_first(route_dedup *dedup, unsigned long long fingerprint);
+void dedup_free(route_dedup *dedup);
+
+#endif // DEDUP_H
\ No newline at end of file
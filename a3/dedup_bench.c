@@ -0,0 +1,141 @@
+/** @file dedup_bench.c
+ *  @brief Benchmark of the throughput cost of --DEDUP in the streaming reader.
+ *
+ *  A yaml file of routes is written with a known share of repeated routes,
+ *  then read with read_yaml_records with and without a dedup set, parsing
+ *  the fields of q1. Every run is checked against the routes expected, and
+ *  the best time of each is reported with the cost of dropping repeats.
+ *
+ *  Usage: ./dedup_bench [ROUTES] [REPEAT_PERCENT] [RUNS]
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "reader.h"
+#include "filter.h"
+#include "dedup.h"
+
+/**
+ * @brief Returns a monotonic time in seconds.
+ *
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief read_yaml_records visitor counting the routes handed over.
+ *
+ */
+static void count_route(Route *route, void *ctx) {
+    (void)route;
+    (*(long *)ctx)++;
+}
+
+/**
+ * @brief Writes one route, numbered so that distinct numbers give distinct routes.
+ *
+ */
+static void write_route(FILE *file, long id) {
+    fprintf(file, "- airline_name: Airline %ld\n", id % 500);
+    fprintf(file, "  airline_icao_unique_code: A%03ld\n", id % 500);
+    fprintf(file, "  airline_country: Country %ld\n", id % 90);
+    fprintf(file, "  from_airport_name: Airport %ld\n", id % 3000);
+    fprintf(file, "  from_airport_city: City %ld\n", id % 3000);
+    fprintf(file, "  from_airport_country: Country %ld\n", id % 97);
+    fprintf(file, "  from_airport_icao_unique_code: F%07ld\n", id);
+    fprintf(file, "  from_airport_altitude: '%ld.0'\n", id % 4000);
+    fprintf(file, "  to_airport_name: Airport %ld\n", (id * 7) % 3000);
+    fprintf(file, "  to_airport_city: City %ld\n", (id * 7) % 3000);
+    fprintf(file, "  to_airport_country: Country %ld\n", (id * 7) % 97);
+    fprintf(file, "  to_airport_icao_unique_code: T%07ld\n", id);
+    fprintf(file, "  to_airport_altitude: '%ld.0'\n", (id * 7) % 4000);
+}
+
+/**
+ * @brief Reads the file runs times and returns the best time; every run must hand over expected routes.
+ *
+ */
+static double best_time(const char *path, long routes, int dedup, long expected, int runs, int *errors) {
+    route_fields fields = ROUTE_FIELD_BIT(airline_name) | ROUTE_FIELD_BIT(airline_icao_unique_code);
+    double best = 0;
+
+    for (int r = 0; r < runs; r++) {
+        route_filter filter;
+        filter_init(&filter);
+        if (dedup) {
+            filter.dedup = dedup_create(routes);
+        }
+        long handed = 0;
+        double start = now_seconds();
+        read_yaml_records(path, fields, &filter, count_route, &handed);
+        double seconds = now_seconds() - start;
+        if (handed != expected) {
+            fprintf(stderr, "%s: %ld routes handed over, not %ld\n", dedup ? "dedup" : "plain", handed, expected);
+            (*errors)++;
+        }
+        if (filter.dedup != NULL) {
+            dedup_free(filter.dedup);
+        }
+        if (r == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief The main function and entry point of the program.
+ *
+ * @param argc The number of arguments passed to the program.
+ * @param argv The route count, the percent of them that repeat an earlier route and the runs, all optional.
+ * @return int 0: Every run handed over the right routes; 1: Errors found.
+ *
+ */
+int main(int argc, char *argv[]) {
+    long routes = (argc > 1) ? atol(argv[1]) : 200000;
+    int repeat_percent = (argc > 2) ? atoi(argv[2]) : 5;
+    int runs = (argc > 3) ? atoi(argv[3]) : 5;
+    char path[64];
+    int errors = 0;
+
+    if (routes < 1 || repeat_percent < 0 || repeat_percent > 100 || runs < 1) {
+        fprintf(stderr, "Usage: %s [ROUTES] [REPEAT_PERCENT] [RUNS]\n", argv[0]);
+        return 1;
+    }
+
+    // Every route after the first repeats an earlier one with the given chance
+    snprintf(path, sizeof(path), "dedup_bench.%ld.yaml", (long)getpid());
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open %s for writing\n", path);
+        return 1;
+    }
+    long distinct = 0;
+    srand(1);
+    fputs("routes:\n", file);
+    for (long i = 0; i < routes; i++) {
+        if (distinct > 0 && rand() % 100 < repeat_percent) {
+            write_route(file, rand() % distinct);
+        } else {
+            write_route(file, distinct++);
+        }
+    }
+    fclose(file);
+
+    double plain = best_time(path, routes, 0, routes, runs, &errors);
+    double dedup = best_time(path, routes, 1, distinct, runs, &errors);
+    remove(path);
+
+    printf("%-8s %10s %10s %14s\n", "reader", "routes", "handed", "routes/s");
+    printf("%-8s %10ld %10ld %14.0f\n", "plain", routes, routes, routes / plain);
+    printf("%-8s %10ld %10ld %14.0f\n", "dedup", routes, distinct, routes / dedup);
+    printf("dedup costs %.1f%% of the reader's throughput%s\n", 100.0 * (dedup - plain) / dedup,
+           errors ? " (FAILED)" : "");
+    return errors ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,278 @@
+/** @file export.c
+ *  @brief Implementation of export.h
+ *
+ *  Rows are formatted straight into one large buffer that is written out
+ *  with a single system call whenever it fills, so a table of millions of
+ *  rows takes a few hundred writes. Integers are converted by hand rather
+ *  than with printf, which would parse its format string for every row.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "export.h"
+#include "emalloc.h"
+
+/**
+ * @brief Writes the buffered bytes to the file, retrying partial writes.
+ *
+ */
+static void flush(exporter *out) {
+    size_t done = 0;
+
+    while (done < out->used && !out->failed) {
+        ssize_t written = write(out->fd, out->buffer + done, out->used - done);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            out->failed = 1;
+            break;
+        }
+        done += (size_t)written;
+    }
+    out->used = 0;
+}
+
+/**
+ * @brief Makes room for length more bytes in the buffer, flushing it if they do not fit.
+ *
+ */
+static char *reserve(exporter *out, size_t length) {
+    if (out->used + length > EXPORT_BUFFER) {
+        flush(out);
+    }
+    return out->buffer + out->used;
+}
+
+/**
+ * @brief Appends length bytes to the buffer; a run longer than the whole buffer is written in pieces.
+ *
+ */
+static void put(exporter *out, const char *data, size_t length) {
+    while (length > 0) {
+        size_t chunk = (length < EXPORT_BUFFER) ? length : EXPORT_BUFFER;
+        memcpy(reserve(out, chunk), data, chunk);
+        out->used += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+/**
+ * @brief Appends one byte to the buffer.
+ *
+ */
+static void put_char(exporter *out, char c) {
+    *reserve(out, 1) = c;
+    out->used++;
+}
+
+/**
+ * @brief Appends the decimal digits of a number, filled in from the last digit backwards.
+ *
+ */
+static void put_long(exporter *out, long value) {
+    char digits[24];
+    char *p = digits + sizeof(digits);
+    unsigned long magnitude = (value < 0) ? 0UL - (unsigned long)value : (unsigned long)value;
+
+    do {
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        *--p = '-';
+    }
+    put(out, p, (size_t)(digits + sizeof(digits) - p));
+}
+
+/**
+ * @brief Appends an unsigned integer of size bytes, least significant byte first.
+ *
+ */
+static void put_little_endian(exporter *out, unsigned long long value, int size) {
+    char *p = reserve(out, (size_t)size);
+    for (int i = 0; i < size; i++) {
+        p[i] = (char)(value >> (8 * i));
+    }
+    out->used += (size_t)size;
+}
+
+/**
+ * @brief Appends a csv field, quoted with its quotes doubled when it holds a comma, quote or line break.
+ *
+ */
+static void put_csv(exporter *out, const char *text) {
+    size_t length = strlen(text);
+
+    if (strpbrk(text, ",\"\r\n") == NULL) {
+        put(out, text, length);
+        return;
+    }
+    put_char(out, '"');
+    for (const char *quote; (quote = strchr(text, '"')) != NULL; text = quote + 1) {
+        put(out, text, (size_t)(quote - text + 1));
+        put_char(out, '"');
+    }
+    put(out, text, strlen(text));
+    put_char(out, '"');
+}
+
+/**
+ * @brief Appends a JSON string, escaping quotes, backslashes and control characters.
+ *
+ */
+static void put_json(exporter *out, const char *text) {
+    static const char hex[] = "0123456789abcdef";
+
+    put_char(out, '"');
+    for (const unsigned char *c = (const unsigned char *)text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            put_char(out, '\\');
+            put_char(out, (char)*c);
+        } else if (*c < 0x20) {
+            put(out, "\\u00", 4);
+            put_char(out, hex[*c >> 4]);
+            put_char(out, hex[*c & 0xf]);
+        } else {
+            put_char(out, (char)*c);
+        }
+    }
+    put_char(out, '"');
+}
+
+/**
+ * @brief Appends a binary string: its u32 length, then its bytes.
+ *
+ */
+static void put_binary(exporter *out, const char *text) {
+    size_t length = strlen(text);
+    put_little_endian(out, length, 4);
+    put(out, text, length);
+}
+
+/**
+ * @brief Reads the name of an export format given with --EXPORT_FORMAT=.
+ *
+ * @param name "csv", "jsonl" or "binary".
+ * @param format Set to the format.
+ * @return int 0 if the name is known, 1 otherwise.
+ *
+ */
+int export_parse_format(const char *name, export_format *format) {
+    if (strcmp(name, "csv") == 0) {
+        *format = EXPORT_CSV;
+    } else if (strcmp(name, "jsonl") == 0) {
+        *format = EXPORT_JSONL;
+    } else if (strcmp(name, "binary") == 0) {
+        *format = EXPORT_BINARY;
+    } else {
+        fprintf(stderr, "Error: --EXPORT_FORMAT is csv, jsonl or binary, not %s\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Starts an export and writes its header.
+ *
+ * @param out The export to start.
+ * @param path The file the table replaces once it is closed.
+ * @param format How the rows are written.
+ * @param names The names of the text columns, then of the statistic; they must outlive the export.
+ * @param columns The number of text columns, at most EXPORT_MAX_COLUMNS.
+ * @return int 0 if the temporary file was created, 1 otherwise.
+ *
+ */
+int export_open(exporter *out, const char *path, export_format format, const char *const *names, int columns) {
+    memset(out, 0, sizeof(exporter));
+    snprintf(out->path, sizeof(out->path), "%s", path);
+    snprintf(out->temp_path, sizeof(out->temp_path), "%s.%ld.tmp", path, (long)getpid());
+    out->fd = open(out->temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out->fd < 0) {
+        fprintf(stderr, "Could not open %s for writing\n", out->temp_path);
+        return 1;
+    }
+    out->format = format;
+    out->buffer = (char *)emalloc(EXPORT_BUFFER);
+    out->columns = (columns < EXPORT_MAX_COLUMNS) ? columns : EXPORT_MAX_COLUMNS;
+    memcpy(out->names, names, (out->columns + 1) * sizeof(const char *));
+
+    // JSON lines name the columns in every row, so only csv and binary have a header
+    if (format == EXPORT_CSV) {
+        for (int c = 0; c <= out->columns; c++) {
+            if (c > 0) {
+                put_char(out, ',');
+            }
+            put_csv(out, out->names[c]);
+        }
+        put_char(out, '\n');
+    } else if (format == EXPORT_BINARY) {
+        put(out, "RMX1", 4);
+        put_little_endian(out, (unsigned long long)out->columns + 1, 4);
+        for (int c = 0; c <= out->columns; c++) {
+            put_binary(out, out->names[c]);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Appends one row to an export.
+ *
+ * @param out The export.
+ * @param text The text columns of the row.
+ * @param statistic The statistic of the row.
+ * @return void: nothing
+ *
+ */
+void export_row(exporter *out, const char *const *text, long statistic) {
+    if (out->format == EXPORT_CSV) {
+        for (int c = 0; c < out->columns; c++) {
+            put_csv(out, text[c]);
+            put_char(out, ',');
+        }
+        put_long(out, statistic);
+        put_char(out, '\n');
+    } else if (out->format == EXPORT_JSONL) {
+        for (int c = 0; c <= out->columns; c++) {
+            put_char(out, (c == 0) ? '{' : ',');
+            put_json(out, out->names[c]);
+            put_char(out, ':');
+            if (c < out->columns) {
+                put_json(out, text[c]);
+            } else {
+                put_long(out, statistic);
+            }
+        }
+        put(out, "}\n", 2);
+    } else {
+        for (int c = 0; c < out->columns; c++) {
+            put_binary(out, text[c]);
+        }
+        put_little_endian(out, (unsigned long long)statistic, 8);
+    }
+    out->rows++;
+}
+
+/**
+ * @brief Writes the rest of an export and puts it in place of its path.
+ *
+ * @param out The export.
+ * @return int 0 if every row was written, 1 otherwise; the path is then left as it was.
+ *
+ */
+int export_close(exporter *out) {
+    flush(out);
+    free(out->buffer);
+    if (close(out->fd) != 0 || out->failed || rename(out->temp_path, out->path) != 0) {
+        fprintf(stderr, "Could not write export %s\n", out->path);
+        remove(out->temp_path);
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+/** @file export.h
+ *  @brief Buffered export of complete ranked tables as csv, JSON lines or length-prefixed binary records.
+ *
+ *  The binary format is, with every integer little-endian:
+ *    header  "RMX1", a u32 column count, then every column name as a u32 length and its bytes
+ *    row     every text column as a u32 length and its bytes, then the statistic as an i64
+ *  The statistic is the last column; the rows follow the header until the end of the file.
+ *
+ */
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <stddef.h>
+
+#define EXPORT_BUFFER (1024 * 1024)     // Bytes gathered before each write to the file
+#define EXPORT_MAX_COLUMNS 8            // Text columns in one table
+
+/**
+ * @brief How the rows of an export are written.
+ */
+typedef enum {
+    EXPORT_CSV,         // A header line, then "text,...,statistic" lines, quoted where needed
+    EXPORT_JSONL,       // One JSON object per row, keyed by the column names
+    EXPORT_BINARY       // Length-prefixed records, as described above
+} export_format;
+
+/**
+ * @brief Struct representing an export being written. The rows go to a temporary file that replaces the
+ *        export path when it is closed, so a reader of the path never sees half a table.
+ */
+typedef struct {
+    int fd;
+    export_format format;
+    char *buffer;                           // EXPORT_BUFFER bytes
+    size_t used;                            // Bytes of buffer not yet written
+    int columns;                            // Text columns in every row
+    const char *names[EXPORT_MAX_COLUMNS + 1];  // The text column names, then the statistic name
+    long rows;
+    int failed;                             // 1 once a write has failed
+    char path[4096];
+    char temp_path[4096];
+} exporter;
+
+/**
+ * Function protypes associated with the export.
+ */
+int export_parse_format(const char *name, export_format *format);
+int export_open(exporter *out, const char *path, export_format format, const char *const *names, int columns);
+void export_row(exporter *out, const char *const *text, long statistic);
+int export_close(exporter *out);
+
+#endif // EXPORT_H
\ No newline at end of file
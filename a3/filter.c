@@ -0,0 +1,193 @@
+/** @file filter.c
+ *  @brief Implementation of filter.h
+ *
+ *  A reader passes the bit of every field it has just parsed to
+ *  filter_accepts, so a route is rejected at the first field that fails a
+ *  predicate and the rest of its lines are skipped without being parsed.
+ *  At the end of a route the fields it never had are checked as empty.
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include "filter.h"
+
+/**
+ * @brief Empties a filter, so it accepts every route.
+ *
+ * @param filter The filter to initialize.
+ * @return void: nothing
+ *
+ */
+void filter_init(route_filter *filter) {
+    filter->count = 0;
+    filter->fields = 0;
+    filter->dedup = NULL;
+}
+
+/**
+ * @brief Adds a predicate to a filter if it holds fewer than limit predicates.
+ *
+ */
+static int add_predicate(route_filter *filter, const char *spec, int limit) {
+    if (filter->count >= limit) {
+        fprintf(stderr, "Error: more than %d predicates\n", limit);
+        return 1;
+    }
+    route_predicate *p = &filter->predicates[filter->count];
+
+    // Split the field name from the values at the first '=', which a '^' before it makes a prefix test
+    const char *equals = strchr(spec, '=');
+    if (equals == NULL || strlen(spec) >= sizeof(p->spec)) {
+        fprintf(stderr, "Error: malformed predicate %s\n", spec);
+        return 1;
+    }
+    p->kind = (equals > spec && equals[-1] == '^') ? FILTER_PREFIX : FILTER_EQUALS;
+
+    char name[BUFFER_SIZE];
+    size_t name_length = (size_t)(equals - spec) - (p->kind == FILTER_PREFIX);
+    memcpy(name, spec, name_length);
+    name[name_length] = '\0';
+    p->field = route_field_mask(name);
+    p->offset = route_field_offset(name);
+    if (p->field == 0) {
+        fprintf(stderr, "Error: unknown route field in predicate %s\n", spec);
+        return 1;
+    }
+
+    // Cut the values apart at every '|'
+    strcpy(p->spec, spec);
+    strcpy(p->text, equals + 1);
+    p->value_count = 0;
+    char *value = p->text;
+    for (;;) {
+        if (p->value_count == FILTER_MAX_VALUES) {
+            fprintf(stderr, "Error: more than %d values in predicate %s\n", FILTER_MAX_VALUES, spec);
+            return 1;
+        }
+        char *bar = strchr(value, '|');
+        if (bar != NULL) {
+            *bar = '\0';
+        }
+        p->starts[p->value_count] = (short)(value - p->text);
+        p->lengths[p->value_count] = (short)strlen(value);
+        p->value_count++;
+        if (bar == NULL) {
+            break;
+        }
+        value = bar + 1;
+    }
+
+    filter->fields |= p->field;
+    filter->count++;
+    return 0;
+}
+
+/**
+ * @brief Adds a predicate to a filter: "field=value" tests equality, "field=a|b|c" membership of a set and
+ *        "field^=prefix" a prefix, where field is any string field of Route.
+ *
+ * @param filter The filter to add to.
+ * @param spec The predicate.
+ * @return int 0: No errors; 1: The predicate is malformed, names no field or does not fit.
+ *
+ */
+int filter_add(route_filter *filter, const char *spec) {
+    return add_predicate(filter, spec, FILTER_MAX_PREDICATES);
+}
+
+/**
+ * @brief Adds the predicate of a question to a filter, in the slots kept for it, so a filter that already
+ *        holds FILTER_MAX_PREDICATES given predicates still takes it.
+ *
+ * @param filter The filter to add to.
+ * @param spec The predicate.
+ * @return int 0: No errors; 1: The predicate is malformed, names no field or does not fit.
+ *
+ */
+int filter_add_question(route_filter *filter, const char *spec) {
+    return add_predicate(filter, spec, FILTER_MAX_PREDICATES + FILTER_QUESTION_PREDICATES);
+}
+
+/**
+ * @brief Tests one field value against the values of a predicate.
+ *
+ */
+static int predicate_matches(const route_predicate *p, const char *field) {
+    for (int i = 0; i < p->value_count; i++) {
+        const char *value = p->text + p->starts[i];
+        if (p->kind == FILTER_PREFIX ? strncmp(field, value, p->lengths[i]) == 0 : strcmp(field, value) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Checks the predicates on some of the fields of a route.
+ *
+ * @param filter The filter.
+ * @param fields The fields to check, such as the one parsed last; the others are not looked at.
+ * @param route The route, whose unparsed fields are empty.
+ * @return int 1: Every predicate on the fields holds; 0: The route is rejected.
+ *
+ */
+int filter_accepts(const route_filter *filter, route_fields fields, const Route *route) {
+    if ((filter->fields & fields) == 0) {
+        return 1;
+    }
+    for (int i = 0; i < filter->count; i++) {
+        const route_predicate *p = &filter->predicates[i];
+        if ((p->field & fields) && !predicate_matches(p, ROUTE_FIELD_VALUE(route, p->offset))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Appends a separator and a string to a description where they fit, counting their length in used
+ *        either way, and adds both to a 64-bit FNV-1a hash of the whole description.
+ *
+ */
+static void describe_part(char *out, size_t size, size_t *used, unsigned long long *hash, const char *separator,
+                          const char *part) {
+    int written = snprintf((*used < size) ? out + *used : NULL, (*used < size) ? size - *used : 0, "%s%s",
+                           separator, part);
+    *used += (written > 0) ? (size_t)written : 0;
+
+    const char *strings[2] = { separator, part };
+    for (int s = 0; s < 2; s++) {
+        for (const char *c = strings[s]; *c != '\0'; c++) {
+            *hash ^= (unsigned char)*c;
+            *hash *= 1099511628211ULL;
+        }
+    }
+}
+
+/**
+ * @brief Writes the predicates of a filter as one line, such as for the key of a cached result. Duplicate
+ *        elimination is written as "dedup", since it changes the counts like a predicate. A description
+ *        that does not fit is written as "hash=" and a hash of all of it instead of being cut short, so
+ *        two filters never share a key because they only differ past the end of the buffer.
+ *
+ * @param filter The filter.
+ * @param out The buffer to write to, of at least FILTER_DESCRIBE_MIN bytes.
+ * @param size The size of the buffer.
+ * @return void: nothing
+ *
+ */
+void filter_describe(const route_filter *filter, char *out, size_t size) {
+    unsigned long long hash = 14695981039346656037ULL;
+    size_t used = 0;
+
+    out[0] = '\0';
+    for (int i = 0; i < filter->count; i++) {
+        describe_part(out, size, &used, &hash, (i > 0) ? " " : "", filter->predicates[i].spec);
+    }
+    if (filter->dedup != NULL) {
+        describe_part(out, size, &used, &hash, (used > 0) ? " " : "", "dedup");
+    }
+    if (used >= size) {
+        snprintf(out, size, "hash=%016llx", hash);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+/** @file filter.h
+ *  @brief Predicates on route fields, checked while a route is parsed so rejected routes are never kept.
+ *
+ */
+#ifndef FILTER_H
+#define FILTER_H
+
+#include "route.h"
+#include "dedup.h"
+
+#define FILTER_MAX_PREDICATES 16    // Predicates given in one filter; they must all hold
+#define FILTER_QUESTION_PREDICATES 1    // Slots kept past those for the predicates a question adds
+#define FILTER_MAX_VALUES 32        // Values of one predicate; any of them may match
+#define FILTER_DESCRIBE_MIN 22      // Bytes filter_describe needs to write a description as its hash
+
+/**
+ * @brief How a predicate compares a field with its values.
+ */
+typedef enum {
+    FILTER_EQUALS,  // field=value, or field=a|b|c for membership of a set
+    FILTER_PREFIX   // field^=prefix, or field^=a|b for any of several prefixes
+} filter_kind;
+
+/**
+ * @brief Struct representing one predicate on one route field.
+ */
+typedef struct {
+    filter_kind kind;
+    route_fields field;                 // The bit of the field tested
+    size_t offset;                      // The offset of the field in Route
+    char spec[BUFFER_SIZE];             // The predicate as it was given
+    char text[BUFFER_SIZE];             // The values, each terminated by '\0'
+    short starts[FILTER_MAX_VALUES];    // Where each value starts in text
+    short lengths[FILTER_MAX_VALUES];
+    int value_count;
+} route_predicate;
+
+/**
+ * @brief Struct representing the predicates a route must all pass.
+ */
+typedef struct {
+    route_predicate predicates[FILTER_MAX_PREDICATES + FILTER_QUESTION_PREDICATES];
+    int count;
+    route_fields fields;    // The fields tested by any predicate
+    route_dedup *dedup;     // Drops every repeat of a route, or NULL to keep them
+} route_filter;
+
+/**
+ * Function protypes associated with route filters.
+ */
+void filter_init(route_filter *filter);
+int filter_add(route_filter *filter, const char *spec);
+int filter_add_question(route_filter *filter, const char *spec);
+int filter_accepts(const route_filter *filter, route_fields fields, const Route *route);
+void filter_describe(const route_filter *filter, char *out, size_t size);
+
+#endif // FILTER_H
\ No newline at end of file
@@ -0,0 +1,170 @@
+/** @file hugemem.c
+ *  @brief Implementation of hugemem.h
+ *
+ *  Buffers are mapped directly, aligned to a huge page, so that with
+ *  MADV_HUGEPAGE each 2 MB of them takes one TLB entry instead of 512.
+ *  The NUMA policy is set with the mbind system call, so no library is
+ *  needed. Both are hints: a kernel without THP or NUMA support leaves
+ *  the buffer on ordinary pages, and nothing else changes.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "hugemem.h"
+
+#define HUGEMEM_MAX_NODES 1024     // Bits in the node masks given to the kernel
+
+static int use_huge_pages = 0;
+static hugemem_numa numa_policy = HUGEMEM_NUMA_DEFAULT;
+static unsigned long allowed_nodes[HUGEMEM_MAX_NODES / (8 * sizeof(unsigned long))];  // Nodes to interleave over
+static int warned = 0;          // 1 once a failed hint has been reported
+
+/**
+ * @brief Reports the first hint the kernel refuses; later ones would only repeat it.
+ *
+ */
+static void warn_once(const char *what) {
+    if (!__atomic_exchange_n(&warned, 1, __ATOMIC_RELAXED)) {
+        fprintf(stderr, "Warning: %s unavailable; using ordinary page placement\n", what);
+    }
+}
+
+/**
+ * @brief Sets how every later hugemem_alloc places its buffer. Call once, before any buffer is allocated.
+ *
+ * @param huge_pages 1 to ask for transparent huge pages.
+ * @param numa The NUMA placement.
+ * @return void: nothing
+ *
+ */
+void hugemem_configure(int huge_pages, hugemem_numa numa) {
+    use_huge_pages = huge_pages;
+    numa_policy = numa;
+
+    // Interleave over the nodes this process may use, as the kernel rejects masks naming nodes it lacks
+    if (numa == HUGEMEM_NUMA_INTERLEAVE
+        && syscall(SYS_get_mempolicy, NULL, allowed_nodes, HUGEMEM_MAX_NODES, NULL, MPOL_F_MEMS_ALLOWED) != 0) {
+        warn_once("NUMA placement");
+        numa_policy = HUGEMEM_NUMA_DEFAULT;
+    }
+}
+
+/**
+ * @brief Tells whether buffers get huge pages or a NUMA placement, so that mapping them is worth the waste.
+ *
+ * @return int 1: --HUGEPAGES or a --NUMA placement is in effect; 0: Buffers are ordinary memory.
+ *
+ */
+int hugemem_active(void) {
+    return use_huge_pages || (numa_policy != HUGEMEM_NUMA_DEFAULT);
+}
+
+/**
+ * @brief Parses the name of a NUMA placement: "interleave", "local" or "default".
+ *
+ * @param name The name.
+ * @param numa Set to the placement.
+ * @return int 0: No errors; 1: The name is unknown.
+ *
+ */
+int hugemem_parse_numa(const char *name, hugemem_numa *numa) {
+    if (strcmp(name, "interleave") == 0) {
+        *numa = HUGEMEM_NUMA_INTERLEAVE;
+    } else if (strcmp(name, "local") == 0) {
+        *numa = HUGEMEM_NUMA_LOCAL;
+    } else if (strcmp(name, "default") == 0) {
+        *numa = HUGEMEM_NUMA_DEFAULT;
+    } else {
+        fprintf(stderr, "Error: --NUMA is interleave, local or default, not %s\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Rounds a size up to whole huge pages.
+ *
+ */
+static size_t mapped_size(size_t size) {
+    return (size + HUGEMEM_PAGE - 1) / HUGEMEM_PAGE * HUGEMEM_PAGE;
+}
+
+/**
+ * @brief Allocates a buffer aligned to a huge page. Buffers under half a huge page would waste most of it,
+ *        so they come from malloc instead.
+ *
+ * @param size The number of bytes.
+ * @return void* The buffer, to be freed with hugemem_free and the same size, or NULL if it could not be
+ *         allocated.
+ *
+ */
+void *hugemem_try_alloc(size_t size) {
+    if (size < HUGEMEM_PAGE / 2) {
+        return malloc(size > 0 ? size : 1);
+    }
+    size_t length = mapped_size(size);
+
+    // Map one extra huge page, then unmap what lies outside the aligned part
+    char *mapped = mmap(NULL, length + HUGEMEM_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) {
+        return NULL;
+    }
+    char *buffer = (char *)(((uintptr_t)mapped + HUGEMEM_PAGE - 1) & ~(uintptr_t)(HUGEMEM_PAGE - 1));
+    if (buffer > mapped) {
+        munmap(mapped, buffer - mapped);
+    }
+    if (mapped + HUGEMEM_PAGE > buffer) {
+        munmap(buffer + length, mapped + HUGEMEM_PAGE - buffer);
+    }
+
+    // The hints only take effect when the pages are first touched, so they are given before that
+    if (use_huge_pages && madvise(buffer, length, MADV_HUGEPAGE) != 0) {
+        warn_once("transparent huge pages");
+    }
+    if (numa_policy != HUGEMEM_NUMA_DEFAULT) {
+        int interleave = (numa_policy == HUGEMEM_NUMA_INTERLEAVE);
+        if (syscall(SYS_mbind, buffer, length, interleave ? MPOL_INTERLEAVE : MPOL_LOCAL, interleave ? allowed_nodes : NULL,
+                    interleave ? HUGEMEM_MAX_NODES : 0, 0) != 0) {
+            warn_once("NUMA placement");
+        }
+    }
+    return buffer;
+}
+
+/**
+ * @brief Allocates a buffer like hugemem_try_alloc, ending the program if it could not be allocated.
+ *
+ * @param size The number of bytes.
+ * @return void* The buffer, to be freed with hugemem_free and the same size.
+ *
+ */
+void *hugemem_alloc(size_t size) {
+    void *buffer = hugemem_try_alloc(size);
+    if (buffer == NULL) {
+        fprintf(stderr, "mmap of %zu bytes failed\n", size);
+        exit(1);
+    }
+    return buffer;
+}
+
+/**
+ * @brief Frees a buffer allocated by hugemem_alloc.
+ *
+ * @param buffer The buffer, or NULL.
+ * @param size The size it was allocated with.
+ * @return void: nothing
+ *
+ */
+void hugemem_free(void *buffer, size_t size) {
+    if (size < HUGEMEM_PAGE / 2) {
+        free(buffer);
+    } else if (buffer != NULL) {
+        munmap(buffer, mapped_size(size));
+    }
+}
\ No newline at end of file
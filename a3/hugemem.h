@@ -0,0 +1,31 @@
+/** @file hugemem.h
+ *  @brief Large buffers on transparent huge pages, placed across NUMA nodes as configured.
+ *
+ */
+#ifndef HUGEMEM_H
+#define HUGEMEM_H
+
+#include <stddef.h>
+
+#define HUGEMEM_PAGE (2 * 1024 * 1024)  // Size and alignment of a transparent huge page on x86-64
+
+/**
+ * @brief Where the pages of a buffer are placed on a NUMA machine.
+ */
+typedef enum {
+    HUGEMEM_NUMA_DEFAULT,       // The process policy, first touch unless set otherwise
+    HUGEMEM_NUMA_INTERLEAVE,    // Round-robin over every allowed node
+    HUGEMEM_NUMA_LOCAL          // The node of the thread that first touches each page
+} hugemem_numa;
+
+/**
+ * Function protypes associated with large buffers.
+ */
+void hugemem_configure(int huge_pages, hugemem_numa numa);
+int hugemem_parse_numa(const char *name, hugemem_numa *numa);
+int hugemem_active(void);
+void *hugemem_try_alloc(size_t size);
+void *hugemem_alloc(size_t size);
+void hugemem_free(void *buffer, size_t size);
+
+#endif // HUGEMEM_H
\ No newline at end of file
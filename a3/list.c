@@ -1,73 +1,129 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include "list.h"
-#include "emalloc.h"
-
-/**
- * @brief Dynamically allocates memory for a new node and initializes it with a given Route.
- *
- * @param route The Route to initialize the new node with.
- * @return node_t* Pointer to the newly allocated and initialized node.
- *
- */
-node_t *new_node(Route route) {
-    // Allocate memory for the new node
-    node_t *temp = (node_t *)emalloc(sizeof(node_t));
-    if (temp == NULL) {
-        // Handle memory allocation failure
-        fprintf(stderr, "Memory allocation failed\n");
-        exit(EXIT_FAILURE);
-    }
-    // Initialize the new node with the provided route and set the next pointer to NULL
-    temp->route = route;
-    temp->next = NULL;
-    return temp;
-}
-
-/**
- * @brief Adds a new node into the list in sorted order based on a specified field.
- *
- * @param list The head of the linked list.
- * @param new_node The new node to be added to the list.
- * @param field The field by which the list should be sorted ("airline_name", "to_airport_country", or "to_airport_name").
- * @return node_t* The head of the updated linked list.
- *
- */
-node_t *add_inorder(node_t *list, node_t *new_node, char field[]) {
-    node_t *prev = NULL;
-    node_t *curr = list;
-
-    // Determine which field to use for sorting
-    if (strcmp(field, "airline_name") == 0) {
-        // Traverse the list to find the correct position based on airline_name
-        while (curr != NULL && strcmp(new_node->route.airline_name, curr->route.airline_name) > 0) {
-            prev = curr;
-            curr = curr->next;
-        }
-    } else if (strcmp(field, "to_airport_country") == 0) {
-        // Traverse the list to find the correct position based on to_airport_country
-        while (curr != NULL && strcmp(new_node->route.to_airport_country, curr->route.to_airport_country) > 0) {
-            prev = curr;
-            curr = curr->next;
-        }
-    } else if (strcmp(field, "to_airport_name") == 0) {
-        // Traverse the list to find the correct position based on to_airport_name
-        while (curr != NULL && strcmp(new_node->route.to_airport_name, curr->route.to_airport_name) > 0) {
-            prev = curr;
-            curr = curr->next;
-        }
-    }
-
-    // Insert the new node into the list
-    new_node->next = curr;
-
-    // If the new node is to be the new head of the list
-    if (prev == NULL) {
-        return new_node;
-    } else {
-        // Otherwise, insert the new node after the previous node
-        prev->next = new_node;
-        return list;
-    }
-}
\ No newline at end of file
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "list.h"
+#include "emalloc.h"
+#include "hugemem.h"
+
+/**
+ * @brief Dynamically allocates memory for a new node and initializes it with a given Route.
+ *
+ * @param route The Route to initialize the new node with.
+ * @return node_t* Pointer to the newly allocated and initialized node.
+ *
+ */
+node_t *new_node(Route route) {
+    // Allocate memory for the new node
+    node_t *temp = (node_t *)emalloc(sizeof(node_t));
+    if (temp == NULL) {
+        // Handle memory allocation failure
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    // Initialize the new node with the provided route and set the next pointer to NULL
+    temp->route = route;
+    temp->next = NULL;
+    temp->group = temp;
+    return temp;
+}
+
+/**
+ * @brief Initializes an empty arena.
+ *
+ * @param arena The arena to initialize.
+ * @return void: nothing
+ *
+ */
+void node_arena_init(node_arena *arena) {
+    arena->chunks = NULL;
+}
+
+/**
+ * @brief Hands out an uninitialized node, starting a new chunk when the current one is full. Nodes of one
+ *        chunk sit next to each other, so walking the list touches far fewer pages than with a separate
+ *        allocation per node. A chunk is a whole huge page only with huge pages or a NUMA placement; otherwise
+ *        it is a smaller block from the ordinary allocator, so a partition with few routes maps no 2 MB page.
+ *
+ * @param arena The arena.
+ * @return node_t* The node; it is freed with the arena.
+ *
+ */
+node_t *node_arena_alloc(node_arena *arena) {
+    if (arena->chunks == NULL || arena->chunks->used == arena->chunks->capacity) {
+        size_t size = hugemem_active() ? HUGEMEM_PAGE : NODE_CHUNK_SIZE;
+        node_chunk *chunk = (node_chunk *)hugemem_alloc(size);
+        chunk->next = arena->chunks;
+        chunk->used = 0;
+        chunk->capacity = (size - sizeof(node_chunk)) / sizeof(node_t);
+        chunk->size = size;
+        arena->chunks = chunk;
+    }
+    return &arena->chunks->nodes[arena->chunks->used++];
+}
+
+/**
+ * @brief Takes back the node most recently handed out, such as one that was not added to the list.
+ *
+ * @param arena The arena.
+ * @return void: nothing
+ *
+ */
+void node_arena_unalloc(node_arena *arena) {
+    if (arena->chunks != NULL && arena->chunks->used > 0) {
+        arena->chunks->used--;
+    }
+}
+
+/**
+ * @brief Frees every node of the arena.
+ *
+ * @param arena The arena.
+ * @return void: nothing
+ *
+ */
+void node_arena_free(node_arena *arena) {
+    while (arena->chunks != NULL) {
+        node_chunk *chunk = arena->chunks;
+        arena->chunks = chunk->next;
+        hugemem_free(chunk, chunk->size);
+    }
+}
+
+/**
+ * @brief Generates add_inorder_<field>, which adds a new node into the list in sorted order based on
+ *        that field. Each field gets its own function so the traversal loop compares one fixed member
+ *        instead of deciding which field to use on every call. A node equal to the one it is put in
+ *        front of joins that node's group, so every run of equal nodes shares one group. A group is the
+ *        last node of its run, so the walk compares the first node of each run and jumps past the rest:
+ *        an insert costs one comparison per group before it rather than one per route.
+ *
+ * @param list The head of the linked list.
+ * @param new_node The new node to be added to the list.
+ * @return node_t* The head of the updated linked list.
+ *
+ */
+#define LIST_ADD_INORDER(name, convert) \
+node_t *add_inorder_##name(node_t *list, node_t *new_node) { \
+    node_t *prev = NULL; \
+    node_t *curr = list; \
+    int cmp = 1; \
+ \
+    /* Traverse the runs of the list to find the correct position based on the field */ \
+    while (curr != NULL && (cmp = route_compare_##name(&new_node->route, &curr->route)) > 0) { \
+        prev = curr->group; \
+        curr = prev->next; \
+    } \
+ \
+    /* Insert the new node into the list, in the group of an equal node or in a group of its own */ \
+    new_node->next = curr; \
+    new_node->group = (curr != NULL && cmp == 0) ? curr->group : new_node; \
+ \
+    /* If the new node is to be the new head of the list */ \
+    if (prev == NULL) { \
+        return new_node; \
+    } \
+    /* Otherwise, insert the new node after the previous node */ \
+    prev->next = new_node; \
+    return list; \
+}
+ROUTE_STRING_FIELDS(LIST_ADD_INORDER)
\ No newline at end of file
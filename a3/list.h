@@ -1,20 +1,52 @@
-#ifndef LIST_H
-#define LIST_H
-
-#include "route.h"
-
-/**
- * @brief An struct that represents a node in the linked list.
- */
-typedef struct node {
-    Route route;
-    struct node *next;
-} node_t;
-
-/**
- * Function protypes associated with a linked list.
- */
-node_t *new_node(Route route);
-node_t *add_inorder(node_t *list, node_t *new_node, char field[]);
-
+#ifndef LIST_H
+#define LIST_H
+
+#include "route.h"
+
+#define NODE_CHUNK_SIZE (256 * 1024)    // Bytes of a chunk when huge pages are off; a huge page when they are on
+
+/**
+ * @brief An struct that represents a node in the linked list. The hot links a counting walk reads come
+ *        before the 3 KB route, so a run of routes of one group is counted without touching their keys.
+ */
+typedef struct node {
+    struct node *next;      // Hot: first, next to group, so a walk of the list reads one cache line per node
+    struct node *group;     // Hot: the last node of the run of nodes with the same sort key, set by add_inorder
+    Route route;            // Cold: only read for the first node of a group
+} node_t;
+
+/**
+ * @brief Struct representing one block of nodes handed out by a node_arena.
+ */
+typedef struct node_chunk {
+    struct node_chunk *next;    // The chunk filled before this one
+    size_t used;                // Nodes handed out from this chunk
+    size_t capacity;
+    size_t size;                // Bytes of the chunk, to free it with
+    node_t nodes[];
+} node_chunk;
+
+/**
+ * @brief Struct representing the nodes of one route list, allocated together in chunks and freed
+ *        together once the list has been counted.
+ */
+typedef struct {
+    node_chunk *chunks;     // The chunk being filled, or NULL
+} node_arena;
+
+/**
+ * @brief Declares add_inorder_<field>(list, new_node) for every field of the route table.
+ */
+#define LIST_ADD_INORDER_PROTOTYPE(name, convert) node_t *add_inorder_##name(node_t *list, node_t *new_node);
+
+/**
+ * Function protypes associated with a linked list.
+ */
+node_t *new_node(Route route);
+void node_arena_init(node_arena *arena);
+node_t *node_arena_alloc(node_arena *arena);
+void node_arena_unalloc(node_arena *arena);
+void node_arena_free(node_arena *arena);
+ROUTE_STRING_FIELDS(LIST_ADD_INORDER_PROTOTYPE)
+
 #endif // LIST_H
\ No newline at end of file
@@ -0,0 +1,253 @@
+/** @file map_bench.c
+ *  @brief Stress test and benchmark of the concurrent map against a mutex-protected baseline.
+ *
+ *  Every thread adds a fixed sequence of keys, so the count every key must
+ *  end with is known in advance. Two workloads are run: a few hot keys that
+ *  every thread hits at once, and many keys whose inserts race. Each is run
+ *  on the lock-free map and on a table behind one mutex; the counts of both
+ *  are checked and their times reported.
+ *
+ *  Usage: ./map_bench [THREADS] [ADDS_PER_THREAD]
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "concurrent_map.h"
+#include "emalloc.h"
+
+#define MAX_THREADS 256
+
+/**
+ * @brief Struct representing the baseline: an open-addressing table of keys and counts behind one mutex.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    char **keys;
+    int *counts;
+    size_t capacity;    // A power of two
+} mutex_map;
+
+/**
+ * @brief Struct representing one workload: the keys, and the adds every thread makes.
+ */
+typedef struct {
+    const char *name;
+    char **keys;
+    int key_count;
+    long adds;          // Adds per thread, a multiple of key_count
+    int threads;
+} workload;
+
+/**
+ * @brief Struct representing one thread of a run.
+ */
+typedef struct {
+    const workload *work;
+    int thread;
+    concurrent_map *map;    // The map under test, or NULL to use baseline
+    mutex_map *baseline;
+    long bad_values;        // Entries seen with a value that does not belong to their key
+} worker;
+
+/**
+ * @brief Computes the FNV-1a hash of a string.
+ *
+ */
+static unsigned int hash_key(const char *str) {
+    unsigned int hash = 2166136261u;
+    while (*str != '\0') {
+        hash ^= (unsigned char)*str++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Returns a monotonic time in seconds.
+ *
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Adds one to the count of a key in the baseline, inserting the key if it is new.
+ *
+ */
+static void mutex_map_add(mutex_map *map, char *key) {
+    size_t mask = map->capacity - 1;
+
+    pthread_mutex_lock(&map->lock);
+    size_t i = hash_key(key) & mask;
+    while (map->keys[i] != NULL && strcmp(map->keys[i], key) != 0) {
+        i = (i + 1) & mask;
+    }
+    map->keys[i] = key;
+    map->counts[i]++;
+    pthread_mutex_unlock(&map->lock);
+}
+
+/**
+ * @brief concurrent_map_add init storing the index of the key that introduced the entry.
+ *
+ */
+static void init_index(void *value, const void *ctx) {
+    *(int *)value = *(const int *)ctx;
+}
+
+/**
+ * @brief Thread making the adds of one thread of a workload. Every thread starts at a different key, so
+ *        the first adds of a key come from many threads at once.
+ *
+ */
+static void *run_worker(void *arg) {
+    worker *w = (worker *)arg;
+    const workload *work = w->work;
+    int k = (int)(((long)w->thread * 7919) % work->key_count);
+
+    for (long i = 0; i < work->adds; i++) {
+        if (w->map != NULL) {
+            map_entry *entry = concurrent_map_add(w->map, work->keys[k], 1, init_index, &k, sizeof(int));
+            // The value must be filled in before the entry is seen by any thread
+            if (entry == NULL || *(int *)entry->value != k) {
+                w->bad_values++;
+            }
+        } else {
+            mutex_map_add(w->baseline, work->keys[k]);
+        }
+        k = (k + 1 == work->key_count) ? 0 : k + 1;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Runs a workload on the concurrent map, or on the baseline if map is NULL, and returns its seconds.
+ *
+ */
+static double run(const workload *work, concurrent_map *map, mutex_map *baseline, long *bad_values) {
+    pthread_t threads[MAX_THREADS];
+    worker workers[MAX_THREADS];
+
+    double start = now_seconds();
+    for (int t = 0; t < work->threads; t++) {
+        workers[t].work = work;
+        workers[t].thread = t;
+        workers[t].map = map;
+        workers[t].baseline = baseline;
+        workers[t].bad_values = 0;
+        pthread_create(&threads[t], NULL, run_worker, &workers[t]);
+    }
+    *bad_values = 0;
+    for (int t = 0; t < work->threads; t++) {
+        pthread_join(threads[t], NULL);
+        *bad_values += workers[t].bad_values;
+    }
+    return now_seconds() - start;
+}
+
+/**
+ * @brief Runs a workload on both maps, checks that every key ended with the same count on both, and prints
+ *        the times. Returns the number of errors found.
+ *
+ */
+static int bench(const workload *work) {
+    long expected = (long)work->threads * (work->adds / work->key_count);
+    long bad_values;
+    int errors = 0;
+
+    // The lock-free map, started small so the many-keys workload grows it while the inserts race
+    concurrent_map *map = concurrent_map_create(0);
+    double lock_free = run(work, map, NULL, &bad_values);
+    size_t entry_count;
+    map_entry **entries = concurrent_map_entries(map, &entry_count);
+    if (entry_count != (size_t)work->key_count) {
+        fprintf(stderr, "%s: the map holds %zu keys, not %d\n", work->name, entry_count, work->key_count);
+        errors++;
+    }
+    for (size_t i = 0; i < entry_count; i++) {
+        if (entries[i]->count != expected) {
+            fprintf(stderr, "%s: %s counted %d times, not %ld\n", work->name, entries[i]->key, entries[i]->count, expected);
+            errors++;
+        }
+    }
+    if (bad_values > 0) {
+        fprintf(stderr, "%s: %ld adds returned an entry without its value\n", work->name, bad_values);
+        errors++;
+    }
+    free(entries);
+    concurrent_map_free(map);
+
+    // The baseline
+    mutex_map baseline;
+    pthread_mutex_init(&baseline.lock, NULL);
+    baseline.capacity = 64;
+    while (baseline.capacity < 2 * (size_t)work->key_count) {
+        baseline.capacity *= 2;
+    }
+    baseline.keys = (char **)calloc(baseline.capacity, sizeof(char *));
+    baseline.counts = (int *)calloc(baseline.capacity, sizeof(int));
+    double locked = run(work, NULL, &baseline, &bad_values);
+    for (size_t i = 0; i < baseline.capacity; i++) {
+        if (baseline.keys[i] != NULL && baseline.counts[i] != expected) {
+            fprintf(stderr, "%s: the baseline counted %s %d times, not %ld\n", work->name, baseline.keys[i],
+                    baseline.counts[i], expected);
+            errors++;
+        }
+    }
+    free(baseline.keys);
+    free(baseline.counts);
+    pthread_mutex_destroy(&baseline.lock);
+
+    double adds = (double)work->threads * work->adds;
+    printf("%-8s %8d %10d %14.0f %14.0f %8.2fx  %s\n", work->name, work->threads, work->key_count, adds / lock_free,
+           adds / locked, locked / lock_free, errors ? "FAILED" : "ok");
+    return errors;
+}
+
+/**
+ * @brief The main function and entry point of the program.
+ *
+ * @param argc The number of arguments passed to the program.
+ * @param argv The thread count and the adds per thread, both optional.
+ * @return int 0: Every count was right; 1: Errors found.
+ *
+ */
+int main(int argc, char *argv[]) {
+    int threads = (argc > 1) ? atoi(argv[1]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    long adds = (argc > 2) ? atol(argv[2]) : 2000000;
+    int errors = 0;
+
+    if (threads < 2) {
+        threads = 2;     // Contention needs at least two threads
+    }
+    if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+
+    // Route-pair-like keys; the hot workload uses the first few of them
+    int key_count = 200000;
+    char **keys = (char **)emalloc(key_count * sizeof(char *));
+    for (int k = 0; k < key_count; k++) {
+        keys[k] = (char *)emalloc(32);
+        snprintf(keys[k], 32, "A%05d-B%05d", k % 9973, k);
+    }
+
+    workload hot = { "hot", keys, 16, adds / 16 * 16, threads };
+    workload spread = { "spread", keys, key_count, (adds + key_count - 1) / key_count * key_count, threads };
+
+    printf("%-8s %8s %10s %14s %14s %9s\n", "workload", "threads", "keys", "lock-free/s", "mutex/s", "speedup");
+    errors += bench(&hot);
+    errors += bench(&spread);
+
+    for (int k = 0; k < key_count; k++) {
+        free(keys[k]);
+    }
+    free(keys);
+    return errors ? 1 : 0;
+}
\ No newline at end of file
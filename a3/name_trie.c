@@ -0,0 +1,290 @@
+/** @file name_trie.c
+ *  @brief Implementation of name_trie.h
+ *
+ *  Every node either ends a name or has two or more children, so the
+ *  subtree below a prefix has fewer than twice as many nodes as it has
+ *  names. A prefix query walks one edge per label it spans and then
+ *  collects that subtree, which keeps it proportional to the prefix
+ *  length plus the number of names matched.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "name_trie.h"
+#include "emalloc.h"
+
+/**
+ * @brief Makes room for needed more elements of element_size bytes in an array, doubling it when full.
+ *
+ */
+static void *grow(void *array, size_t *capacity, size_t used, size_t needed, size_t element_size) {
+    if (used + needed <= *capacity) {
+        return array;
+    }
+    size_t new_capacity = *capacity * 2 + needed;
+    void *bigger = emalloc(new_capacity * element_size);
+    memcpy(bigger, array, used * element_size);
+    free(array);
+    *capacity = new_capacity;
+    return bigger;
+}
+
+/**
+ * @brief Copies length bytes of str and a terminator into the text of the trie, returning their offset.
+ *
+ */
+static unsigned int add_text(name_trie *trie, const char *str, size_t length) {
+    trie->text = (char *)grow(trie->text, &trie->text_capacity, trie->text_size, length + 1, 1);
+    unsigned int offset = (unsigned int)trie->text_size;
+    memcpy(trie->text + offset, str, length);
+    trie->text[offset + length] = '\0';
+    trie->text_size += length + 1;
+    return offset;
+}
+
+/**
+ * @brief Appends a childless node with the given edge label and returns its index.
+ *
+ */
+static int add_node(name_trie *trie, unsigned int label, unsigned int length) {
+    trie->nodes = (trie_node *)grow(trie->nodes, &trie->node_capacity, trie->node_count, 1, sizeof(trie_node));
+    trie_node *node = &trie->nodes[trie->node_count];
+    node->label = label;
+    node->length = length;
+    node->child = -1;
+    node->sibling = -1;
+    node->group = -1;
+    return (int)trie->node_count++;
+}
+
+/**
+ * @brief Returns the child of a node whose edge label starts with c, or -1.
+ *
+ */
+static int find_child(const name_trie *trie, int node, char c) {
+    int child = trie->nodes[node].child;
+    while (child >= 0 && trie->text[trie->nodes[child].label] != c) {
+        child = trie->nodes[child].sibling;
+    }
+    return child;
+}
+
+/**
+ * @brief Initializes an empty trie.
+ *
+ * @param trie The trie to initialize.
+ * @return void: nothing
+ *
+ */
+void name_trie_init(name_trie *trie) {
+    memset(trie, 0, sizeof(name_trie));
+    trie->node_capacity = 1024;
+    trie->nodes = (trie_node *)emalloc(trie->node_capacity * sizeof(trie_node));
+    trie->group_capacity = 512;
+    trie->groups = (trie_group *)emalloc(trie->group_capacity * sizeof(trie_group));
+    trie->text_capacity = 64 * 1024;
+    trie->text = (char *)emalloc(trie->text_capacity);
+    add_node(trie, 0, 0);
+}
+
+/**
+ * @brief Counts one route under a name, adding the name if it is new.
+ *
+ * @param trie The trie.
+ * @param key The name.
+ * @param tie Orders names with equal counts before the name does; kept from the name's first route.
+ * @param label The subject written for the name; kept from the name's first route.
+ * @return void: nothing
+ *
+ */
+void name_trie_add(name_trie *trie, const char *key, const char *tie, const char *label) {
+    const char *rest = key;
+    int node = 0;
+
+    // Follow the edges that match the name, splitting the one it leaves part way along
+    while (*rest != '\0') {
+        int child = find_child(trie, node, *rest);
+        if (child < 0) {
+            // Nothing shares the rest of the name: hang it off this node as one edge
+            size_t length = strlen(rest);
+            unsigned int text = add_text(trie, rest, length);
+            child = add_node(trie, text, (unsigned int)length);
+            trie->nodes[child].sibling = trie->nodes[node].child;
+            trie->nodes[node].child = child;
+            node = child;
+            break;
+        }
+
+        unsigned int common = 0;
+        const char *edge = trie->text + trie->nodes[child].label;
+        while (common < trie->nodes[child].length && rest[common] == edge[common]) {
+            common++;
+        }
+        if (common < trie->nodes[child].length) {
+            // The lower part of the edge moves to a new node that takes over the children and the name
+            int lower = add_node(trie, trie->nodes[child].label + common, trie->nodes[child].length - common);
+            trie->nodes[lower].child = trie->nodes[child].child;
+            trie->nodes[lower].group = trie->nodes[child].group;
+            trie->nodes[child].length = common;
+            trie->nodes[child].child = lower;
+            trie->nodes[child].group = -1;
+        }
+        node = child;
+        rest += common;
+    }
+
+    // Count the route under the name that ends here
+    if (trie->nodes[node].group < 0) {
+        trie->groups = (trie_group *)grow(trie->groups, &trie->group_capacity, trie->group_count, 1, sizeof(trie_group));
+        trie_group *group = &trie->groups[trie->group_count];
+        group->count = 0;
+        group->key = add_text(trie, key, strlen(key));
+        group->tie = add_text(trie, tie, strlen(tie));
+        group->label = add_text(trie, label, strlen(label));
+        trie->nodes[node].group = (int)trie->group_count++;
+    }
+    trie->groups[trie->nodes[node].group].count++;
+}
+
+/**
+ * @brief Finds every name that starts with a prefix.
+ *
+ * @param trie The trie.
+ * @param prefix The prefix; "" matches every name.
+ * @param groups Set to a new array of the indexes of the matching groups, to be freed by the caller.
+ * @return size_t The number of matching names.
+ *
+ */
+size_t name_trie_match(const name_trie *trie, const char *prefix, int **groups) {
+    const char *rest = prefix;
+    int node = 0;
+
+    *groups = (int *)emalloc((trie->group_count + 1) * sizeof(int));
+
+    // Walk down to the node whose subtree holds exactly the names with the prefix
+    while (*rest != '\0') {
+        node = find_child(trie, node, *rest);
+        if (node < 0) {
+            return 0;
+        }
+        const char *edge = trie->text + trie->nodes[node].label;
+        unsigned int i = 0;
+        while (i < trie->nodes[node].length && rest[i] != '\0' && rest[i] == edge[i]) {
+            i++;
+        }
+        if (rest[i] != '\0' && i < trie->nodes[node].length) {
+            return 0;
+        }
+        rest += i;
+    }
+
+    // Collect the names of the subtree, depth first
+    size_t count = 0;
+    int *stack = (int *)emalloc(trie->node_count * sizeof(int));
+    size_t depth = 0;
+    stack[depth++] = node;
+    while (depth > 0) {
+        const trie_node *top = &trie->nodes[stack[--depth]];
+        if (top->group >= 0) {
+            (*groups)[count++] = top->group;
+        }
+        for (int child = top->child; child >= 0; child = trie->nodes[child].sibling) {
+            stack[depth++] = child;
+        }
+    }
+    free(stack);
+    return count;
+}
+
+/**
+ * @brief Ranking order of the names, set by name_trie_write for compare_groups.
+ */
+static const name_trie *rank_trie;
+static int rank_descending;
+static int rank_key_descending;
+
+/**
+ * @brief qsort comparator ranking group indexes by count, then tie, then name.
+ *
+ */
+static int compare_groups(const void *a, const void *b) {
+    const trie_group *x = &rank_trie->groups[*(const int *)a];
+    const trie_group *y = &rank_trie->groups[*(const int *)b];
+
+    if (x->count != y->count) {
+        return ((x->count > y->count) == rank_descending) ? -1 : 1;
+    }
+    int cmp = strcmp(rank_trie->text + x->tie, rank_trie->text + y->tie);
+    if (cmp != 0) {
+        return cmp;
+    }
+    cmp = strcmp(rank_trie->text + x->key, rank_trie->text + y->key);
+    return rank_key_descending ? -cmp : cmp;
+}
+
+/**
+ * @brief Writes a csv field, quoted with its quotes doubled when it holds a comma, quote or line break, like
+ *        the fields of --EXPORT.
+ *
+ */
+static void write_csv(FILE *file, const char *text) {
+    if (strpbrk(text, ",\"\r\n") == NULL) {
+        fputs(text, file);
+        return;
+    }
+    fputc('"', file);
+    for (; *text != '\0'; text++) {
+        if (*text == '"') {
+            fputc('"', file);
+        }
+        fputc(*text, file);
+    }
+    fputc('"', file);
+}
+
+/**
+ * @brief Writes the n best ranked names that start with a prefix as csv lines of "prefix,subject,statistic".
+ *
+ * @param trie The trie.
+ * @param prefix The prefix.
+ * @param file The file to write to.
+ * @param n The number of names to write.
+ * @param descending 1 to rank names by the highest count, 0 by the lowest.
+ * @param key_descending 1 if equal counts and ties rank the larger name first.
+ * @return int The number of names written.
+ *
+ */
+int name_trie_write(const name_trie *trie, const char *prefix, FILE *file, int n, int descending, int key_descending) {
+    int *groups;
+    size_t count = name_trie_match(trie, prefix, &groups);
+
+    rank_trie = trie;
+    rank_descending = descending;
+    rank_key_descending = key_descending;
+    qsort(groups, count, sizeof(int), compare_groups);
+
+    int written = 0;
+    for (size_t i = 0; i < count && written < n; i++, written++) {
+        const trie_group *group = &trie->groups[groups[i]];
+        write_csv(file, prefix);
+        fputc(',', file);
+        write_csv(file, trie->text + group->label);
+        fprintf(file, ",%ld\n", group->count);
+    }
+    free(groups);
+    return written;
+}
+
+/**
+ * @brief Frees the arrays of a trie.
+ *
+ * @param trie The trie.
+ * @return void: nothing
+ *
+ */
+void name_trie_free(name_trie *trie) {
+    free(trie->nodes);
+    free(trie->groups);
+    free(trie->text);
+}
\ No newline at end of file
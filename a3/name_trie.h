@@ -0,0 +1,59 @@
+/** @file name_trie.h
+ *  @brief Radix trie of airline or airport names with their route counts, for prefix queries.
+ *
+ */
+#ifndef NAME_TRIE_H
+#define NAME_TRIE_H
+
+#include <stdio.h>
+
+#define TRIE_MAX_PREFIXES 64    // --PREFIX= options in one run
+
+/**
+ * @brief Struct representing one node of the trie. The edge from its parent is labelled with a run of
+ *        characters, so a chain of single-child nodes is stored as one node.
+ */
+typedef struct {
+    unsigned int label;     // Offset of the edge label in name_trie.text
+    unsigned int length;    // Length of the edge label
+    int child;              // First child, or -1
+    int sibling;            // Next child of the same parent, or -1
+    int group;              // The name ending at this node, or -1
+} trie_node;
+
+/**
+ * @brief Struct representing one name and its route count.
+ */
+typedef struct {
+    long count;
+    unsigned int key;       // Offset of the name in name_trie.text
+    unsigned int tie;       // Offset of the string ordering equal counts before the name does
+    unsigned int label;     // Offset of the subject written for the name
+} trie_group;
+
+/**
+ * @brief Struct representing the trie. Nodes and groups refer to each other by index and to their strings
+ *        by offset, so the arrays can grow without fixing pointers.
+ */
+typedef struct {
+    trie_node *nodes;       // nodes[0] is the root, with an empty label
+    size_t node_count;
+    size_t node_capacity;
+    trie_group *groups;
+    size_t group_count;
+    size_t group_capacity;
+    char *text;             // Edge labels and group strings
+    size_t text_size;
+    size_t text_capacity;
+} name_trie;
+
+/**
+ * Function protypes associated with the name trie.
+ */
+void name_trie_init(name_trie *trie);
+void name_trie_add(name_trie *trie, const char *key, const char *tie, const char *label);
+size_t name_trie_match(const name_trie *trie, const char *prefix, int **groups);
+int name_trie_write(const name_trie *trie, const char *prefix, FILE *file, int n, int descending, int key_descending);
+void name_trie_free(name_trie *trie);
+
+#endif // NAME_TRIE_H
\ No newline at end of file
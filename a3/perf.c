@@ -0,0 +1,237 @@
+/** @file perf.c
+ *  @brief Implementation of perf.h
+ *
+ *  Every thread that measures a phase opens its own user-space counters the
+ *  first time, so the pool workers need no setup. A phase reads the counters
+ *  of its thread at the start and the end and adds the difference to the
+ *  totals of the phase. Counters the kernel or the machine does not offer
+ *  are left out of the report; if none can be opened, only times are shown.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "perf.h"
+
+#define PERF_MAX_FDS 1024   // Counters kept open across all threads
+
+static int perf_enabled = 0;
+static long long enabled_at;    // Nanoseconds when perf_enable was called
+
+static __thread int thread_fds[PERF_EVENTS];   // This thread's counters, -1 if unavailable
+static __thread int thread_opened = 0;
+
+static long long totals[PERF_PHASES][PERF_EVENTS];
+static long long phase_nanoseconds[PERF_PHASES];
+static long phase_calls[PERF_PHASES];
+static long records;
+static int event_available[PERF_EVENTS];    // 1 once any thread has opened the counter
+
+static pthread_mutex_t fds_lock = PTHREAD_MUTEX_INITIALIZER;
+static int open_fds[PERF_MAX_FDS];
+static int open_fd_count = 0;
+
+static const unsigned int event_types[PERF_EVENTS] = {
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HW_CACHE
+};
+
+static const unsigned long long event_configs[PERF_EVENTS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,     // Last-level cache misses on most processors
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+};
+
+/**
+ * @brief Returns a monotonic time in nanoseconds.
+ *
+ */
+static long long now_nanoseconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Opens the counters of the calling thread.
+ *
+ */
+static void open_thread_counters(void) {
+    struct perf_event_attr attr;
+
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = event_types[e];
+        attr.config = event_configs[e];
+        attr.exclude_kernel = 1;    // Allowed without privileges under the default paranoid level
+        attr.exclude_hv = 1;
+
+        // Count this thread on whatever processor it runs
+        thread_fds[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (thread_fds[e] < 0) {
+            continue;
+        }
+        __atomic_store_n(&event_available[e], 1, __ATOMIC_RELAXED);
+
+        // Remember the counter so perf_shutdown can close it
+        pthread_mutex_lock(&fds_lock);
+        if (open_fd_count < PERF_MAX_FDS) {
+            open_fds[open_fd_count++] = thread_fds[e];
+        }
+        pthread_mutex_unlock(&fds_lock);
+    }
+    thread_opened = 1;
+}
+
+/**
+ * @brief Reads the counters of the calling thread; unavailable counters read as 0.
+ *
+ */
+static void read_thread_counters(long long *values) {
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        values[e] = 0;
+        if (thread_fds[e] >= 0 && read(thread_fds[e], &values[e], sizeof(values[e])) != sizeof(values[e])) {
+            values[e] = 0;
+        }
+    }
+}
+
+/**
+ * @brief Turns on measuring. Until it is called, perf_begin and perf_end do nothing.
+ *
+ * @return void: nothing
+ *
+ */
+void perf_enable(void) {
+    perf_enabled = 1;
+    enabled_at = now_nanoseconds();
+}
+
+/**
+ * @brief Marks the start of a phase on the calling thread.
+ *
+ * @param mark Filled in with the counters and time at the start.
+ * @return void: nothing
+ *
+ */
+void perf_begin(perf_mark *mark) {
+    if (!perf_enabled) {
+        return;
+    }
+    if (!thread_opened) {
+        open_thread_counters();
+    }
+    read_thread_counters(mark->values);
+    mark->started = now_nanoseconds();
+}
+
+/**
+ * @brief Marks the end of a phase on the calling thread and adds what it used to the phase totals.
+ *
+ * @param mark The mark filled in by perf_begin on the same thread.
+ * @param phase The phase that ran.
+ * @return void: nothing
+ *
+ */
+void perf_end(perf_mark *mark, perf_phase phase) {
+    long long values[PERF_EVENTS];
+
+    if (!perf_enabled) {
+        return;
+    }
+    long long elapsed = now_nanoseconds() - mark->started;
+    read_thread_counters(values);
+
+    // Phases run on many threads at once, so the totals are added atomically
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        __atomic_fetch_add(&totals[phase][e], values[e] - mark->values[e], __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&phase_nanoseconds[phase], elapsed, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&phase_calls[phase], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Counts routes read, so the report can give misses per record.
+ *
+ * @param count The number of routes read.
+ * @return void: nothing
+ *
+ */
+void perf_add_records(long count) {
+    if (perf_enabled) {
+        __atomic_fetch_add(&records, count, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Prints the time, counters, IPC and misses per record of every phase, and the routes read per second since perf_enable.
+ *
+ * @param out The stream to print to.
+ * @return void: nothing
+ *
+ */
+void perf_report(FILE *out) {
+    static const char *phase_names[PERF_PHASES] = { "ingest", "count", "merge", "output" };
+    int any = 0;
+
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        any |= event_available[e];
+    }
+    long long elapsed = now_nanoseconds() - enabled_at;
+    fprintf(out, "perf: %ld records in %.4f seconds (%.0f records/s)\n", records, elapsed / 1e9,
+            (elapsed > 0) ? records / (elapsed / 1e9) : 0.0);
+    if (!any) {
+        fprintf(out, "perf: hardware counters unavailable (perf_event_open failed); showing times only\n");
+    }
+    fprintf(out, "%-8s %6s %10s %16s %16s %6s %12s %12s %12s\n", "phase", "calls", "seconds", "cycles", "instructions",
+            "IPC", "LLC/record", "branch/record", "dTLB/record");
+
+    for (int p = 0; p < PERF_PHASES; p++) {
+        long long *t = totals[p];
+        char cycles[32] = "n/a", instructions[32] = "n/a", ipc[16] = "n/a", llc[24] = "n/a", branch[24] = "n/a";
+        char tlb[24] = "n/a";
+
+        if (event_available[PERF_CYCLES]) snprintf(cycles, sizeof(cycles), "%lld", t[PERF_CYCLES]);
+        if (event_available[PERF_INSTRUCTIONS]) snprintf(instructions, sizeof(instructions), "%lld", t[PERF_INSTRUCTIONS]);
+        if (event_available[PERF_CYCLES] && event_available[PERF_INSTRUCTIONS] && t[PERF_CYCLES] > 0) {
+            snprintf(ipc, sizeof(ipc), "%.2f", (double)t[PERF_INSTRUCTIONS] / t[PERF_CYCLES]);
+        }
+        if (event_available[PERF_LLC_MISSES] && records > 0) {
+            snprintf(llc, sizeof(llc), "%.3f", (double)t[PERF_LLC_MISSES] / records);
+        }
+        if (event_available[PERF_BRANCH_MISSES] && records > 0) {
+            snprintf(branch, sizeof(branch), "%.3f", (double)t[PERF_BRANCH_MISSES] / records);
+        }
+        if (event_available[PERF_DTLB_MISSES] && records > 0) {
+            snprintf(tlb, sizeof(tlb), "%.3f", (double)t[PERF_DTLB_MISSES] / records);
+        }
+        fprintf(out, "%-8s %6ld %10.4f %16s %16s %6s %12s %12s %12s\n", phase_names[p], phase_calls[p], phase_nanoseconds[p] / 1e9,
+                cycles, instructions, ipc, llc, branch, tlb);
+    }
+}
+
+/**
+ * @brief Closes every counter opened by any thread.
+ *
+ * @return void: nothing
+ *
+ */
+void perf_shutdown(void) {
+    pthread_mutex_lock(&fds_lock);
+    for (int i = 0; i < open_fd_count; i++) {
+        close(open_fds[i]);
+    }
+    open_fd_count = 0;
+    pthread_mutex_unlock(&fds_lock);
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+/** @file perf.h
+ *  @brief Hardware performance counters per pipeline phase, read with perf_event_open.
+ *
+ */
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdio.h>
+
+/**
+ * @brief The phases of the q1-q3 pipeline that are measured separately.
+ */
+typedef enum {
+    PERF_INGEST,    // read_yaml: parse_line and the sorted insert of every route
+    PERF_COUNT,     // make_qN_count_list: compiling the route list into counts
+    PERF_MERGE,     // qN_count_merge: combining the partial counts of the partitions
+    PERF_OUTPUT,    // qN_output_vals: selecting and writing the top N
+    PERF_PHASES
+} perf_phase;
+
+/**
+ * @brief The counters read in every phase.
+ */
+typedef enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_EVENTS
+} perf_event;
+
+/**
+ * @brief Struct representing the counter values and time at the start of a phase on one thread.
+ */
+typedef struct {
+    long long values[PERF_EVENTS];
+    long long started;      // Nanoseconds
+} perf_mark;
+
+/**
+ * Function protypes associated with the performance counters.
+ */
+void perf_enable(void);
+void perf_begin(perf_mark *mark);
+void perf_end(perf_mark *mark, perf_phase phase);
+void perf_add_records(long records);
+void perf_report(FILE *out);
+void perf_shutdown(void);
+
+#endif // PERF_H
\ No newline at end of file
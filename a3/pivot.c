@@ -0,0 +1,502 @@
+/** @file pivot.c
+ *  @brief Implementation of pivot.h
+ *
+ *  Both fields of a route are turned into dictionary IDs as the route is
+ *  read, so counting it is a single increment of a matrix cell. The matrix
+ *  is stored as PIVOT_BLOCK x PIVOT_BLOCK blocks: a new row or column only
+ *  grows the array of block pointers, and a block is only allocated once a
+ *  route falls into it.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pivot.h"
+#include "emalloc.h"
+
+#define DICTIONARY_INITIAL_SLOTS 64    // Number of slots of a fresh dictionary
+
+/**
+ * @brief Computes the FNV-1a hash of a string.
+ *
+ */
+static unsigned int hash_name(const char *str) {
+    unsigned int hash = 2166136261u;
+    while (*str != '\0') {
+        hash ^= (unsigned char)*str++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Initializes an empty dictionary.
+ *
+ */
+static void dictionary_init(dictionary *dict) {
+    dict->size = 0;
+    dict->capacity = 16;
+    dict->names = (char **)emalloc(dict->capacity * sizeof(char *));
+    dict->slot_count = DICTIONARY_INITIAL_SLOTS;
+    dict->slots = (int *)emalloc(dict->slot_count * sizeof(int));
+    memset(dict->slots, 0, dict->slot_count * sizeof(int));
+}
+
+/**
+ * @brief Finds the slot of a name: the slot holding it, or the empty slot where it belongs.
+ *
+ */
+static int *dictionary_slot(dictionary *dict, const char *name) {
+    int mask = dict->slot_count - 1;
+    int i = (int)(hash_name(name) & (unsigned int)mask);
+
+    while (dict->slots[i] != 0 && strcmp(dict->names[dict->slots[i] - 1], name) != 0) {
+        i = (i + 1) & mask;
+    }
+    return &dict->slots[i];
+}
+
+/**
+ * @brief Doubles the number of slots of a dictionary and re-inserts every name.
+ *
+ */
+static void dictionary_grow(dictionary *dict) {
+    free(dict->slots);
+    dict->slot_count *= 2;
+    dict->slots = (int *)emalloc(dict->slot_count * sizeof(int));
+    memset(dict->slots, 0, dict->slot_count * sizeof(int));
+    for (int id = 0; id < dict->size; id++) {
+        *dictionary_slot(dict, dict->names[id]) = id + 1;
+    }
+}
+
+/**
+ * @brief Returns the ID of a name, numbering it if it has not been seen before.
+ *
+ * @param dict The dictionary.
+ * @param name The name to look up.
+ * @return int The ID of the name.
+ *
+ */
+static int dictionary_id(dictionary *dict, const char *name) {
+    int *slot = dictionary_slot(dict, name);
+    if (*slot != 0) {
+        return *slot - 1;
+    }
+
+    // New name: copy it and give it the next ID
+    if (dict->size == dict->capacity) {
+        dict->capacity *= 2;
+        char **names = (char **)emalloc(dict->capacity * sizeof(char *));
+        memcpy(names, dict->names, dict->size * sizeof(char *));
+        free(dict->names);
+        dict->names = names;
+    }
+    size_t length = strlen(name) + 1;
+    dict->names[dict->size] = (char *)emalloc(length);
+    memcpy(dict->names[dict->size], name, length);
+    *slot = ++dict->size;
+
+    // Keep the load factor at or below one half
+    if (2 * dict->size > dict->slot_count) {
+        dictionary_grow(dict);
+    }
+    return dict->size - 1;
+}
+
+/**
+ * @brief Frees a dictionary and the names in it.
+ *
+ */
+static void dictionary_free(dictionary *dict) {
+    for (int id = 0; id < dict->size; id++) {
+        free(dict->names[id]);
+    }
+    free(dict->names);
+    free(dict->slots);
+}
+
+/**
+ * @brief Makes room for at least the given number of block rows and block columns, keeping
+ *        every allocated block at the same row and column.
+ *
+ */
+static void pivot_reserve(pivot_table *table, int block_rows, int block_cols) {
+    int new_rows = (table->block_rows > 0) ? table->block_rows : 1;
+    int new_cols = (table->block_cols > 0) ? table->block_cols : 1;
+    while (new_rows < block_rows) new_rows *= 2;
+    while (new_cols < block_cols) new_cols *= 2;
+
+    int **blocks = (int **)emalloc((size_t)new_rows * new_cols * sizeof(int *));
+    memset(blocks, 0, (size_t)new_rows * new_cols * sizeof(int *));
+    for (int r = 0; r < table->block_rows; r++) {
+        for (int c = 0; c < table->block_cols; c++) {
+            blocks[r * new_cols + c] = table->blocks[r * table->block_cols + c];
+        }
+    }
+    free(table->blocks);
+    table->blocks = blocks;
+    table->block_rows = new_rows;
+    table->block_cols = new_cols;
+}
+
+/**
+ * @brief Returns the cell of a row and column ID, or NULL if its block has not been allocated.
+ *
+ */
+static int *pivot_cell_at(const pivot_table *table, int row, int col) {
+    int br = row / PIVOT_BLOCK;
+    int bc = col / PIVOT_BLOCK;
+    if (br >= table->block_rows || bc >= table->block_cols) {
+        return NULL;
+    }
+    int *block = table->blocks[br * table->block_cols + bc];
+    return (block != NULL) ? &block[(row % PIVOT_BLOCK) * PIVOT_BLOCK + col % PIVOT_BLOCK] : NULL;
+}
+
+/**
+ * @brief Calls visit with every non-empty cell of a table, walking only the allocated blocks.
+ *
+ */
+static void pivot_for_each(pivot_table *table, void (*visit)(pivot_table *table, int row, int col, int count, void *ctx),
+                           void *ctx) {
+    for (int br = 0; br < table->block_rows; br++) {
+        for (int bc = 0; bc < table->block_cols; bc++) {
+            int *block = table->blocks[br * table->block_cols + bc];
+            if (block == NULL) {
+                continue;
+            }
+            for (int i = 0; i < PIVOT_BLOCK * PIVOT_BLOCK; i++) {
+                if (block[i] != 0) {
+                    visit(table, br * PIVOT_BLOCK + i / PIVOT_BLOCK, bc * PIVOT_BLOCK + i % PIVOT_BLOCK, block[i], ctx);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Initializes an empty pivot table.
+ *
+ * @param table The table to initialize.
+ * @return void: nothing
+ *
+ */
+void pivot_init(pivot_table *table) {
+    dictionary_init(&table->rows);
+    dictionary_init(&table->cols);
+    table->blocks = NULL;
+    table->block_rows = 0;
+    table->block_cols = 0;
+}
+
+/**
+ * @brief Adds amount to the cell of a row value and a column value.
+ *
+ * @param table The table.
+ * @param row The value of the row field.
+ * @param col The value of the column field.
+ * @param amount The amount to add.
+ * @return void: nothing
+ *
+ */
+void pivot_add(pivot_table *table, const char *row, const char *col, int amount) {
+    int r = dictionary_id(&table->rows, row);
+    int c = dictionary_id(&table->cols, col);
+    int br = r / PIVOT_BLOCK;
+    int bc = c / PIVOT_BLOCK;
+
+    // Grow the block array for a new row or column block, then allocate the block itself
+    if (br >= table->block_rows || bc >= table->block_cols) {
+        pivot_reserve(table, br + 1, bc + 1);
+    }
+    int **block = &table->blocks[br * table->block_cols + bc];
+    if (*block == NULL) {
+        *block = (int *)emalloc(PIVOT_BLOCK * PIVOT_BLOCK * sizeof(int));
+        memset(*block, 0, PIVOT_BLOCK * PIVOT_BLOCK * sizeof(int));
+    }
+    (*block)[(r % PIVOT_BLOCK) * PIVOT_BLOCK + c % PIVOT_BLOCK] += amount;
+}
+
+/**
+ * @brief pivot_for_each visitor adding one cell of a table into the table given as ctx.
+ *
+ */
+static void merge_cell(pivot_table *from, int row, int col, int count, void *ctx) {
+    pivot_add((pivot_table *)ctx, from->rows.names[row], from->cols.names[col], count);
+}
+
+/**
+ * @brief Adds every cell of one table into another.
+ *
+ * @param into The table that receives the counts.
+ * @param from The table whose counts are added; it is left unchanged.
+ * @return void: nothing
+ *
+ */
+void pivot_merge(pivot_table *into, pivot_table *from) {
+    pivot_for_each(from, merge_cell, into);
+}
+
+/**
+ * @brief Struct representing the cells gathered by pivot_cells.
+ */
+typedef struct {
+    pivot_cell *cells;
+    int size;
+    int capacity;
+} cell_list;
+
+/**
+ * @brief pivot_for_each visitor appending one cell to the cell_list given as ctx.
+ *
+ */
+static void collect_cell(pivot_table *table, int row, int col, int count, void *ctx) {
+    cell_list *list = (cell_list *)ctx;
+    if (list->size == list->capacity) {
+        list->capacity *= 2;
+        pivot_cell *grown = (pivot_cell *)emalloc(list->capacity * sizeof(pivot_cell));
+        memcpy(grown, list->cells, list->size * sizeof(pivot_cell));
+        free(list->cells);
+        list->cells = grown;
+    }
+    list->cells[list->size].row = table->rows.names[row];
+    list->cells[list->size].col = table->cols.names[col];
+    list->cells[list->size].count = count;
+    list->size++;
+}
+
+/**
+ * @brief Collects the non-empty cells of a table.
+ *
+ * @param table The table.
+ * @param count Set to the number of cells.
+ * @return pivot_cell* A new array of the cells, to be freed by the caller.
+ *
+ */
+pivot_cell *pivot_cells(pivot_table *table, int *count) {
+    cell_list list = { (pivot_cell *)emalloc(64 * sizeof(pivot_cell)), 0, 64 };
+
+    pivot_for_each(table, collect_cell, &list);
+    *count = list.size;
+    return list.cells;
+}
+
+/**
+ * @brief qsort comparator ranking cells by the highest count, then by row and column name.
+ *
+ */
+static int compare_cells(const void *a, const void *b) {
+    const pivot_cell *x = (const pivot_cell *)a;
+    const pivot_cell *y = (const pivot_cell *)b;
+    if (x->count != y->count) {
+        return (x->count > y->count) ? -1 : 1;
+    }
+    int cmp = strcmp(x->row, y->row);
+    return (cmp != 0) ? cmp : strcmp(x->col, y->col);
+}
+
+static const dictionary *sort_dictionary;  // The dictionary whose IDs compare_ids is sorting
+
+/**
+ * @brief qsort comparator ordering the IDs of sort_dictionary by name.
+ *
+ */
+static int compare_ids(const void *a, const void *b) {
+    return strcmp(sort_dictionary->names[*(const int *)a], sort_dictionary->names[*(const int *)b]);
+}
+
+/**
+ * @brief Returns the IDs of a dictionary sorted by name.
+ *
+ */
+static int *sorted_ids(const dictionary *dict) {
+    int *ids = (int *)emalloc((dict->size > 0 ? dict->size : 1) * sizeof(int));
+    for (int id = 0; id < dict->size; id++) {
+        ids[id] = id;
+    }
+    sort_dictionary = dict;
+    qsort(ids, dict->size, sizeof(int), compare_ids);
+    return ids;
+}
+
+/**
+ * @brief Writes the full matrix as csv: a header of the column values, then one line per row value.
+ *        Rows and columns are in name order.
+ *
+ * @param table The table.
+ * @param file The file to write to.
+ * @param corner The text of the top left cell, such as "airline_icao_unique_code\to_airport_country".
+ * @return void: nothing
+ *
+ */
+void pivot_write_matrix(pivot_table *table, FILE *file, const char *corner) {
+    int *rows = sorted_ids(&table->rows);
+    int *cols = sorted_ids(&table->cols);
+
+    fprintf(file, "%s", corner);
+    for (int c = 0; c < table->cols.size; c++) {
+        fprintf(file, ",%s", table->cols.names[cols[c]]);
+    }
+    fprintf(file, "\n");
+
+    for (int r = 0; r < table->rows.size; r++) {
+        fprintf(file, "%s", table->rows.names[rows[r]]);
+        for (int c = 0; c < table->cols.size; c++) {
+            int *cell = pivot_cell_at(table, rows[r], cols[c]);
+            fprintf(file, ",%d", (cell != NULL) ? *cell : 0);
+        }
+        fprintf(file, "\n");
+    }
+
+    free(rows);
+    free(cols);
+}
+
+/**
+ * @brief Collects the non-empty cells of a table ranked by the highest count, then by row and column name.
+ *
+ * @param table The table.
+ * @param count Set to the number of cells.
+ * @return pivot_cell* A new array of the cells, to be freed by the caller.
+ *
+ */
+pivot_cell *pivot_ranked_cells(pivot_table *table, int *count) {
+    pivot_cell *cells = pivot_cells(table, count);
+
+    qsort(cells, *count, sizeof(pivot_cell), compare_cells);
+    return cells;
+}
+
+/**
+ * @brief Writes the n cells with the highest counts as csv lines of "row,column,count".
+ *
+ * @param table The table.
+ * @param file The file to write to.
+ * @param n The number of cells to write.
+ * @return void: nothing
+ *
+ */
+void pivot_write_top(pivot_table *table, FILE *file, int n) {
+    int count;
+    pivot_cell *cells = pivot_ranked_cells(table, &count);
+
+    for (int i = 0; i < count && i < n; i++) {
+        fprintf(file, "%s,%s,%d\n", cells[i].row, cells[i].col, cells[i].count);
+    }
+    free(cells);
+}
+
+/**
+ * @brief Struct representing the bounded heaps of pivot_write_top_per_row: the n best cells seen so far
+ *        in every row, with the worst of them at the root.
+ */
+typedef struct {
+    pivot_cell *cells;      // n cells for each row
+    int *sizes;             // Cells held by the heap of each row
+    int n;
+} row_heaps;
+
+/**
+ * @brief Returns 1 if cell x ranks below cell y.
+ *
+ */
+static int cell_worse(const pivot_cell *x, const pivot_cell *y) {
+    return compare_cells(x, y) > 0;
+}
+
+/**
+ * @brief Offers a cell to the heap of its row, keeping only the n best.
+ *
+ */
+static void offer_cell(pivot_table *table, int row, int col, int count, void *ctx) {
+    row_heaps *heaps = (row_heaps *)ctx;
+    pivot_cell *heap = heaps->cells + (size_t)row * heaps->n;
+    int size = heaps->sizes[row];
+    pivot_cell cell = { table->rows.names[row], table->cols.names[col], count };
+    pivot_cell temp;
+    int i;
+
+    if (size < heaps->n) {
+        // Room left: sift the cell up past the better cells
+        i = size;
+        heap[i] = cell;
+        while (i > 0 && cell_worse(&heap[i], &heap[(i - 1) / 2])) {
+            temp = heap[i];
+            heap[i] = heap[(i - 1) / 2];
+            heap[(i - 1) / 2] = temp;
+            i = (i - 1) / 2;
+        }
+        heaps->sizes[row]++;
+    } else if (heaps->n > 0 && cell_worse(&heap[0], &cell)) {
+        // Replace the worst cell and sift the new one down below the worse cells
+        heap[0] = cell;
+        i = 0;
+        for (;;) {
+            int worst = i;
+            int left = 2 * i + 1, right = 2 * i + 2;
+            if (left < size && cell_worse(&heap[left], &heap[worst])) worst = left;
+            if (right < size && cell_worse(&heap[right], &heap[worst])) worst = right;
+            if (worst == i) {
+                break;
+            }
+            temp = heap[i];
+            heap[i] = heap[worst];
+            heap[worst] = temp;
+            i = worst;
+        }
+    }
+}
+
+/**
+ * @brief Writes the n cells with the highest counts in every row as csv lines of "\"row, column\",count".
+ *        Rows are in name order; the cells of a row are ranked by count, then by column name. Each row
+ *        only keeps a heap of its n best cells, so memory is bounded by n times the number of rows.
+ *
+ * @param table The table.
+ * @param file The file to write to.
+ * @param n The number of cells to write for every row.
+ * @return void: nothing
+ *
+ */
+void pivot_write_top_per_row(pivot_table *table, FILE *file, int n) {
+    int rows = table->rows.size;
+    row_heaps heaps;
+
+    heaps.n = (n > 0) ? n : 0;
+    heaps.cells = (pivot_cell *)emalloc(((size_t)rows * heaps.n + 1) * sizeof(pivot_cell));
+    heaps.sizes = (int *)emalloc((rows + 1) * sizeof(int));
+    memset(heaps.sizes, 0, (rows + 1) * sizeof(int));
+
+    // Fill the heaps in one walk over the cells
+    pivot_for_each(table, offer_cell, &heaps);
+
+    int *order = sorted_ids(&table->rows);
+    for (int r = 0; r < rows; r++) {
+        pivot_cell *heap = heaps.cells + (size_t)order[r] * heaps.n;
+        qsort(heap, heaps.sizes[order[r]], sizeof(pivot_cell), compare_cells);
+        for (int i = 0; i < heaps.sizes[order[r]]; i++) {
+            fprintf(file, "\"%s, %s\",%d\n", heap[i].row, heap[i].col, heap[i].count);
+        }
+    }
+
+    free(order);
+    free(heaps.cells);
+    free(heaps.sizes);
+}
+
+/**
+ * @brief Frees a pivot table.
+ *
+ * @param table The table to free.
+ * @return void: nothing
+ *
+ */
+void pivot_free(pivot_table *table) {
+    for (int i = 0; i < table->block_rows * table->block_cols; i++) {
+        free(table->blocks[i]);
+    }
+    free(table->blocks);
+    dictionary_free(&table->rows);
+    dictionary_free(&table->cols);
+}
\ No newline at end of file
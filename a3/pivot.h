@@ -0,0 +1,68 @@
+/** @file pivot.h
+ *  @brief Cross-tabulation of routes by two fields into a blocked 2D count matrix.
+ *
+ */
+#ifndef PIVOT_H
+#define PIVOT_H
+
+#include <stdio.h>
+
+#define PIVOT_BLOCK 64      // Rows and columns covered by one block of the matrix
+
+/**
+ * @brief Struct representing a dictionary that numbers the distinct values of one field in the
+ *        order they are first seen.
+ */
+typedef struct {
+    char **names;           // names[id] is the value numbered id
+    int size;
+    int capacity;
+    int *slots;             // Open-addressing hash table of id + 1, 0 for an empty slot
+    int slot_count;         // Number of slots (a power of two)
+} dictionary;
+
+/**
+ * @brief Struct representing a pivot table. Cell (row, column) lives in block
+ *        (row / PIVOT_BLOCK) * block_cols + column / PIVOT_BLOCK, which is only allocated once a
+ *        route falls in it, so sparse tables only pay for the blocks they use.
+ */
+typedef struct {
+    dictionary rows;
+    dictionary cols;
+    int **blocks;           // block_rows x block_cols pointers to PIVOT_BLOCK x PIVOT_BLOCK counts
+    int block_rows;
+    int block_cols;
+} pivot_table;
+
+/**
+ * @brief What pivot_answer writes from a pivot table.
+ */
+typedef enum {
+    PIVOT_TOP_CELLS,        // The n cells with the most routes
+    PIVOT_FULL_MATRIX,      // The whole matrix, with --PIVOT_MATRIX
+    PIVOT_TOP_PER_ROW       // The n cells with the most routes in every row, with --GROUP_TOP=
+} pivot_output;
+
+/**
+ * @brief Struct representing one non-empty cell of a pivot table.
+ */
+typedef struct {
+    const char *row;        // Points into the row dictionary
+    const char *col;        // Points into the column dictionary
+    int count;
+} pivot_cell;
+
+/**
+ * Function protypes associated with the pivot table.
+ */
+void pivot_init(pivot_table *table);
+void pivot_add(pivot_table *table, const char *row, const char *col, int amount);
+void pivot_merge(pivot_table *into, pivot_table *from);
+pivot_cell *pivot_cells(pivot_table *table, int *count);
+pivot_cell *pivot_ranked_cells(pivot_table *table, int *count);
+void pivot_write_matrix(pivot_table *table, FILE *file, const char *corner);
+void pivot_write_top(pivot_table *table, FILE *file, int n);
+void pivot_write_top_per_row(pivot_table *table, FILE *file, int n);
+void pivot_free(pivot_table *table);
+
+#endif // PIVOT_H
\ No newline at end of file
@@ -0,0 +1,109 @@
+/** @file query.c
+ *  @brief Implementation of query.h
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "query.h"
+#include "count.h"
+
+/**
+ * @brief Sets of the route fields read by the questions, for parse_line to skip the others.
+ *        The counted fields come from the count tables; q1 also filters on the destination country.
+ */
+#define ROUTE_FIELD_OR(name) | ROUTE_FIELD_BIT(name)
+#define Q1_ROUTE_FIELDS (0 Q1_COUNT_FIELDS(ROUTE_FIELD_OR) | ROUTE_FIELD_BIT(to_airport_country))
+#define Q2_ROUTE_FIELDS (0 Q2_COUNT_FIELDS(ROUTE_FIELD_OR))
+#define Q3_ROUTE_FIELDS (0 Q3_COUNT_FIELDS(ROUTE_FIELD_OR))
+#define Q4_ROUTE_FIELDS (ROUTE_FIELD_BIT(to_airport_country) | ROUTE_FIELD_BIT(to_airport_altitude))
+
+/**
+ * @brief this function returns the route fields a question reads
+ *
+ * @param question the question number that is being answered
+ * @return route_fields the fields; every field for an unknown question
+ *
+ */
+route_fields question_fields(int question) {
+    switch (question) {
+        case 1: return Q1_ROUTE_FIELDS;
+        case 2: return Q2_ROUTE_FIELDS;
+        case 3: return Q3_ROUTE_FIELDS;
+        case 4: return Q4_ROUTE_FIELDS;
+        default: return ROUTE_ALL_FIELDS;
+    }
+}
+
+/**
+ * @brief this function finds the group of a route for questions 1 to 3, with the same subject the
+ *        in-memory path writes to output.csv. The route has already passed the question's filter.
+ *
+ * @param route the parsed route
+ * @param question the question number that is being answered
+ * @param key set to the group identity
+ * @param tie set to what orders groups with equal counts before the key does
+ * @param label filled in with the subject; at least ROUTE_LABEL_SIZE bytes
+ * @return int 1: The route belongs to a group; 0: The question does not use the route.
+ *
+ */
+int route_group(Route *route, int question, const char **key, const char **tie, char *label) {
+    size_t size = ROUTE_LABEL_SIZE;
+
+    if (question == 1) {
+        snprintf(label, size, "%s (%s)", route->airline_name, route->airline_icao_unique_code);
+        *key = route->airline_name;
+        *tie = "";
+    } else if (question == 2) {
+        snprintf(label, size, "%s", route->to_airport_country);
+        *key = route->to_airport_country;
+        *tie = "";
+    } else if (question == 3) {
+        snprintf(label, size, "\"%s (%s), %s, %s\"", route->to_airport_name, route->to_airport_icao_unique_code,
+                                                     route->to_airport_city, route->to_airport_country);
+        // Ties rank like the q3 count list: by country, then by descending airport name
+        *key = route->to_airport_name;
+        *tie = route->to_airport_country;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief this function bounds the number of groups in the input files: every route takes more than
+ *        256 bytes of yaml, so there cannot be more groups than that
+ *
+ * @param data_files the yaml files full of airline route information
+ * @return size_t the bound
+ *
+ */
+size_t max_groups(const glob_t *data_files) {
+    size_t total_bytes = 0;
+    struct stat st;
+
+    for (size_t i = 0; i < data_files->gl_pathc; i++) {
+        if (stat(data_files->gl_pathv[i], &st) == 0) {
+            total_bytes += st.st_size;
+        }
+    }
+    return total_bytes / 256 + 1;
+}
+
+/**
+ * @brief this function builds the filter of a question: the --WHERE= predicates and, for q1, the
+ *        destination country the question is about
+ *
+ * @param question the question number that is being answered
+ * @param where the predicates given on the command line
+ * @param filter filled in with the predicates every counted route must pass
+ * @return void: nothing
+ *
+ */
+void question_filter(int question, const route_filter *where, route_filter *filter) {
+    *filter = *where;
+    if (question == 1) {
+        // Always fits: the --WHERE= predicates leave the question's slot free
+        filter_add_question(filter, "to_airport_country=Canada");
+    }
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+/** @file query.h
+ *  @brief What each question reads, filters on and groups by, shared by the CLI and the library.
+ *
+ */
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <glob.h>
+#include "route.h"
+#include "filter.h"
+
+#define ROUTE_LABEL_SIZE (4 * BUFFER_SIZE + 16)    // Longest subject route_group writes
+
+/**
+ * Function protypes associated with the questions.
+ */
+route_fields question_fields(int question);
+void question_filter(int question, const route_filter *where, route_filter *filter);
+int route_group(Route *route, int question, const char **key, const char **tie, char *label);
+size_t max_groups(const glob_t *data_files);
+
+#endif // QUERY_H
\ No newline at end of file
@@ -0,0 +1,338 @@
+/** @file reader.c
+ *  @brief Implementation of reader.h
+ *
+ *  The reader holds one route at a time and keeps no state between calls,
+ *  so any number of threads can read files at once.
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "reader.h"
+#include "altitude.h"
+
+/**
+ * @brief this function trims leading whitespace
+ * @param str the string to trim
+ * @return char *: the trimmed string
+ *
+ */
+char *trim_leading_spaces(char *str) {
+    while (*str == ' ') str++;
+    return str;
+}
+
+/**
+ * @brief this function normalizes a yaml value in place in a single pass: it drops the surrounding quotes
+ *        (turning '' back into ' inside single quotes), trims spaces inside and outside the quotes, and stops
+ *        at the end of the line, so values such as ' Sheffield' need no later fixup or allocation
+ *
+ * @param value the raw value text following the key's colon
+ * @return char *: the normalized value, terminated inside the original buffer
+ *
+ */
+char *normalize_value(char *value) {
+    char quote = '\0';
+
+    // Skip leading spaces and an opening quote, then the spaces inside the quote
+    value = trim_leading_spaces(value);
+    if (*value == '\'' || *value == '"') {
+        quote = *value++;
+        value = trim_leading_spaces(value);
+    }
+
+    // Copy the value down over escaped quotes, remembering where the last non-space character ended
+    char *read = value;
+    char *write = value;
+    char *end = value;
+    while (*read != '\0' && *read != '\n' && *read != '\r') {
+        if (quote != '\0' && *read == quote) {
+            if (quote == '\'' && read[1] == '\'') {
+                // '' is an escaped single quote
+                read++;
+            } else {
+                // Closing quote: the rest of the line is ignored
+                break;
+            }
+        }
+        *write = *read++;
+        if (*write++ != ' ') {
+            end = write;
+        }
+    }
+
+    // Terminate after the last non-space character
+    *end = '\0';
+    return value;
+}
+
+/**
+ * @brief Conversions run by parse_line after a field of the route table has been copied.
+ *        The altitudes are converted once here so aggregations never re-parse the string.
+ */
+#define ROUTE_FIELD_KEEP(route, value)
+#define ROUTE_FIELD_FROM_ALTITUDE(route, value) { \
+    int valid; \
+    (route)->from_altitude = parse_altitude(value, &valid); \
+    if (valid) (route)->altitude_flags |= FROM_ALTITUDE_VALID; \
+}
+#define ROUTE_FIELD_TO_ALTITUDE(route, value) { \
+    int valid; \
+    (route)->to_altitude = parse_altitude(value, &valid); \
+    if (valid) (route)->altitude_flags |= TO_ALTITUDE_VALID; \
+}
+
+/**
+ * @brief One branch of the key dispatch in parse_line, generated for every field of the route table.
+ *        A field the query does not use is left empty, and its value is neither normalized nor copied.
+ */
+#define PARSE_ROUTE_FIELD(name, convert) \
+        if (strcmp(key, #name) == 0) { \
+            if (!(fields & ROUTE_FIELD_BIT(name))) { \
+                return 0; \
+            } \
+            value = normalize_value(value); \
+            strncpy(route->name, value, sizeof(route->name) - 1); \
+            convert(route, value) \
+            return ROUTE_FIELD_BIT(name); \
+        }
+
+/**
+ * @brief this function parses each line of the yaml file, assigning variables to respective fields
+ *
+ * @param line the current line of the yaml file for tokenization
+ * @param route route struct instance used to fill its feilds
+ * @param fields the fields the query uses; the values of the other keys are skipped
+ * @return route_fields the bit of the field filled in, or 0 if the line filled in none
+ *
+ */
+route_fields parse_line(char *line, Route *route, route_fields fields) {
+    // The key ends at the first colon; any later colon belongs to the value
+    char *key = trim_leading_spaces(line);
+    char *value = strchr(key, ':');
+
+    // Check if the line has a key and a value
+    if (value != NULL) {
+        // Terminate the key; the value is only normalized once the key is known to be wanted
+        *value++ = '\0';
+
+        // The first key of a route carries the list marker
+        if (key[0] == '-' && key[1] == ' ') {
+            key += 2;
+        }
+
+        // Compare key and copy the value of a wanted key to the corresponding field in the Route structure
+        ROUTE_STRING_FIELDS(PARSE_ROUTE_FIELD)
+    }
+    return 0;
+}
+
+/**
+ * @brief this function parses one line of a route and checks the filter on the field it filled in as soon as
+ *        it has been read, so a rejected route can skip the rest of its lines
+ *
+ * @param line the current line of the yaml file
+ * @param route the route being parsed
+ * @param fields the fields the query uses, and the filter tests
+ * @param filter the predicates the route must pass
+ * @param pending the filtered fields the route has not had yet; the field filled in is cleared from it
+ * @return int 1: The route may still pass; 0: The route is rejected.
+ *
+ */
+int parse_filtered_line(char *line, Route *route, route_fields fields, const route_filter *filter, route_fields *pending) {
+    route_fields read = parse_line(line, route, fields);
+    *pending &= ~read;
+    return filter_accepts(filter, read, route);
+}
+
+/**
+ * @brief Struct representing the route being read and what is handed over, shared by the readers of whole
+ *        files and of blocks, so both find the routes and apply the filter the same way.
+ */
+typedef struct {
+    Route route;
+    int has_route;              // Flag to check if a route has been started
+    int accepted;               // Flag to check if the route may still pass the filter
+    route_fields pending;       // Filtered fields the route has not had yet
+    unsigned long long fingerprint; // Of the route's lines so far, when dropping repeats
+    long routes;                // Number of routes read, handed over or not
+    route_fields fields;        // The fields the query uses, and the filter tests
+    const route_filter *filter;
+    void (*visit)(Route *route, void *ctx);
+    void *ctx;
+} route_reader;
+
+/**
+ * @brief Starts a reader with no route read yet.
+ *
+ */
+static void reader_init(route_reader *reader, route_fields fields, const route_filter *filter,
+                        void (*visit)(Route *route, void *ctx), void *ctx) {
+    memset(&reader->route, 0, sizeof(Route));
+    reader->has_route = 0;
+    reader->accepted = 0;
+    reader->pending = 0;
+    reader->fingerprint = DEDUP_SEED;
+    reader->routes = 0;
+    reader->fields = fields | filter->fields;
+    reader->filter = filter;
+    reader->visit = visit;
+    reader->ctx = ctx;
+}
+
+/**
+ * @brief Returns whether a line is the first line of a route.
+ *
+ */
+static int reader_starts_route(const char *line) {
+    return strstr(line, "- airline_name") != NULL;
+}
+
+/**
+ * @brief Hands over the route being read if it passed the filter, then forgets it; fields it never had are
+ *        checked as empty.
+ *
+ */
+static void reader_end_route(route_reader *reader) {
+    if (reader->has_route && reader->accepted && filter_accepts(reader->filter, reader->pending, &reader->route)
+        && dedup_first(reader->filter->dedup, reader->fingerprint)) {
+        reader->visit(&reader->route, reader->ctx);
+    }
+    reader->has_route = 0;
+    reader->accepted = 0;
+}
+
+/**
+ * @brief Reads one line: a new route hands over the previous one, and a line of a route the filter has not
+ *        rejected is parsed into it.
+ *
+ */
+static void reader_line(route_reader *reader, char *line) {
+    if (reader_starts_route(line)) {
+        reader_end_route(reader);
+        reader->has_route = 1;
+        reader->routes++;
+        reader->accepted = 1;
+        reader->pending = reader->filter->fields;
+        reader->fingerprint = DEDUP_SEED;
+
+        // Reset the Route instance for the new route
+        memset(&reader->route, 0, sizeof(Route));
+    }
+    // Parse the line into the current route, unless the filter has rejected it
+    if (reader->accepted) {
+        // Fingerprint the line before parse_line edits it
+        if (reader->filter->dedup != NULL) {
+            reader->fingerprint = dedup_line(reader->fingerprint, line);
+        }
+        reader->accepted = parse_filtered_line(line, &reader->route, reader->fields, reader->filter, &reader->pending);
+    }
+}
+
+/**
+ * @brief this function reads the yaml file containing routes of airplanes, and passes each route to a visitor
+ *        as soon as it has been parsed, without keeping the routes in memory
+ *
+ * @param data_file the yaml file containing routes of airplanes
+ * @param fields the route fields to parse; the others are left empty
+ * @param filter the predicates a route must pass to be handed over; the rest of a rejected route is not parsed,
+ *        and with filter->dedup set only the first of identical routes is handed over
+ * @param visit the function called with every route
+ * @param ctx passed through to visit
+ * @return long The number of routes read, whether or not they were handed over, or -1 if the file could
+ *         not be opened.
+ *
+ */
+long read_yaml_records(const char *data_file, route_fields fields, const route_filter *filter,
+                      void (*visit)(Route *route, void *ctx), void *ctx) {
+    char line[256];
+    route_reader reader;
+
+    // Open the file in read mode
+    FILE *file = fopen(data_file, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file\n");
+        return -1;
+    }
+    reader_init(&reader, fields, filter, visit, ctx);
+
+    // Skip the first line (header or initial content), then read each line from the file and parse it
+    if (fgets(line, sizeof(line), file)) {
+        while (fgets(line, sizeof(line), file)) {
+            reader_line(&reader, line);
+        }
+    }
+
+    // Hand over the last route
+    reader_end_route(&reader);
+
+    // Close the file
+    fclose(file);
+    return reader.routes;
+}
+
+/**
+ * @brief this function reads the routes of the block_size sized blocks of a yaml file that choose picks, and
+ *        passes every route that starts inside a picked block to a visitor, finishing the last one past the end
+ *        of the block. The other blocks are never read. The blocks are found from the size of the file, so it
+ *        must be a regular file rather than a pipe.
+ *
+ * @param data_file the yaml file containing routes of airplanes
+ * @param block_size the bytes of yaml in one block
+ * @param choose called once per block, in order, with ctx; 1 to read the block, 0 to skip it
+ * @param fields the route fields to parse; the others are left empty
+ * @param filter the predicates a route must pass to be handed over, as with read_yaml_records
+ * @param visit the function called with every route
+ * @param ctx passed through to choose and visit
+ * @return long The number of routes read in the picked blocks, or -1 if the file could not be opened or is
+ *         not a regular file.
+ *
+ */
+long read_yaml_blocks(const char *data_file, long block_size, int (*choose)(void *ctx), route_fields fields,
+                      const route_filter *filter, void (*visit)(Route *route, void *ctx), void *ctx) {
+    char line[256];
+    route_reader reader;
+    struct stat st;
+
+    FILE *file = fopen(data_file, "r");
+    if (file == NULL || fstat(fileno(file), &st) != 0) {
+        fprintf(stderr, "Could not open file\n");
+        if (file != NULL) fclose(file);
+        return -1;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        fprintf(stderr, "Error: %s is not a regular file, so its blocks cannot be sampled\n", data_file);
+        fclose(file);
+        return -1;
+    }
+    reader_init(&reader, fields, filter, visit, ctx);
+
+    long blocks = ((long)st.st_size + block_size - 1) / block_size;
+    for (long b = 0; b < blocks; b++) {
+        if (!choose(ctx)) {
+            continue;
+        }
+        long offset = b * block_size;
+        long end = offset + block_size;
+
+        // Move to the first line that starts inside the block
+        fseek(file, (offset > 0) ? offset - 1 : 0, SEEK_SET);
+        if (offset > 0 && fgetc(file) != '\n' && fgets(line, sizeof(line), file) != NULL) {
+            offset += strlen(line);
+        }
+
+        // Read the routes that start inside the block, finishing the last one past its end
+        while (fgets(line, sizeof(line), file)) {
+            if (offset >= end && reader_starts_route(line)) {
+                break;
+            }
+            // parse_line edits the line in place, so measure it first
+            offset += strlen(line);
+            reader_line(&reader, line);
+        }
+        reader_end_route(&reader);
+    }
+
+    fclose(file);
+    return reader.routes;
+}
\ No newline at end of file
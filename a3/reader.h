@@ -0,0 +1,23 @@
+/** @file reader.h
+ *  @brief Streaming reader of the routes in a yaml file, parsing only the fields a query uses.
+ *
+ */
+#ifndef READER_H
+#define READER_H
+
+#include "route.h"
+#include "filter.h"
+
+/**
+ * Function protypes associated with reading routes.
+ */
+char *trim_leading_spaces(char *str);
+char *normalize_value(char *value);
+route_fields parse_line(char *line, Route *route, route_fields fields);
+int parse_filtered_line(char *line, Route *route, route_fields fields, const route_filter *filter, route_fields *pending);
+long read_yaml_records(const char *data_file, route_fields fields, const route_filter *filter,
+                       void (*visit)(Route *route, void *ctx), void *ctx);
+long read_yaml_blocks(const char *data_file, long block_size, int (*choose)(void *ctx), route_fields fields,
+                      const route_filter *filter, void (*visit)(Route *route, void *ctx), void *ctx);
+
+#endif // READER_H
\ No newline at end of file
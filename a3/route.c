@@ -0,0 +1,54 @@
+/** @file route.c
+ *  @brief Lookup of the route fields by name, for queries that pick their fields at run time.
+ *
+ */
+#include <stddef.h>
+#include <string.h>
+#include "route.h"
+
+/**
+ * @brief Struct representing one entry of the field name table.
+ */
+typedef struct {
+    const char *name;
+    size_t offset;
+    route_fields bit;
+} route_field_entry;
+
+#define ROUTE_FIELD_ENTRY(name, convert) { #name, offsetof(Route, name), ROUTE_FIELD_BIT(name) },
+
+static const route_field_entry route_field_table[] = {
+    ROUTE_STRING_FIELDS(ROUTE_FIELD_ENTRY)
+};
+
+/**
+ * @brief Finds the byte offset of a string field of Route from its name, such as "to_airport_country".
+ *
+ * @param name The field name, as written in the yaml file.
+ * @return size_t The offset of the field, or ROUTE_FIELD_NONE if no field has that name.
+ *
+ */
+size_t route_field_offset(const char *name) {
+    for (size_t i = 0; i < sizeof(route_field_table) / sizeof(route_field_table[0]); i++) {
+        if (strcmp(route_field_table[i].name, name) == 0) {
+            return route_field_table[i].offset;
+        }
+    }
+    return ROUTE_FIELD_NONE;
+}
+
+/**
+ * @brief Finds the bit of a string field of Route in a route_fields mask from its name.
+ *
+ * @param name The field name, as written in the yaml file.
+ * @return route_fields The bit of the field, or 0 if no field has that name.
+ *
+ */
+route_fields route_field_mask(const char *name) {
+    for (size_t i = 0; i < sizeof(route_field_table) / sizeof(route_field_table[0]); i++) {
+        if (strcmp(route_field_table[i].name, name) == 0) {
+            return route_field_table[i].bit;
+        }
+    }
+    return 0;
+}
\ No newline at end of file
@@ -1,26 +1,79 @@
-// route.h
-#ifndef ROUTE_H
-#define ROUTE_H
-
-#define BUFFER_SIZE 256
-
-/**
- * @brief Struct representing an airline route.
- */
-typedef struct {
-    char airline_name[BUFFER_SIZE];
-    char airline_icao_unique_code[BUFFER_SIZE];
-    char airline_country[BUFFER_SIZE];
-    char from_airport_name[BUFFER_SIZE];
-    char from_airport_city[BUFFER_SIZE];
-    char from_airport_country[BUFFER_SIZE];
-    char from_airport_icao_unique_code[BUFFER_SIZE];
-    char from_airport_altitude[BUFFER_SIZE];
-    char to_airport_name[BUFFER_SIZE];
-    char to_airport_city[BUFFER_SIZE];
-    char to_airport_country[BUFFER_SIZE];
-    char to_airport_icao_unique_code[BUFFER_SIZE];
-    char to_airport_altitude[BUFFER_SIZE];
-} Route;
-
+// route.h
+#ifndef ROUTE_H
+#define ROUTE_H
+
+#include <string.h>
+
+#define BUFFER_SIZE 256
+
+/**
+ * @brief Table of every string field of a route, in yaml order. Each entry names the field and the
+ *        conversion run on its value after it has been copied in (ROUTE_FIELD_KEEP for none).
+ *        The Route struct, the yaml parser and the per-field comparators are all generated from
+ *        this table, so a new field only needs a line here.
+ */
+#define ROUTE_STRING_FIELDS(X) \
+    X(airline_name, ROUTE_FIELD_KEEP) \
+    X(airline_icao_unique_code, ROUTE_FIELD_KEEP) \
+    X(airline_country, ROUTE_FIELD_KEEP) \
+    X(from_airport_name, ROUTE_FIELD_KEEP) \
+    X(from_airport_city, ROUTE_FIELD_KEEP) \
+    X(from_airport_country, ROUTE_FIELD_KEEP) \
+    X(from_airport_icao_unique_code, ROUTE_FIELD_KEEP) \
+    X(from_airport_altitude, ROUTE_FIELD_FROM_ALTITUDE) \
+    X(to_airport_name, ROUTE_FIELD_KEEP) \
+    X(to_airport_city, ROUTE_FIELD_KEEP) \
+    X(to_airport_country, ROUTE_FIELD_KEEP) \
+    X(to_airport_icao_unique_code, ROUTE_FIELD_KEEP) \
+    X(to_airport_altitude, ROUTE_FIELD_TO_ALTITUDE)
+
+#define ROUTE_FIELD_MEMBER(name, convert) char name[BUFFER_SIZE];
+
+/**
+ * @brief The position of every field in the route table, so a set of fields fits in one route_fields mask.
+ */
+#define ROUTE_FIELD_ID(name, convert) ROUTE_FIELD_ID_##name,
+typedef enum {
+    ROUTE_STRING_FIELDS(ROUTE_FIELD_ID)
+    ROUTE_FIELD_COUNT
+} route_field_id;
+
+typedef unsigned int route_fields;     // A set of fields of the route table, one bit per field
+
+#define ROUTE_FIELD_BIT(name) ((route_fields)1 << ROUTE_FIELD_ID_##name)
+#define ROUTE_ALL_FIELDS (((route_fields)1 << ROUTE_FIELD_COUNT) - 1)
+
+/**
+ * @brief Struct representing an airline route.
+ */
+typedef struct {
+    ROUTE_STRING_FIELDS(ROUTE_FIELD_MEMBER)
+    float from_altitude;   // from_airport_altitude parsed at ingest
+    float to_altitude;     // to_airport_altitude parsed at ingest
+    int altitude_flags;    // FROM_ALTITUDE_VALID / TO_ALTITUDE_VALID bits from altitude.h
+} Route;
+
+/**
+ * @brief Generates route_compare_<field>(a, b), which orders two routes by one field with strcmp.
+ *        The field is fixed at compile time, so the comparison inlines into its caller.
+ */
+#define ROUTE_FIELD_COMPARE(name, convert) \
+    static inline int route_compare_##name(const Route *a, const Route *b) { \
+        return strcmp(a->name, b->name); \
+    }
+ROUTE_STRING_FIELDS(ROUTE_FIELD_COMPARE)
+
+#define ROUTE_FIELD_NONE ((size_t)-1)   // Returned by route_field_offset for an unknown field name
+
+/**
+ * @brief The value of the string field at a byte offset returned by route_field_offset.
+ */
+#define ROUTE_FIELD_VALUE(route, offset) ((const char *)(route) + (offset))
+
+/**
+ * Function protypes associated with a route.
+ */
+size_t route_field_offset(const char *name);
+route_fields route_field_mask(const char *name);
+
 #endif // ROUTE_H
\ No newline at end of file
@@ -0,0 +1,351 @@
+/** @file route_index.c
+ *  @brief Implementation of route_index.h
+ *
+ *  Both tables use linear probing on a 64-bit FNV-1a hash of the key and
+ *  double when they are half full, so a lookup touches O(1) slots. Once
+ *  the index is built, a Bloom filter sized for its keys is set from the
+ *  stored hashes; a lookup whose bits are not all set is answered 0
+ *  without probing. The index file is the header, the two slot arrays,
+ *  the keys and the Bloom filter, written as they are in memory.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "route_index.h"
+#include "emalloc.h"
+
+#define INDEX_MAGIC 0x31584449544f52ULL    // "ROTIDX1"
+#define INDEX_KEY_SIZE 1024                 // Longest "airline\tfrom\tto" key
+
+/**
+ * @brief Struct representing the header of an index file.
+ */
+typedef struct {
+    unsigned long long magic;
+    unsigned long long fingerprint;
+    unsigned long long route_capacity, route_size;
+    unsigned long long pair_capacity, pair_size;
+    unsigned long long keys_size;
+    unsigned long long bloom_bits;
+} index_header;
+
+/**
+ * @brief Adds bytes to a 64-bit FNV-1a hash.
+ *
+ */
+static unsigned long long hash_bytes(unsigned long long hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Writes the key of a route into key and returns its hash.
+ *
+ */
+static unsigned long long make_key(char *key, const char *airline, const char *from, const char *to) {
+    int length = snprintf(key, INDEX_KEY_SIZE, "%s\t%s\t%s", airline, from, to);
+    if (length >= INDEX_KEY_SIZE) {
+        length = INDEX_KEY_SIZE - 1;
+    }
+    return hash_bytes(14695981039346656037ULL, key, (size_t)length);
+}
+
+/**
+ * @brief Allocates an empty table.
+ *
+ */
+static void table_init(index_table *table, size_t capacity) {
+    table->capacity = capacity;
+    table->size = 0;
+    table->slots = (index_slot *)emalloc(capacity * sizeof(index_slot));
+    memset(table->slots, 0, capacity * sizeof(index_slot));
+}
+
+/**
+ * @brief Finds the slot of a key, or the empty slot where it belongs.
+ *
+ */
+static index_slot *table_find(const index_table *table, const char *keys, unsigned long long hash, const char *key) {
+    size_t mask = table->capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        index_slot *slot = &table->slots[i];
+        if (slot->count == 0 || (slot->hash == hash && strcmp(keys + slot->key, key) == 0)) {
+            return slot;
+        }
+    }
+}
+
+/**
+ * @brief Doubles the capacity of a table, moving every slot by its stored hash.
+ *
+ */
+static void table_grow(index_table *table) {
+    index_table grown;
+    table_init(&grown, table->capacity * 2);
+
+    size_t mask = grown.capacity - 1;
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->slots[i].count != 0) {
+            size_t j = table->slots[i].hash & mask;
+            while (grown.slots[j].count != 0) {
+                j = (j + 1) & mask;
+            }
+            grown.slots[j] = table->slots[i];
+        }
+    }
+    grown.size = table->size;
+    free(table->slots);
+    *table = grown;
+}
+
+/**
+ * @brief Counts one route under a key, storing the key the first time.
+ *
+ */
+static void table_add(route_index *index, index_table *table, unsigned long long hash, const char *key) {
+    if (2 * (table->size + 1) > table->capacity) {
+        table_grow(table);
+    }
+    index_slot *slot = table_find(table, index->keys, hash, key);
+    if (slot->count == 0) {
+        // Append the key to the key pool
+        size_t length = strlen(key) + 1;
+        if (index->keys_size + length > index->keys_capacity) {
+            size_t capacity = index->keys_capacity * 2 + length;
+            char *keys = (char *)emalloc(capacity);
+            memcpy(keys, index->keys, index->keys_size);
+            free(index->keys);
+            index->keys = keys;
+            index->keys_capacity = capacity;
+        }
+        memcpy(index->keys + index->keys_size, key, length);
+        slot->hash = hash;
+        slot->key = (unsigned int)index->keys_size;
+        index->keys_size += length;
+        table->size++;
+    }
+    slot->count++;
+}
+
+/**
+ * @brief Returns bit i of the Bloom filter positions of a hash.
+ *
+ */
+static size_t bloom_position(const route_index *index, unsigned long long hash, int i) {
+    unsigned long long h1 = hash & 0xffffffffULL;
+    unsigned long long h2 = (hash >> 32) | 1;
+    return (size_t)((h1 + i * h2) % index->bloom_bits);
+}
+
+/**
+ * @brief Initializes an empty index.
+ *
+ * @param index The index to initialize.
+ * @param fingerprint The fingerprint of the input it is built from.
+ * @return void: nothing
+ *
+ */
+void route_index_init(route_index *index, unsigned long long fingerprint) {
+    memset(index, 0, sizeof(route_index));
+    table_init(&index->routes, 1024);
+    table_init(&index->pairs, 1024);
+    index->keys_capacity = 64 * 1024;
+    index->keys = (char *)emalloc(index->keys_capacity);
+    index->fingerprint = fingerprint;
+}
+
+/**
+ * @brief Counts one route in the index.
+ *
+ * @param index The index, not finished yet.
+ * @param airline The airline ICAO code.
+ * @param from The origin airport ICAO code.
+ * @param to The destination airport ICAO code.
+ * @return void: nothing
+ *
+ */
+void route_index_add(route_index *index, const char *airline, const char *from, const char *to) {
+    char key[INDEX_KEY_SIZE];
+
+    table_add(index, &index->routes, make_key(key, airline, from, to), key);
+    table_add(index, &index->pairs, make_key(key, "", from, to), key);
+}
+
+/**
+ * @brief Builds the Bloom filter over every key, after the last route has been added.
+ *
+ * @param index The index.
+ * @return void: nothing
+ *
+ */
+void route_index_finish(route_index *index) {
+    index->bloom_bits = (index->routes.size + index->pairs.size) * INDEX_BLOOM_BITS_PER_KEY + 64;
+    index->bloom = (unsigned char *)emalloc((index->bloom_bits + 7) / 8);
+    memset(index->bloom, 0, (index->bloom_bits + 7) / 8);
+
+    index_table *tables[2] = { &index->routes, &index->pairs };
+    for (int t = 0; t < 2; t++) {
+        for (size_t i = 0; i < tables[t]->capacity; i++) {
+            if (tables[t]->slots[i].count != 0) {
+                for (int k = 0; k < INDEX_BLOOM_HASHES; k++) {
+                    size_t bit = bloom_position(index, tables[t]->slots[i].hash, k);
+                    index->bloom[bit / 8] |= (unsigned char)(1 << (bit % 8));
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Returns the number of routes an airline flies from one airport to another.
+ *
+ * @param index The index.
+ * @param airline The airline ICAO code, or "" to count the routes of every airline.
+ * @param from The origin airport ICAO code.
+ * @param to The destination airport ICAO code.
+ * @return unsigned int The number of routes; 0 if there are none.
+ *
+ */
+unsigned int route_index_count(const route_index *index, const char *airline, const char *from, const char *to) {
+    char key[INDEX_KEY_SIZE];
+    unsigned long long hash = make_key(key, airline, from, to);
+
+    // Most absent keys are turned away by the Bloom filter without touching the tables
+    if (index->bloom != NULL) {
+        for (int k = 0; k < INDEX_BLOOM_HASHES; k++) {
+            size_t bit = bloom_position(index, hash, k);
+            if (!(index->bloom[bit / 8] & (1 << (bit % 8)))) {
+                return 0;
+            }
+        }
+    }
+    const index_table *table = (airline[0] == '\0') ? &index->pairs : &index->routes;
+    return table_find(table, index->keys, hash, key)->count;
+}
+
+/**
+ * @brief Computes the fingerprint of the input of an index: the name, size and modification time
+ *        of every data file, and the predicates routes were filtered with.
+ *
+ * @param data_files The yaml files.
+ * @param where The --WHERE= predicates, as written by filter_describe.
+ * @return unsigned long long The fingerprint.
+ *
+ */
+unsigned long long route_index_fingerprint(glob_t *data_files, const char *where) {
+    unsigned long long hash = hash_bytes(14695981039346656037ULL, where, strlen(where) + 1);
+    struct stat st;
+
+    for (size_t i = 0; i < data_files->gl_pathc; i++) {
+        long long stamp[3] = { 0, 0, 0 };
+        if (stat(data_files->gl_pathv[i], &st) == 0) {
+            stamp[0] = (long long)st.st_size;
+            stamp[1] = (long long)st.st_mtim.tv_sec;
+            stamp[2] = (long long)st.st_mtim.tv_nsec;
+        }
+        hash = hash_bytes(hash, data_files->gl_pathv[i], strlen(data_files->gl_pathv[i]) + 1);
+        hash = hash_bytes(hash, stamp, sizeof(stamp));
+    }
+    return hash;
+}
+
+/**
+ * @brief Writes a finished index to a file, replacing it atomically.
+ *
+ * @param index The index.
+ * @param path The index file.
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int route_index_save(const route_index *index, const char *path) {
+    char temp_path[4096];
+    index_header header = { INDEX_MAGIC, index->fingerprint, index->routes.capacity, index->routes.size,
+                            index->pairs.capacity, index->pairs.size, index->keys_size, index->bloom_bits };
+
+    // Write to a temporary file first, so a reader never sees half an index
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld.tmp", path, (long)getpid());
+    FILE *file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Could not write index %s\n", path);
+        return 1;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1
+          && fwrite(index->routes.slots, sizeof(index_slot), index->routes.capacity, file) == index->routes.capacity
+          && fwrite(index->pairs.slots, sizeof(index_slot), index->pairs.capacity, file) == index->pairs.capacity
+          && fwrite(index->keys, 1, index->keys_size, file) == index->keys_size
+          && fwrite(index->bloom, 1, (index->bloom_bits + 7) / 8, file) == (index->bloom_bits + 7) / 8;
+
+    if (fclose(file) != 0 || !ok || rename(temp_path, path) != 0) {
+        fprintf(stderr, "Could not write index %s\n", path);
+        remove(temp_path);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Reads an index written by route_index_save, if it was built from the same input.
+ *
+ * @param index Filled in with the index.
+ * @param path The index file.
+ * @param fingerprint The fingerprint of the current input.
+ * @return int 1: The index was loaded; 0: There is no index for this input, and index is left empty.
+ *
+ */
+int route_index_load(route_index *index, const char *path, unsigned long long fingerprint) {
+    index_header header;
+
+    memset(index, 0, sizeof(route_index));
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != INDEX_MAGIC || header.fingerprint != fingerprint
+        || header.bloom_bits == 0 || header.route_capacity == 0 || (header.route_capacity & (header.route_capacity - 1))
+        || header.pair_capacity == 0 || (header.pair_capacity & (header.pair_capacity - 1))) {
+        fclose(file);
+        return 0;
+    }
+
+    table_init(&index->routes, header.route_capacity);
+    table_init(&index->pairs, header.pair_capacity);
+    index->routes.size = header.route_size;
+    index->pairs.size = header.pair_size;
+    index->keys_size = index->keys_capacity = header.keys_size;
+    index->keys = (char *)emalloc(header.keys_size > 0 ? header.keys_size : 1);
+    index->bloom_bits = header.bloom_bits;
+    index->bloom = (unsigned char *)emalloc((header.bloom_bits + 7) / 8);
+    index->fingerprint = fingerprint;
+
+    int ok = fread(index->routes.slots, sizeof(index_slot), header.route_capacity, file) == header.route_capacity
+          && fread(index->pairs.slots, sizeof(index_slot), header.pair_capacity, file) == header.pair_capacity
+          && fread(index->keys, 1, header.keys_size, file) == header.keys_size
+          && fread(index->bloom, 1, (header.bloom_bits + 7) / 8, file) == (header.bloom_bits + 7) / 8;
+    fclose(file);
+    if (!ok) {
+        route_index_free(index);
+        memset(index, 0, sizeof(route_index));
+    }
+    return ok;
+}
+
+/**
+ * @brief Frees the tables, keys and Bloom filter of an index.
+ *
+ * @param index The index.
+ * @return void: nothing
+ *
+ */
+void route_index_free(route_index *index) {
+    free(index->routes.slots);
+    free(index->pairs.slots);
+    free(index->keys);
+    free(index->bloom);
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+/** @file route_index.h
+ *  @brief Hashed index of the routes by (airline ICAO, from ICAO, to ICAO), with a Bloom filter in front.
+ *
+ */
+#ifndef ROUTE_INDEX_H
+#define ROUTE_INDEX_H
+
+#include <glob.h>
+
+#define INDEX_BLOOM_BITS_PER_KEY 10     // About 1% false positives
+#define INDEX_BLOOM_HASHES 7
+#define INDEX_MAX_LOOKUPS 64            // --LOOKUP= options in one run
+
+/**
+ * @brief Struct representing one slot of an index table.
+ */
+typedef struct {
+    unsigned long long hash;
+    unsigned int key;       // Offset of the key in route_index.keys
+    unsigned int count;     // Routes with the key; 0 marks an empty slot
+} index_slot;
+
+/**
+ * @brief Struct representing an open-addressing table of keys and their route counts.
+ */
+typedef struct {
+    index_slot *slots;
+    size_t capacity;        // A power of two, kept at least twice the size
+    size_t size;
+} index_table;
+
+/**
+ * @brief Struct representing the index. The keys of both tables are "airline\tfrom\tto" strings,
+ *        with an empty airline in the pairs table.
+ */
+typedef struct {
+    index_table routes;     // Counts of every (airline, from, to)
+    index_table pairs;      // Counts of every (from, to) over all airlines
+    char *keys;             // Every key, each terminated by '\0'
+    size_t keys_size;
+    size_t keys_capacity;
+    unsigned char *bloom;   // Bloom filter over the keys of both tables, or NULL until route_index_finish
+    size_t bloom_bits;
+    unsigned long long fingerprint;     // Of the input the index was built from
+} route_index;
+
+/**
+ * Function protypes associated with the route index.
+ */
+void route_index_init(route_index *index, unsigned long long fingerprint);
+void route_index_add(route_index *index, const char *airline, const char *from, const char *to);
+void route_index_finish(route_index *index);
+unsigned int route_index_count(const route_index *index, const char *airline, const char *from, const char *to);
+unsigned long long route_index_fingerprint(glob_t *data_files, const char *where);
+int route_index_save(const route_index *index, const char *path);
+int route_index_load(route_index *index, const char *path, unsigned long long fingerprint);
+void route_index_free(route_index *index);
+
+#endif // ROUTE_INDEX_H
\ No newline at end of file
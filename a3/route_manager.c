@@ -1,839 +1,2579 @@
-/** @file route_manager.c
- *  @brief A small program to analyze airline routes data.
- *  @author Mike Z.
- *  @author Felipe R.
- *  @author Hausi M.
- *  @author Jose O.
- *  @author Jasmine Wei
- *
- */
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include "emalloc.h"
-#include "list.h"
-#include "count_list.h"
-
-#define MAX_LINE_LEN 80
-#define MAX_ROUTES 100
-#define BUFFER_SIZE 256
-
-/**
- * @brief this function parses command-line arguments
- *
- * @param argc The number of arguments passed to the program.
- * @param argv The list of arguments passed to the program.
- * @param data_file The yaml file of airline routes were looking through
- * @param question The question number
- * @param n The number of items we are outputting
- * @return void: nothing
- *
- */
-void parse_arguments(int argc, char *argv[], char *data_file, int *question, int *n) {
-    // Loop through each argument
-    for (int i = 1; i < argc; i++) {
-        // Check if the argument starts with --DATA=
-        if (strncmp(argv[i], "--DATA=", 7) == 0) {
-            // Copy the value after --DATA= into data_file
-            strcpy(data_file, argv[i] + 7);
-        }
-        // Check if the argument starts with --QUESTION=
-        else if (strncmp(argv[i], "--QUESTION=", 11) == 0) {
-            // Convert the value after --QUESTION= to an integer and store in question
-            *question = atoi(argv[i] + 11);
-        }
-        // Check if the argument starts with --N=
-        else if (strncmp(argv[i], "--N=", 4) == 0) {
-            // Convert the value after --N= to an integer and store in n
-            *n = atoi(argv[i] + 4);
-        }
-    }
-}
-
-/**
- * @brief this function trims leading whitespace
- * @param str the string to trim
- * @return char *: the trimmed string
- *
- */
-char *trim_leading_spaces(char *str) {
-    while (*str == ' ') str++;
-    return str;
-}
-
-/**
- * @brief this function parses each line of the yaml file, assigning variables to respective fields
- *
- * @param line the current line of the yaml file for tokenization
- * @param route route struct instance used to fill its feilds
- * @return void: nothing
- *
- */
-void parse_line(char *line, Route *route) {
-   // Tokenize the input line to get the key
-    char *key = strtok(line, ":");
-
-    // Tokenize again to get the value
-    char *value = strtok(NULL, ":");
-
-    // Check if both key and value are not NULL
-    if (key && value) {
-        // Trim leading spaces from key and value
-        key = trim_leading_spaces(key);
-        value = trim_leading_spaces(value);
-
-        // Remove newline character from value if present
-        value[strcspn(value, "\n")] = '\0';
-
-        // Compare key and copy the value to the corresponding field in the Route structure
-        if (strcmp(key, "- airline_name") == 0) {
-            strncpy(route->airline_name, value, sizeof(route->airline_name) - 1);
-        } else if (strcmp(key, "airline_icao_unique_code") == 0) {
-            strncpy(route->airline_icao_unique_code, value, sizeof(route->airline_icao_unique_code) - 1);
-        } else if (strcmp(key, "airline_country") == 0) {
-            strncpy(route->airline_country, value, sizeof(route->airline_country) - 1);
-        } else if (strcmp(key, "from_airport_name") == 0) {
-            strncpy(route->from_airport_name, value, sizeof(route->from_airport_name) - 1);
-        } else if (strcmp(key, "from_airport_city") == 0) {
-            strncpy(route->from_airport_city, value, sizeof(route->from_airport_city) - 1);
-        } else if (strcmp(key, "from_airport_country") == 0) {
-            strncpy(route->from_airport_country, value, sizeof(route->from_airport_country) - 1);
-        } else if (strcmp(key, "from_airport_icao_unique_code") == 0) {
-            strncpy(route->from_airport_icao_unique_code, value, sizeof(route->from_airport_icao_unique_code) - 1);
-        } else if (strcmp(key, "from_airport_altitude") == 0) {
-            strncpy(route->from_airport_altitude, value, sizeof(route->from_airport_altitude) - 1);
-        } else if (strcmp(key, "to_airport_name") == 0) {
-            strncpy(route->to_airport_name, value, sizeof(route->to_airport_name) - 1);
-        } else if (strcmp(key, "to_airport_city") == 0) {
-            strncpy(route->to_airport_city, value, sizeof(route->to_airport_city) - 1);
-        } else if (strcmp(key, "to_airport_country") == 0) {
-            strncpy(route->to_airport_country, value, sizeof(route->to_airport_country) - 1);
-        } else if (strcmp(key, "to_airport_icao_unique_code") == 0) {
-            strncpy(route->to_airport_icao_unique_code, value, sizeof(route->to_airport_icao_unique_code) - 1);
-        } else if (strcmp(key, "to_airport_altitude") == 0) {
-            strncpy(route->to_airport_altitude, value, sizeof(route->to_airport_altitude) - 1);
-        }
-    }
-}
-
-/**
- * @brief this function adds all of each route struct node into the general linked list in order,
- *        with costraints defined by question number
- *
- * @param new_node the node to be added into the general linked list
- * @param head_ref the begining of the general linked list of route structs
- * @param question the question number that is being answered
- * @return int 0: No errors; 1: Errors produced.
- *
- */
-int question_add_node(node_t *new_node, node_t **head_ref, int question){
-    if ((question == 1) && (strcmp(new_node->route.to_airport_country, "Canada") == 0)) {
-        *head_ref = add_inorder(*head_ref, new_node, "airline_name");
-    } else if (question == 2){
-        if (new_node->route.to_airport_country[0] == '\'') {
-            // Calculate the length of the original string
-            size_t len = strlen(new_node->route.to_airport_country);
-
-            // Allocate memory for the new string
-            char *new_country = (char *)malloc(len - 2); // Allocate memory for the new string
-
-            // Copy the string without the first two and last characters
-            strncpy(new_country, new_node->route.to_airport_country + 2, len - 3);
-            new_country[len - 3] = '\0'; // Ensure the new string is null-terminated
-
-            // Assign the new string to the node's route.to_airport_country
-            strcpy(new_node->route.to_airport_country, new_country);
-
-            // Free the allocated memory
-            free(new_country);
-        }
-        *head_ref = add_inorder(*head_ref, new_node, "to_airport_country");
-    } else if (question == 3){
-        *head_ref = add_inorder(*head_ref, new_node, "to_airport_name");
-    }
-    return 1;
-}
-
-/**
- * @brief this function reads the yaml file containing routes of airplanes, and compiles them all into a general linked list
- *        of route structs
- *
- * @param data_file the yaml file containing routes of airplanes
- * @param head_ref the begining of the general linked list of route structs
- * @param question the question number that is being answered
- * @return int 0: No errors; 1: Errors produced.
- *
- */
-int read_yaml(const char *data_file, node_t **head_ref, int question) {
-    // File pointer
-    FILE *file;
-    char line[256];
-    Route new_route;
-    int is_first_line = 1; // Flag to check if it's the first line
-
-    // Open the file in read mode
-    file = fopen(data_file, "r");
-    if (file == NULL) {
-        fprintf(stderr, "Could not open file\n");
-        return 1;
-    }
-
-    // Initialize the new Route instance with empty strings
-    memset(&new_route, 0, sizeof(Route));
-
-    // Read each line from the file and parse it
-    while (fgets(line, sizeof(line), file)) {
-        if (is_first_line) {
-            // Skip the first line (header or initial content)
-            is_first_line = 0;
-        } else if (strstr(line, "- airline_name") != NULL) {
-            // If a new route begins, add the previous one to the list
-            node_t *new_node = (node_t *)malloc(sizeof(node_t));
-            new_node->route = new_route;
-            new_node->next = NULL;
-
-            // Add the new node to the list based on the question parameter
-            question_add_node(new_node, head_ref, question);
-
-            // Reset the Route instance for the new route
-            memset(&new_route, 0, sizeof(Route));
-        }
-        // Parse the line into the current route
-        parse_line(line, &new_route);
-    }
-
-    // Add the last route to the list
-    node_t *new_node = (node_t *)emalloc(sizeof(node_t));
-    new_node->route = new_route;
-    new_node->next = NULL;
-
-    // Add the new node to the list based on the question parameter
-    question_add_node(new_node, head_ref, question);
-
-    // Close the file
-    fclose(file);
-    return 0;
-}
-
-/**
- * @brief this function answers and outputs the contents of the linked list containing vals to be outputted
- *        in a formatted manner
- *
- * @param head the begining of the linked list containing vals to be outputted
- * @param n the number of elements that will be outputted
- * @return int 0: No errors; 1: Errors produced.
- *
- */
-int q1_output_vals(q1_count_node *head, int n) {
-    // Open the file "output.csv" for writing
-    FILE *file = fopen("output.csv", "w");
-    if (file == NULL) {
-        fprintf(stderr, "Could not open file for writing\n");
-        return 1;
-    }
-
-    // Write the CSV header
-    fputs("subject,statistic\n", file);
-    
-    for (int i = 0; i < n; i++) {
-        // If the list is empty, break out of the loop
-        if (head == NULL) {
-            break;
-        }
-
-        // Initialize pointers to find the node with the maximum count
-        q1_count_node *prev_temp = NULL;
-        q1_count_node *temp = head;
-        q1_count_node *max_count = temp;
-        q1_count_node *max_count_prev = NULL;
-
-        // Traverse the list to find the node with the maximum count
-        while (temp != NULL) {
-            if (temp->q1_count.count > max_count->q1_count.count) {
-                max_count_prev = prev_temp;
-                max_count = temp;
-            }
-            prev_temp = temp;
-            temp = temp->next;
-        }
-
-        // Print the max_count node details to the file
-        if (max_count != NULL) {
-            fprintf(file, "%s (%s),%d\n", max_count->q1_count.airline_name, max_count->q1_count.airline_icao_unique_code,
-                                          max_count->q1_count.count);
-                                          
-            // Remove the max_count node from the linked list
-            if (max_count_prev == NULL) {
-                // If max_count is the head of the list
-                head = max_count->next;
-            } else {
-                // If max_count is not the head of the list
-                max_count_prev->next = max_count->next;
-            }
-            
-            // Set the freed flag
-            max_count->freed = 1;
-        } else {
-            // No nodes left in the list to process
-            break;
-        }
-    }
-
-    // Close the file
-    fclose(file);
-    return 0;
-}
-
-/**
- * @brief this function intializes the fields of a node for the linked list with values to be outputted
- *
- * @param new_q1_count_node the pointer to the current node of the linked list with values to be outputted
- * @param temp the pointer to the current node of general route linked list
- * @return void: nothing
- *
- */
-void init_q1_count_fields(q1_count_node *new_q1_count_node, node_t *temp) {
-    // Copy the airline name from the route to the q1_count field
-    strncpy(new_q1_count_node->q1_count.airline_name, temp->route.airline_name, sizeof(new_q1_count_node->q1_count.airline_name) - 1);
-    new_q1_count_node->q1_count.airline_name[sizeof(new_q1_count_node->q1_count.airline_name) - 1] = '\0'; // Ensure null termination
-
-    // Copy the airline ICAO unique code from the route to the q1_count field
-    strncpy(new_q1_count_node->q1_count.airline_icao_unique_code, temp->route.airline_icao_unique_code, sizeof(new_q1_count_node->q1_count.airline_icao_unique_code) - 1);
-    new_q1_count_node->q1_count.airline_icao_unique_code[sizeof(new_q1_count_node->q1_count.airline_icao_unique_code) - 1] = '\0'; // Ensure null termination
-
-    // Initialize the count field to 1
-    new_q1_count_node->q1_count.count = 1;
-}
-
-/**
- * @brief this function creates the linked list with nodes to be outputted into output.csv 
- *        from the gneeral linked list of routes, and outputs formatted information
- *
- * @param temp the pointer to the current node of general route linked list
- * @param curr_to_airport_name the number of elements that will be outputted
- * @param count_head the pointer to the current node of linked list with information to be outputted into file specific to q3
- * @return void: nothing
- *
- */
-void make_q1_count_list(node_t *temp, char curr_airline_name[], q1_count_node *count_head) {
-    // Traverse the list of routes
-    while (temp != NULL) {
-        // Check if the current airline name is different from the last one processed
-        if (strcmp(temp->route.airline_name, curr_airline_name) != 0) {
-            // Update the current airline name
-            strcpy(curr_airline_name, temp->route.airline_name);
-            
-            // Create a new Q1_count and corresponding q1_count_node
-            Q1_count new_q1_count;
-            q1_count_node *new_q1_count_node = q1_count_new_node(new_q1_count); // Declare as a pointer
-
-            // Initialize the fields of the new q1_count_node
-            init_q1_count_fields(new_q1_count_node, temp);
-
-            // Add the new node to the linked list in order
-            count_head = q1_count_add_inorder(count_head, new_q1_count_node, "airline_name");
-        } else {
-            // If the airline name is the same, find the corresponding count node and increment the count
-            q1_count_node *count_cur = count_head;
-            while (count_cur != NULL && strcmp(count_cur->q1_count.airline_name, temp->route.airline_name) != 0) {
-                count_cur = count_cur->next;
-            }
-
-            // If the count node is found, increment the count
-            if (count_cur != NULL) {
-                count_cur->q1_count.count++;
-            } else {
-                // Error handling if the count node is not found
-                fprintf(stderr, "Error: Could not find the count node for airline %s\n", temp->route.airline_name);
-            }
-        }
-        // Move to the next node in the list
-        temp = temp->next;
-    }
-}
-
-/**
- * @brief this function answers q1: What are the top N airlines that offer the greatest number of routes with destination country as Canada?  
- *        it reads the routes of the provided yaml file, compiles them into a general sorted linked list,
- *        compiles that into a linked list with nodes to be outputted into output.csv, and outputs formatted information
- *
- * @param data_file the yaml file full of airline route information
- * @param n the number of elements that will be outputted
- * @return void: nothing
- *
- */
-void q1(char data_file[], int n) { 
-    node_t *head = NULL;
-    //read the yaml fil
-    read_yaml(data_file, &head, 1);
-    node_t *temp = head;
-
-    char curr_airline_name[BUFFER_SIZE];
-    strcpy(curr_airline_name, "");// Use strcpy to copy the string
-
-    if (temp != NULL) {
-        strcpy(curr_airline_name, temp->route.airline_name);
-    }
-
-    // Init head pointer and node
-    q1_count_node *count_head = NULL;
-    Q1_count new_q1_count;
-    q1_count_node *new_q1_count_node = q1_count_new_node(new_q1_count); // Make new count node. Declare as a pointer
-    
-    // Init count node's fields
-    init_q1_count_fields(new_q1_count_node, temp);
-
-    // Make this new node the head
-    count_head = new_q1_count_node;
-    temp = temp->next;
-
-    make_q1_count_list(temp, curr_airline_name, count_head);
-
-    // Print the count linked list
-    q1_count_node *count_temp = count_head;
-    q1_output_vals(count_temp, n);
-    
-    // Free the allocated memory for the original list
-    while (head != NULL) {
-        node_t *temp = head;
-        head = head->next;
-        free(temp);
-    }
-
-    // Free the allocated memory for the count list only if not already freed
-    q1_count_node *cur = count_head;
-    while (cur != NULL) {
-        q1_count_node *next = cur->next;
-        if (!cur->freed) {
-            free(cur);
-        }
-        cur = next;
-    }
-}
-
-/**
- * @brief this function answers and outputs the contents of the linked list containing vals to be outputted
- *        in a formatted manner
- *
- * @param head the begining of the linked list containing vals to be outputted
- * @param n the number of elements that will be outputted
- * @return int 0: No errors; 1: Errors produced.
- *
- */
-int q2_output_vals(q2_count_node *head, int n) {
-    // Open the file "output.csv" for writing
-    FILE *file = fopen("output.csv", "w");
-    if (file == NULL) {
-        fprintf(stderr, "Could not open file for writing\n");
-        return 1;
-    }
-
-    // Write the CSV header
-    fputs("subject,statistic\n", file);
-    
-    for (int i = 0; i < n; i++) {
-        // If the list is empty, break out of the loop
-        if (head == NULL) {
-            break;
-        }
-
-        // Initialize pointers to find the node with the minimum count
-        q2_count_node *prev_temp = NULL;
-        q2_count_node *temp = head;
-        q2_count_node *min_count = temp;
-        q2_count_node *min_count_prev = NULL;
-
-        // Traverse the list to find the node with the minimum count
-        while (temp != NULL) {
-            if (temp->q2_count.count < min_count->q2_count.count) {
-                min_count_prev = prev_temp;
-                min_count = temp;
-            }
-            prev_temp = temp;
-            temp = temp->next;
-        }
-
-        // Print the min_count node details to the file
-        if (min_count != NULL) {
-            fprintf(file, "%s,%d\n", min_count->q2_count.to_airport_country, min_count->q2_count.count);
-
-            // Remove the min_count node from the linked list
-            if (min_count_prev == NULL) {
-                // If min_count is the head of the list
-                head = min_count->next;
-            } else {
-                // If min_count is not the head of the list
-                min_count_prev->next = min_count->next;
-            }
-            // Set the freed flag
-            min_count->freed = 1;
-        } else {
-            // No nodes left in the list to process
-            break;
-        }
-    }
-
-    // Close the file
-    fclose(file);
-    return 0;
-}
-
-/**
- * @brief This function initializes the fields of a node for the linked list with values to be outputted.
- *
- * @param new_q2_count_node The pointer to the current node of the linked list with values to be outputted.
- * @param temp The pointer to the current node of the general route linked list.
- * @return void: nothing.
- *
- */
-void init_q2_count_fields(q2_count_node *new_q2_count_node, node_t *temp) {
-    // Copy the destination country from the route to the q2_count field
-    strncpy(new_q2_count_node->q2_count.to_airport_country, temp->route.to_airport_country, sizeof(new_q2_count_node->q2_count.to_airport_country) - 1);
-    new_q2_count_node->q2_count.to_airport_country[sizeof(new_q2_count_node->q2_count.to_airport_country) - 1] = '\0'; // Ensure null termination
-
-    // Initialize the count field to 1
-    new_q2_count_node->q2_count.count = 1;
-}
-
-/**
- * @brief This function creates the linked list with nodes to be outputted into output.csv
- *        from the general linked list of routes, and outputs formatted information.
- *
- * @param temp The pointer to the current node of the general route linked list.
- * @param curr_to_airport_country The current country being processed.
- * @param count_head The pointer to the head of the linked list with information to be outputted into the file specific to q2.
- * @return void: nothing.
- *
- */
-void make_q2_count_list(node_t *temp, char curr_to_airport_country[], q2_count_node *count_head) {
-    // Traverse the list of routes
-    while (temp != NULL) {
-        // Check if the current destination country is different from the last one processed
-        if (strcmp(temp->route.to_airport_country, curr_to_airport_country) != 0) {
-            // Update the current destination country
-            strcpy(curr_to_airport_country, temp->route.to_airport_country);
-            
-            // Create a new Q2_count and corresponding q2_count_node
-            Q2_count new_q2_count;
-            q2_count_node *new_q2_count_node = q2_count_new_node(new_q2_count); // Declare as a pointer
-            
-            // Initialize the fields of the new q2_count_node
-            init_q2_count_fields(new_q2_count_node, temp);
-
-            // Add the new node to the linked list in order
-            count_head = q2_count_add_inorder(count_head, new_q2_count_node, "to_airport_country");
-        } else {
-            // If the destination country is the same, find the corresponding count node and increment the count
-            q2_count_node *count_cur = count_head;
-            while (count_cur != NULL && strcmp(count_cur->q2_count.to_airport_country, temp->route.to_airport_country) != 0) {
-                count_cur = count_cur->next;
-            }
-
-            // If the count node is found, increment the count
-            if (count_cur != NULL) {
-                count_cur->q2_count.count++;
-            } else {
-                // Error handling if the count node is not found
-                fprintf(stderr, "Error: Could not find the count node for country %s\n", temp->route.to_airport_country);
-            }
-        }
-        // Move to the next node in the list
-        temp = temp->next;
-    }
-}
-
-/**
- * @brief This function answers q2: What are the top N countries with the least appearances as destination countries on the routes data?
- *        It reads the routes from the provided YAML file, compiles them into a general sorted linked list,
- *        compiles that into a linked list with nodes to be outputted into output.csv, and outputs formatted information.
- *
- * @param data_file The YAML file full of airline route information.
- * @param n The number of elements that will be outputted.
- * @return void: nothing.
- *
- */
-void q2(char data_file[], int n) {
-    node_t *head = NULL;
-    //read the yaml fil
-    read_yaml(data_file, &head, 2);
-    node_t *temp = head->next;
-
-    char curr_to_airport_country[BUFFER_SIZE];
-    strcpy(curr_to_airport_country, ""); // Use strcpy to copy the string
-
-    if (temp != NULL) {
-        strcpy(curr_to_airport_country, temp->route.to_airport_country);
-    }
-
-    // Initialize head pointer and node
-    q2_count_node *count_head = NULL;
-    Q2_count new_q2_count;
-    q2_count_node *new_q2_count_node = q2_count_new_node(new_q2_count); // Make new count node. Declare as a pointer
-    
-    // Initialize count node's fields
-    init_q2_count_fields(new_q2_count_node, temp);
-
-    // Make this new node the head
-    count_head = new_q2_count_node;
-    temp = temp->next;
-
-    // Create the count list
-    make_q2_count_list(temp, curr_to_airport_country, count_head);
-
-    // Print the count linked list
-    q2_count_node *count_temp = count_head;
-    q2_output_vals(count_temp, n);
-
-    // Free the allocated memory for the original list
-    while (head != NULL) {
-        node_t *temp = head;
-        head = head->next;
-        free(temp);
-    }
-
-    // Free the allocated memory for the count list only if not already freed
-    q2_count_node *cur = count_head;
-    while (cur != NULL) {
-        q2_count_node *next = cur->next;
-        if (!cur->freed) {
-            free(cur);
-        }
-        cur = next;
-    }
-}
-
-/**
- * @brief This function answers and outputs the contents of the linked list containing values to be outputted
- *        in a formatted manner.
- *
- * @param head The beginning of the linked list containing values to be outputted.
- * @param n The number of elements that will be outputted.
- * @return int 0: No errors; 1: Errors produced.
- *
- */
-int q3_output_vals(q3_count_node *head, int n) {
-    // Open the file "output.csv" for writing
-    FILE *file = fopen("output.csv", "w");
-    if (file == NULL) {
-        fprintf(stderr, "Could not open file for writing\n");
-        return 1;
-    }
-
-    // Write the CSV header
-    fputs("subject,statistic\n", file);
-    
-    for (int i = 0; i < n; i++) {
-        // If the list is empty, break out of the loop
-        if (head == NULL) {
-            break;
-        }
-
-        // Initialize pointers to find the node with the maximum count
-        q3_count_node *prev_temp = NULL;
-        q3_count_node *temp = head;
-        q3_count_node *max_count = temp;
-        q3_count_node *max_count_prev = NULL;
-
-        // Traverse the list to find the node with the maximum count
-        while (temp != NULL) {
-            if (temp->q3_count.count > max_count->q3_count.count) {
-                max_count_prev = prev_temp;
-                max_count = temp;
-            }
-            prev_temp = temp;
-            temp = temp->next;
-        }
-
-        // Print the max_count node details to the file
-        if (max_count != NULL) {
-            fprintf(file, "\"%s (%s), %s, %s\",%d\n", max_count->q3_count.to_airport_name, max_count->q3_count.to_airport_icao_unique_code, 
-                                                      max_count->q3_count.to_airport_city, max_count->q3_count.to_airport_country, max_count->q3_count.count);
-
-            // Remove the max_count node from the linked list
-            if (max_count_prev == NULL) {
-                // If max_count is the head of the list
-                head = max_count->next;
-            } else {
-                // If max_count is not the head of the list
-                max_count_prev->next = max_count->next;
-            }
-
-            // Set the freed flag
-            max_count->freed = 1;
-        } else {
-            // No nodes left in the list to process
-            break;
-        }
-    }
-
-    // Close the file
-    fclose(file);
-    return 0;
-}
-
-/**
- * @brief This function initializes the fields of a node for the linked list with values to be outputted.
- *
- * @param new_q3_count_node The pointer to the current node of the linked list with values to be outputted.
- * @param temp The pointer to the current node of the general route linked list.
- * @return void: nothing.
- *
- */
-void init_q3_count_fields(q3_count_node *new_q3_count_node, node_t *temp) {
-    // Copy the destination airport name from the route to the q3_count field
-    strncpy(new_q3_count_node->q3_count.to_airport_name, temp->route.to_airport_name, sizeof(new_q3_count_node->q3_count.to_airport_name) - 1);
-    new_q3_count_node->q3_count.to_airport_name[sizeof(new_q3_count_node->q3_count.to_airport_name) - 1] = '\0'; // Ensure null termination
-
-    // Copy the destination airport ICAO unique code from the route to the q3_count field
-    strncpy(new_q3_count_node->q3_count.to_airport_icao_unique_code, temp->route.to_airport_icao_unique_code, sizeof(new_q3_count_node->q3_count.to_airport_icao_unique_code) - 1);
-    new_q3_count_node->q3_count.to_airport_icao_unique_code[sizeof(new_q3_count_node->q3_count.to_airport_icao_unique_code) - 1] = '\0'; // Ensure null termination
-
-    // Copy the destination airport city from the route to the q3_count field
-    strncpy(new_q3_count_node->q3_count.to_airport_city, temp->route.to_airport_city, sizeof(new_q3_count_node->q3_count.to_airport_city) - 1);
-    new_q3_count_node->q3_count.to_airport_city[sizeof(new_q3_count_node->q3_count.to_airport_city) - 1] = '\0'; // Ensure null termination
-
-    // Copy the destination airport country from the route to the q3_count field
-    strncpy(new_q3_count_node->q3_count.to_airport_country, temp->route.to_airport_country, sizeof(new_q3_count_node->q3_count.to_airport_country) - 1);
-    new_q3_count_node->q3_count.to_airport_country[sizeof(new_q3_count_node->q3_count.to_airport_country) - 1] = '\0'; // Ensure null termination
-
-    // Initialize the count field to 1
-    new_q3_count_node->q3_count.count = 1;
-}
-
-/**
- * @brief This function creates the linked list with nodes to be outputted into output.csv
- *        from the general linked list of routes, and outputs formatted information.
- *
- * @param temp The pointer to the current node of the general route linked list.
- * @param curr_to_airport_name The current destination airport being processed.
- * @param count_head The pointer to the head of the linked list with information to be outputted into the file specific to q3.
- * @return void: nothing.
- *
- */
-void make_q3_count_list(node_t *temp, char curr_to_airport_name[], q3_count_node *count_head) {
-    // Traverse the list of routes
-    while (temp != NULL) {
-        // Check if the current destination airport is different from the last one processed
-        if (strcmp(temp->route.to_airport_name, curr_to_airport_name) != 0) {
-            // Update the current destination airport
-            strcpy(curr_to_airport_name, temp->route.to_airport_name);
-            
-            // Create a new Q3_count and corresponding q3_count_node
-            Q3_count new_q3_count;
-            q3_count_node *new_q3_count_node = q3_count_new_node(new_q3_count); // Declare as a pointer
-
-            // Initialize the fields of the new q3_count_node
-            init_q3_count_fields(new_q3_count_node, temp);
-
-            // Add the new node to the linked list in order
-            count_head = q3_count_add_inorder(count_head, new_q3_count_node, "to_airport_name");
-        } else {
-            // If the destination airport is the same, find the corresponding count node and increment the count
-            q3_count_node *count_cur = count_head;
-            while (count_cur != NULL && strcmp(count_cur->q3_count.to_airport_name, temp->route.to_airport_name) != 0) {
-                count_cur = count_cur->next;
-            }
-
-            // If the count node is found, increment the count
-            if (count_cur != NULL) {
-                count_cur->q3_count.count++;
-            } else {
-                // Error handling if the count node is not found
-                fprintf(stderr, "Error: Could not find the count node for airport %s\n", temp->route.to_airport_name);
-            }
-        }
-        // Move to the next node in the list
-        temp = temp->next;
-    }
-}
-
-/**
- * @brief This function answers q3: What are the top N destination airports?
- *        It reads the routes from the provided YAML file, compiles them into a general sorted linked list,
- *        compiles that into a linked list with nodes to be outputted into output.csv, and outputs formatted information.
- *
- * @param data_file The YAML file full of airline route information.
- * @param n The number of elements that will be outputted.
- * @return void: nothing.
- *
- */
-void q3(char data_file[], int n) {
-    node_t *head = NULL;
-    //read the yaml file
-    read_yaml(data_file, &head, 3);
-    node_t *temp = head->next;
-
-    char curr_to_airport_name[BUFFER_SIZE];
-    strcpy(curr_to_airport_name, ""); // Use strcpy to copy the string
-
-    if (temp != NULL) {
-        strcpy(curr_to_airport_name, temp->route.to_airport_name);
-    }
-
-    // Initialize head pointer and node
-    q3_count_node *count_head = NULL;
-    Q3_count new_q3_count;
-    q3_count_node *new_q3_count_node = q3_count_new_node(new_q3_count); // Make new count node. Declare as a pointer
-    
-    // Initialize count node's fields
-    init_q3_count_fields(new_q3_count_node, temp);
-
-    // Make this new node the head
-    count_head = new_q3_count_node;
-    temp = temp->next;
-
-    // Create the count list
-    make_q3_count_list(temp, curr_to_airport_name, count_head);
-
-    // Print the count linked list
-    q3_count_node *count_temp = count_head;
-    q3_output_vals(count_temp, n);
-
-    // Free the allocated memory for the original list
-    while (head != NULL) {
-        node_t *temp = head;
-        head = head->next;
-        free(temp);
-    }
-
-    // Free the allocated memory for the count list only if not already freed
-    q3_count_node *cur = count_head;
-    while (cur != NULL) {
-        q3_count_node *next = cur->next;
-        if (!cur->freed) {
-            free(cur);
-        }
-        cur = next;
-    }
-}
-
-/**
- * @brief The main function and entry point of the program.
- *
- * @param argc The number of arguments passed to the program.
- * @param argv The list of arguments passed to the program.
- * @return int 0: No errors; 1: Errors produced.
- *
- */
-int main(int argc, char *argv[]) {
-    char data_file[256];
-    int question = 0;
-    int n = 0;
-
-    // Initialize the variables
-    memset(data_file, 0, sizeof(data_file));
-
-    // Parse the command-line arguments
-    parse_arguments(argc, argv, data_file, &question, &n);
-
-    // Determine which question to answer based on the command-line arguments
-    if (question == 1) {
-        q1(data_file, n);
-    } else if (question == 2) {
-        q2(data_file, n);
-    } else if (question == 3) {
-        q3(data_file, n);
-    }
-
-    return 0;
-}
+/** @file route_manager.c
+ *  @brief A small program to analyze airline routes data.
+ *  @author Mike Z.
+ *  @author Felipe R.
+ *  @author Hausi M.
+ *  @author Jose O.
+ *  @author Jasmine Wei
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glob.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include "emalloc.h"
+#include "list.h"
+#include "count_list.h"
+#include "altitude.h"
+#include "spill.h"
+#include "thread_pool.h"
+#include "concurrent_map.h"
+#include "pivot.h"
+#include "cache.h"
+#include "perf.h"
+#include "sample.h"
+#include "filter.h"
+#include "reader.h"
+#include "query.h"
+#include "route_index.h"
+#include "stream.h"
+#include "dedup.h"
+#include "name_trie.h"
+#include "hugemem.h"
+#include "export.h"
+
+#define MAX_LINE_LEN 80
+#define MAX_ROUTES 100
+#define BUFFER_SIZE 256
+
+/**
+ * @brief Struct representing the command-line options.
+ */
+typedef struct {
+    glob_t data_files;      // The yaml files of airline routes were looking through
+    int question;           // The question number
+    int n;                  // The number of items we are outputting
+    size_t memory_limit;    // The byte budget given with --MEMORY_LIMIT=, or 0 for none
+    int threads;            // The number of pool workers given with --THREADS=, or 0 for one per processor
+    int pool_stats;         // 1 if --POOL_STATS asks for the per-worker utilisation
+    int hash_backend;       // 1 if --BACKEND=hash counts q1-q3 in the shared concurrent map
+    char *pivot;            // The "row_field,column_field" given with --PIVOT=, or NULL
+    int pivot_matrix;       // 1 if --PIVOT_MATRIX asks for the full matrix instead of the top N cells
+    char *group_top;        // The "outer_field,inner_field" given with --GROUP_TOP=, or NULL
+    char *cache;            // The result cache directory given with --CACHE=, or NULL
+    int perf;               // 1 if --PERF asks for the hardware counters of every phase
+    double sample_fraction; // The fraction of blocks read with --SAMPLE=, or 0
+    int sample_size;        // The number of routes kept with --SAMPLE_SIZE=, or 0
+    route_filter where;     // The predicates given with --WHERE=, which every counted route passes
+    const char *lookups[INDEX_MAX_LOOKUPS];  // The "airline,from,to" ICAO codes given with --LOOKUP=
+    int lookup_count;
+    char *index;            // The index file given with --INDEX=, or NULL
+    char *stream;           // The stdin ("-") or FIFO given with --STREAM=, or NULL
+    double snapshot_seconds;    // Seconds between snapshots given with --SNAPSHOT_SECONDS=, or 0
+    long snapshot_records;  // Routes between snapshots given with --SNAPSHOT_RECORDS=, or 0
+    int window;             // Snapshot intervals a route stays counted, given with --WINDOW=, or 0 for all
+    int dedup;              // 1 if --DEDUP asks for repeated routes to be counted once
+    const char *prefixes[TRIE_MAX_PREFIXES];    // The name prefixes given with --PREFIX=
+    int prefix_count;
+    int huge_pages;         // 1 if --HUGEPAGES asks for the large buffers on transparent huge pages
+    hugemem_numa numa;      // The placement of the large buffers given with --NUMA=
+    glob_t diff_files;      // The yaml files of the old snapshot given with --DIFF=
+    int diff_relative;      // 1 if --DIFF_RANK=relative ranks the diff by relative change
+    char *export_path;      // The file given with --EXPORT= for the complete ranked table, or NULL
+    export_format export_format;    // The format given with --EXPORT_FORMAT=, csv by default
+} options;
+
+/**
+ * @brief this function parses command-line arguments
+ *
+ * @param argc The number of arguments passed to the program.
+ * @param argv The list of arguments passed to the program.
+ * @param opts The options to fill in; each --DATA= may be a glob pattern
+ * @return void: nothing
+ *
+ */
+void parse_arguments(int argc, char *argv[], options *opts) {
+    int glob_flags = GLOB_NOCHECK | GLOB_BRACE;
+    int diff_glob_flags = GLOB_NOCHECK | GLOB_BRACE;
+
+    // Loop through each argument
+    for (int i = 1; i < argc; i++) {
+        // Check if the argument starts with --DATA=
+        if (strncmp(argv[i], "--DATA=", 7) == 0) {
+            // Expand the value after --DATA= and append the matching files to data_files
+            glob(argv[i] + 7, glob_flags, NULL, &opts->data_files);
+            glob_flags |= GLOB_APPEND;
+        }
+        // Check if the argument starts with --DIFF=
+        else if (strncmp(argv[i], "--DIFF=", 7) == 0) {
+            // Expand the old snapshot like --DATA=
+            glob(argv[i] + 7, diff_glob_flags, NULL, &opts->diff_files);
+            diff_glob_flags |= GLOB_APPEND;
+        }
+        // Check if the argument starts with --DIFF_RANK=
+        else if (strncmp(argv[i], "--DIFF_RANK=", 12) == 0) {
+            // "relative" ranks by relative change, anything else by absolute change
+            opts->diff_relative = (strcmp(argv[i] + 12, "relative") == 0);
+        }
+        // Check if the argument starts with --EXPORT=
+        else if (strncmp(argv[i], "--EXPORT=", 9) == 0) {
+            opts->export_path = argv[i] + 9;
+        }
+        // Check if the argument starts with --EXPORT_FORMAT=
+        else if (strncmp(argv[i], "--EXPORT_FORMAT=", 16) == 0) {
+            if (export_parse_format(argv[i] + 16, &opts->export_format) != 0) {
+                exit(EXIT_FAILURE);
+            }
+        }
+        // Check if the argument starts with --QUESTION=
+        else if (strncmp(argv[i], "--QUESTION=", 11) == 0) {
+            // Convert the value after --QUESTION= to an integer and store in question
+            opts->question = atoi(argv[i] + 11);
+        }
+        // Check if the argument starts with --N=
+        else if (strncmp(argv[i], "--N=", 4) == 0) {
+            // Convert the value after --N= to an integer and store in n
+            opts->n = atoi(argv[i] + 4);
+        }
+        // Check if the argument starts with --MEMORY_LIMIT=
+        else if (strncmp(argv[i], "--MEMORY_LIMIT=", 15) == 0) {
+            // Convert the value after --MEMORY_LIMIT= (optionally suffixed K, M or G) to bytes
+            opts->memory_limit = parse_memory_limit(argv[i] + 15);
+            if (opts->memory_limit == 0) {
+                fprintf(stderr, "Error: --MEMORY_LIMIT is a positive byte count with an optional K, M or G suffix, not %s\n", argv[i] + 15);
+                exit(EXIT_FAILURE);
+            }
+        }
+        // Check if the argument starts with --THREADS=
+        else if (strncmp(argv[i], "--THREADS=", 10) == 0) {
+            // Convert the value after --THREADS= to an integer and store in threads
+            opts->threads = atoi(argv[i] + 10);
+        }
+        // Check if the argument starts with --BACKEND=
+        else if (strncmp(argv[i], "--BACKEND=", 10) == 0) {
+            // "hash" selects the shared concurrent map, anything else the count lists
+            opts->hash_backend = (strcmp(argv[i] + 10, "hash") == 0);
+        }
+        // Check if the argument starts with --PIVOT=
+        else if (strncmp(argv[i], "--PIVOT=", 8) == 0) {
+            // Keep the two field names; they are split when the pivot is answered
+            opts->pivot = argv[i] + 8;
+        }
+        // Check if the argument starts with --GROUP_TOP=
+        else if (strncmp(argv[i], "--GROUP_TOP=", 12) == 0) {
+            // Keep the two field names; they are split like a pivot's
+            opts->group_top = argv[i] + 12;
+        }
+        // Check if the argument is --PIVOT_MATRIX
+        else if (strcmp(argv[i], "--PIVOT_MATRIX") == 0) {
+            opts->pivot_matrix = 1;
+        }
+        // Check if the argument starts with --CACHE=
+        else if (strncmp(argv[i], "--CACHE=", 8) == 0) {
+            opts->cache = argv[i] + 8;
+        }
+        // Check if the argument starts with --SAMPLE=
+        else if (strncmp(argv[i], "--SAMPLE=", 9) == 0) {
+            // Convert the value after --SAMPLE= to the fraction of the input to read
+            opts->sample_fraction = atof(argv[i] + 9);
+        }
+        // Check if the argument starts with --SAMPLE_SIZE=
+        else if (strncmp(argv[i], "--SAMPLE_SIZE=", 14) == 0) {
+            // Convert the value after --SAMPLE_SIZE= to the number of routes to keep
+            opts->sample_size = atoi(argv[i] + 14);
+        }
+        // Check if the argument starts with --WHERE=
+        else if (strncmp(argv[i], "--WHERE=", 8) == 0) {
+            // Add the predicate after --WHERE= to the ones every route must pass
+            if (filter_add(&opts->where, argv[i] + 8) != 0) {
+                exit(EXIT_FAILURE);
+            }
+        }
+        // Check if the argument starts with --LOOKUP=
+        else if (strncmp(argv[i], "--LOOKUP=", 9) == 0) {
+            // Keep the codes; they are split when the lookups are answered, so only their shape is checked here
+            const char *lookup = argv[i] + 9;
+            const char *first = strchr(lookup, ',');
+            const char *second = (first != NULL) ? strchr(first + 1, ',') : NULL;
+            if (second == NULL || strchr(second + 1, ',') != NULL || second == first + 1 || second[1] == '\0') {
+                fprintf(stderr, "Error: --LOOKUP is airline,from,to with from and to given, not %s\n", lookup);
+                exit(EXIT_FAILURE);
+            }
+            if (opts->lookup_count == INDEX_MAX_LOOKUPS) {
+                fprintf(stderr, "Error: at most %d --LOOKUP options are answered in one run\n", INDEX_MAX_LOOKUPS);
+                exit(EXIT_FAILURE);
+            }
+            opts->lookups[opts->lookup_count++] = lookup;
+        }
+        // Check if the argument starts with --INDEX=
+        else if (strncmp(argv[i], "--INDEX=", 8) == 0) {
+            opts->index = argv[i] + 8;
+        }
+        // Check if the argument starts with --PREFIX=
+        else if (strncmp(argv[i], "--PREFIX=", 9) == 0) {
+            if (opts->prefix_count == TRIE_MAX_PREFIXES) {
+                fprintf(stderr, "Error: at most %d --PREFIX options are answered in one run\n", TRIE_MAX_PREFIXES);
+                exit(EXIT_FAILURE);
+            }
+            opts->prefixes[opts->prefix_count++] = argv[i] + 9;
+        }
+        // Check if the argument starts with --STREAM=
+        else if (strncmp(argv[i], "--STREAM=", 9) == 0) {
+            opts->stream = argv[i] + 9;
+        }
+        // Check if the argument starts with --SNAPSHOT_SECONDS=
+        else if (strncmp(argv[i], "--SNAPSHOT_SECONDS=", 19) == 0) {
+            opts->snapshot_seconds = atof(argv[i] + 19);
+        }
+        // Check if the argument starts with --SNAPSHOT_RECORDS=
+        else if (strncmp(argv[i], "--SNAPSHOT_RECORDS=", 19) == 0) {
+            opts->snapshot_records = atol(argv[i] + 19);
+        }
+        // Check if the argument starts with --WINDOW=
+        else if (strncmp(argv[i], "--WINDOW=", 9) == 0) {
+            opts->window = atoi(argv[i] + 9);
+        }
+        // Check if the argument is --DEDUP
+        else if (strcmp(argv[i], "--DEDUP") == 0) {
+            opts->dedup = 1;
+        }
+        // Check if the argument is --HUGEPAGES
+        else if (strcmp(argv[i], "--HUGEPAGES") == 0) {
+            opts->huge_pages = 1;
+        }
+        // Check if the argument starts with --NUMA=
+        else if (strncmp(argv[i], "--NUMA=", 7) == 0) {
+            if (hugemem_parse_numa(argv[i] + 7, &opts->numa) != 0) {
+                exit(EXIT_FAILURE);
+            }
+        }
+        // Check if the argument is --PERF
+        else if (strcmp(argv[i], "--PERF") == 0) {
+            opts->perf = 1;
+        }
+        // Check if the argument is --POOL_STATS
+        else if (strcmp(argv[i], "--POOL_STATS") == 0) {
+            opts->pool_stats = 1;
+        }
+    }
+
+    // A sample estimates counts over the routes it skips and a stream never ends, so neither can tell
+    // which of its routes repeat one seen before
+    if (opts->dedup && ((opts->sample_fraction > 0) || (opts->sample_size > 0) || (opts->stream != NULL))) {
+        fprintf(stderr, "Error: --DEDUP cannot be used with --SAMPLE, --SAMPLE_SIZE or --STREAM\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief this function adds all of each route struct node into the general linked list in order,
+ *        with costraints defined by question number. The routes have already passed the question's filter.
+ *
+ * @param new_node the node to be added into the general linked list
+ * @param head_ref the begining of the general linked list of route structs
+ * @param question the question number that is being answered
+ * @return int 1: The node was added; 0: The question does not use the route.
+ *
+ */
+int question_add_node(node_t *new_node, node_t **head_ref, int question){
+    if (question == 1) {
+        *head_ref = add_inorder_airline_name(*head_ref, new_node);
+    } else if ((question == 2) || (question == 4)){
+        *head_ref = add_inorder_to_airport_country(*head_ref, new_node);
+    } else if (question == 3){
+        *head_ref = add_inorder_to_airport_name(*head_ref, new_node);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * @brief this function reads a yaml file with read_yaml_records and counts every route it parsed for --PERF,
+ *        including the ones the filter rejects, so records/s measures the reader rather than the filter
+ *
+ * @param data_file the yaml file containing routes of airplanes
+ * @param fields the route fields to parse; the others are left empty
+ * @param filter the predicates a route must pass to be handed over
+ * @param visit the function called with every route
+ * @param ctx passed through to visit
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int read_yaml_routes(const char *data_file, route_fields fields, const route_filter *filter,
+                     void (*visit)(Route *route, void *ctx), void *ctx) {
+    long routes = read_yaml_records(data_file, fields, filter, visit, ctx);
+    if (routes < 0) {
+        return 1;
+    }
+    perf_add_records(routes);
+    return 0;
+}
+
+/**
+ * @brief Struct representing the list being built by read_yaml.
+ */
+typedef struct {
+    node_t **head_ref;  // The begining of the general linked list of route structs
+    node_arena *arena;  // Where the nodes are allocated
+    int question;       // The question number that is being answered
+} route_list;
+
+/**
+ * @brief this function copies a parsed route into a new node and adds it to the general linked list
+ *
+ * @param route the parsed route
+ * @param ctx the route_list being built
+ * @return void: nothing
+ *
+ */
+void add_route_node(Route *route, void *ctx) {
+    route_list *list = (route_list *)ctx;
+    node_t *new_node = node_arena_alloc(list->arena);
+    new_node->route = *route;
+    new_node->next = NULL;
+
+    // Add the new node to the list based on the question parameter
+    if (!question_add_node(new_node, list->head_ref, list->question)) {
+        node_arena_unalloc(list->arena);
+    }
+}
+
+/**
+ * @brief this function reads the yaml file containing routes of airplanes, and compiles them all into a general linked list
+ *        of route structs
+ *
+ * @param data_file the yaml file containing routes of airplanes
+ * @param head_ref the begining of the general linked list of route structs
+ * @param arena the arena the nodes are allocated from; node_arena_free frees the whole list
+ * @param question the question number that is being answered
+ * @param filter the predicates a route must pass to be added
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int read_yaml(const char *data_file, node_t **head_ref, node_arena *arena, int question, const route_filter *filter) {
+    route_list list = { head_ref, arena, question };
+    return read_yaml_routes(data_file, question_fields(question), filter, add_route_node, &list);
+}
+
+/**
+ * @brief Struct representing one input file and the partial aggregate built from it by its worker.
+ */
+typedef struct {
+    const char *data_file;  // The partition read by this worker
+    const route_filter *filter; // The predicates a route of the partition must pass
+    void *partial;          // The partial aggregate built from the partition
+    count_arena counts;     // The memory of the partial count list (q1 to q3 only)
+    int size;               // The number of groups in the partial aggregate (q4 only)
+} partition;
+
+/**
+ * @brief Struct representing two partitions whose partial aggregates are merged into the first.
+ */
+typedef struct {
+    partition *into;
+    partition *from;
+} partition_pair;
+
+/**
+ * @brief this function ingests every data file as its own pool task, so the wall-clock time is that of the
+ *        largest partition rather than the sum of all of them
+ *
+ * @param pool the pool running the tasks
+ * @param data_files the yaml files to ingest
+ * @param parts one partition per data file, filled in by the tasks
+ * @param worker the task that builds the partial aggregate of one partition
+ * @param filter the predicates a route must pass to be aggregated
+ * @return void: nothing
+ *
+ */
+void ingest_partitions(thread_pool *pool, glob_t *data_files, partition *parts, task_fn worker, const route_filter *filter) {
+    int count = (int)data_files->gl_pathc;
+    task_group group;
+
+    for (int i = 0; i < count; i++) {
+        parts[i].data_file = data_files->gl_pathv[i];
+        parts[i].filter = filter;
+        parts[i].partial = NULL;
+        count_arena_init(&parts[i].counts);
+        parts[i].size = 0;
+    }
+
+    // Submit one task per partition and wait for all of them
+    task_group_init(&group);
+    thread_pool_submit_batch(pool, &group, worker, parts, count, sizeof(partition));
+    thread_pool_wait(pool, &group);
+    task_group_destroy(&group);
+}
+
+/**
+ * @brief this function merges the partial aggregates of every partition into parts[0] as a tree of pool
+ *        tasks: each round merges pairs of partitions in parallel and halves the number left
+ *
+ * @param pool the pool running the tasks
+ * @param parts the ingested partitions
+ * @param count the number of partitions
+ * @param merge_task the task that merges pair->from into pair->into
+ * @return void: nothing
+ *
+ */
+void merge_partitions(thread_pool *pool, partition *parts, int count, task_fn merge_task) {
+    partition_pair *pairs = (partition_pair *)emalloc((count / 2 + 1) * sizeof(partition_pair));
+
+    for (int stride = 1; stride < count; stride *= 2) {
+        int pair_count = 0;
+        task_group group;
+
+        // Pair each partition with the one stride positions after it
+        for (int i = 0; i + stride < count; i += 2 * stride) {
+            pairs[pair_count].into = &parts[i];
+            pairs[pair_count].from = &parts[i + stride];
+            pair_count++;
+        }
+
+        task_group_init(&group);
+        thread_pool_submit_batch(pool, &group, merge_task, pairs, pair_count, sizeof(partition_pair));
+        thread_pool_wait(pool, &group);
+        task_group_destroy(&group);
+    }
+    free(pairs);
+}
+
+/**
+ * @brief this function answers and outputs the contents of the linked list containing vals to be outputted
+ *        in a formatted manner
+ *
+ * @param head the begining of the linked list containing vals to be outputted
+ * @param n the number of elements that will be outputted
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int q1_output_vals(q1_count_node *head, int n) {
+    // Open the file "output.csv" for writing
+    FILE *file = fopen("output.csv", "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file for writing\n");
+        return 1;
+    }
+
+    // Write the CSV header
+    fputs("subject,statistic\n", file);
+    
+    // Lay the list out as a count table, so the selection scans only the packed counts
+    count_table table;
+    q1_count_table(head, &table);
+
+    for (int i = 0; i < n; i++) {
+        // Take the group with the highest count; ties go to the earliest in the list
+        int taken = count_table_take(&table, 1);
+        if (taken < 0) {
+            // No groups left to process
+            break;
+        }
+
+        // Print the group's details, kept in its cold node, to the file
+        q1_count_node *node = (q1_count_node *)table.nodes[taken];
+        fprintf(file, "%s (%s),%d\n", node->q1_count->airline_name, node->q1_count->airline_icao_unique_code,
+                                      node->count);
+    }
+    count_table_free(&table);
+
+    // Close the file
+    fclose(file);
+    return 0;
+}
+
+/**
+ * @brief Generates, for the count list of one question, the function that initializes a new count node
+ *        from the first route of its group and the function that compiles the general linked list of
+ *        routes into the count list:
+ *
+ *        init_prefix_count_fields copies every field of the question's count table from the route.
+ *
+ *        make_prefix_count_list walks the route list, which is sorted by the key field, so every group
+ *        is a run of consecutive routes that share a group node: the first route of a run adds a new count
+ *        node in order and the rest of the run increments that node. Only the hot header of each route
+ *        node is read; its key is only read to fill in the count node. A group that sorts after every
+ *        group so far, as each new one does for q1 and q2, is appended without walking the count list.
+ */
+#define COUNT_LIST_BUILDER(prefix, type, fields) \
+void init_##prefix##_count_fields(type *dst, node_t *temp) { \
+    const Route *src = &temp->route; \
+    fields(COUNT_FIELD_COPY) \
+} \
+ \
+prefix##_count_node *make_##prefix##_count_list(node_t *temp, prefix##_count_node *count_head, count_arena *arena) { \
+    prefix##_count_node *current = NULL; \
+    prefix##_count_node *tail = count_head; \
+    node_t *group = NULL; \
+ \
+    /* Find the end of the count list */ \
+    while (tail != NULL && tail->next != NULL) { \
+        tail = tail->next; \
+    } \
+ \
+    /* Traverse the list of routes */ \
+    while (temp != NULL) { \
+        /* Check if the route starts a new group */ \
+        if (temp->group != group) { \
+            group = temp->group; \
+ \
+            /* Create a new count node from the group's names and add it to the linked list in order */ \
+            type names; \
+            init_##prefix##_count_fields(&names, temp); \
+            current = prefix##_count_new_node(arena, &names, 1); \
+            if (tail != NULL && prefix##_count_node_compare(tail, current) < 0) { \
+                tail->next = current; \
+                tail = current; \
+            } else { \
+                count_head = prefix##_count_add_inorder(count_head, current); \
+                if (current->next == NULL) { \
+                    tail = current; \
+                } \
+            } \
+        } else { \
+            /* Same group as the previous route: it belongs to the node just added */ \
+            current->count++; \
+        } \
+        /* Move to the next node in the list */ \
+        temp = temp->next; \
+    } \
+    return count_head; \
+}
+
+/**
+ * @brief Table of the count lists built from the general route list: their prefix, count struct and
+ *        count field table.
+ */
+#define COUNT_LIST_BUILDERS(X) \
+    X(q1, Q1_count, Q1_COUNT_FIELDS) \
+    X(q2, Q2_count, Q2_COUNT_FIELDS) \
+    X(q3, Q3_count, Q3_COUNT_FIELDS)
+
+COUNT_LIST_BUILDERS(COUNT_LIST_BUILDER)
+
+/**
+ * @brief This function builds the partial count list of one partition for q1.
+ *        It reads the routes of the yaml file into a general sorted linked list and compiles that into
+ *        a count list, freeing the route list before returning.
+ *
+ * @param data_file The yaml file full of airline route information.
+ * @param filter The predicates a route must pass to be counted.
+ * @param counts The arena the count list is allocated from.
+ * @return q1_count_node*: The head of the count list, or NULL if the file has no matching routes.
+ *
+ */
+q1_count_node *q1_count_file(const char *data_file, const route_filter *filter, count_arena *counts) {
+    node_t *head = NULL;
+    node_arena arena;
+    node_arena_init(&arena);
+    perf_mark mark;
+
+    //read the yaml file
+    perf_begin(&mark);
+    read_yaml(data_file, &head, &arena, 1, filter);
+    perf_end(&mark, PERF_INGEST);
+
+    // Compile the route list into the count list
+    perf_begin(&mark);
+    q1_count_node *count_head = make_q1_count_list(head, NULL, counts);
+    perf_end(&mark, PERF_COUNT);
+
+    // Free the nodes of the original list
+    node_arena_free(&arena);
+    return count_head;
+}
+
+/**
+ * @brief This function is the pool task that ingests one q1 partition.
+ *
+ * @param arg The partition to ingest.
+ * @return void: nothing.
+ *
+ */
+void q1_partition_worker(void *arg) {
+    partition *part = (partition *)arg;
+    part->partial = q1_count_file(part->data_file, part->filter, &part->counts);
+}
+
+/**
+ * @brief This function is the pool task that merges the q1 count list of one partition into another's.
+ *
+ * @param arg The partition_pair to merge.
+ * @return void: nothing.
+ *
+ */
+void q1_merge_task(void *arg) {
+    partition_pair *pair = (partition_pair *)arg;
+    perf_mark mark;
+    perf_begin(&mark);
+    pair->into->partial = q1_count_merge((q1_count_node *)pair->into->partial, (q1_count_node *)pair->from->partial);
+    perf_end(&mark, PERF_MERGE);
+    count_arena_join(&pair->into->counts, &pair->from->counts);
+    pair->from->partial = NULL;
+}
+
+/**
+ * @brief This function answers q1: What are the top N airlines that offer the greatest number of routes with destination country as Canada?
+ *        Every data file is ingested into a partial count list by its own pool task, the partial lists are
+ *        merged into one, and the merged list is outputted into output.csv.
+ *
+ * @param pool The pool running the parse and merge tasks.
+ * @param data_files The yaml files full of airline route information.
+ * @param n The number of elements that will be outputted.
+ * @param filter The predicates a route must pass to be counted.
+ * @return void: nothing.
+ *
+ */
+void q1(thread_pool *pool, glob_t *data_files, int n, const route_filter *filter) {
+    int count = (int)data_files->gl_pathc;
+    partition *parts = (partition *)emalloc(count * sizeof(partition));
+
+    // Read every partition in parallel, then merge the partial count lists into parts[0]
+    ingest_partitions(pool, data_files, parts, q1_partition_worker, filter);
+    merge_partitions(pool, parts, count, q1_merge_task);
+    q1_count_node *count_head = (q1_count_node *)parts[0].partial;
+
+    // Print the count linked list
+    q1_count_node *count_temp = count_head;
+    perf_mark mark;
+    perf_begin(&mark);
+    q1_output_vals(count_temp, n);
+    perf_end(&mark, PERF_OUTPUT);
+
+    // Free the allocated memory for the count list
+    count_arena_free(&parts[0].counts);
+    free(parts);
+}
+
+/**
+ * @brief this function answers and outputs the contents of the linked list containing vals to be outputted
+ *        in a formatted manner
+ *
+ * @param head the begining of the linked list containing vals to be outputted
+ * @param n the number of elements that will be outputted
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int q2_output_vals(q2_count_node *head, int n) {
+    // Open the file "output.csv" for writing
+    FILE *file = fopen("output.csv", "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file for writing\n");
+        return 1;
+    }
+
+    // Write the CSV header
+    fputs("subject,statistic\n", file);
+    
+    // Lay the list out as a count table, so the selection scans only the packed counts
+    count_table table;
+    q2_count_table(head, &table);
+
+    for (int i = 0; i < n; i++) {
+        // Take the group with the lowest count; ties go to the earliest in the list
+        int taken = count_table_take(&table, 0);
+        if (taken < 0) {
+            // No groups left to process
+            break;
+        }
+
+        // Print the group's details, kept in its cold node, to the file
+        q2_count_node *node = (q2_count_node *)table.nodes[taken];
+        fprintf(file, "%s,%d\n", node->q2_count->to_airport_country, node->count);
+    }
+    count_table_free(&table);
+
+    // Close the file
+    fclose(file);
+    return 0;
+}
+
+/**
+ * @brief This function builds the partial count list of one partition for q2.
+ *        It reads the routes of the yaml file into a general sorted linked list and compiles that into
+ *        a count list, freeing the route list before returning.
+ *
+ * @param data_file The yaml file full of airline route information.
+ * @param filter The predicates a route must pass to be counted.
+ * @param counts The arena the count list is allocated from.
+ * @return q2_count_node*: The head of the count list, or NULL if the file has no matching routes.
+ *
+ */
+q2_count_node *q2_count_file(const char *data_file, const route_filter *filter, count_arena *counts) {
+    node_t *head = NULL;
+    node_arena arena;
+    node_arena_init(&arena);
+    perf_mark mark;
+
+    //read the yaml file
+    perf_begin(&mark);
+    read_yaml(data_file, &head, &arena, 2, filter);
+    perf_end(&mark, PERF_INGEST);
+
+    // Compile the route list into the count list
+    perf_begin(&mark);
+    q2_count_node *count_head = make_q2_count_list(head, NULL, counts);
+    perf_end(&mark, PERF_COUNT);
+
+    // Free the nodes of the original list
+    node_arena_free(&arena);
+    return count_head;
+}
+
+/**
+ * @brief This function is the pool task that ingests one q2 partition.
+ *
+ * @param arg The partition to ingest.
+ * @return void: nothing.
+ *
+ */
+void q2_partition_worker(void *arg) {
+    partition *part = (partition *)arg;
+    part->partial = q2_count_file(part->data_file, part->filter, &part->counts);
+}
+
+/**
+ * @brief This function is the pool task that merges the q2 count list of one partition into another's.
+ *
+ * @param arg The partition_pair to merge.
+ * @return void: nothing.
+ *
+ */
+void q2_merge_task(void *arg) {
+    partition_pair *pair = (partition_pair *)arg;
+    perf_mark mark;
+    perf_begin(&mark);
+    pair->into->partial = q2_count_merge((q2_count_node *)pair->into->partial, (q2_count_node *)pair->from->partial);
+    perf_end(&mark, PERF_MERGE);
+    count_arena_join(&pair->into->counts, &pair->from->counts);
+    pair->from->partial = NULL;
+}
+
+/**
+ * @brief This function answers q2: What are the top N countries with the least appearances as destination countries on the routes data?
+ *        Every data file is ingested into a partial count list by its own pool task, the partial lists are
+ *        merged into one, and the merged list is outputted into output.csv.
+ *
+ * @param pool The pool running the parse and merge tasks.
+ * @param data_files The yaml files full of airline route information.
+ * @param n The number of elements that will be outputted.
+ * @param filter The predicates a route must pass to be counted.
+ * @return void: nothing.
+ *
+ */
+void q2(thread_pool *pool, glob_t *data_files, int n, const route_filter *filter) {
+    int count = (int)data_files->gl_pathc;
+    partition *parts = (partition *)emalloc(count * sizeof(partition));
+
+    // Read every partition in parallel, then merge the partial count lists into parts[0]
+    ingest_partitions(pool, data_files, parts, q2_partition_worker, filter);
+    merge_partitions(pool, parts, count, q2_merge_task);
+    q2_count_node *count_head = (q2_count_node *)parts[0].partial;
+
+    // Print the count linked list
+    q2_count_node *count_temp = count_head;
+    perf_mark mark;
+    perf_begin(&mark);
+    q2_output_vals(count_temp, n);
+    perf_end(&mark, PERF_OUTPUT);
+
+    // Free the allocated memory for the count list
+    count_arena_free(&parts[0].counts);
+    free(parts);
+}
+
+/**
+ * @brief This function answers and outputs the contents of the linked list containing values to be outputted
+ *        in a formatted manner.
+ *
+ * @param head The beginning of the linked list containing values to be outputted.
+ * @param n The number of elements that will be outputted.
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int q3_output_vals(q3_count_node *head, int n) {
+    // Open the file "output.csv" for writing
+    FILE *file = fopen("output.csv", "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file for writing\n");
+        return 1;
+    }
+
+    // Write the CSV header
+    fputs("subject,statistic\n", file);
+    
+    // Lay the list out as a count table, so the selection scans only the packed counts
+    count_table table;
+    q3_count_table(head, &table);
+
+    for (int i = 0; i < n; i++) {
+        // Take the group with the highest count; ties go to the earliest in the list
+        int taken = count_table_take(&table, 1);
+        if (taken < 0) {
+            // No groups left to process
+            break;
+        }
+
+        // Print the group's details, kept in its cold node, to the file
+        q3_count_node *node = (q3_count_node *)table.nodes[taken];
+        fprintf(file, "\"%s (%s), %s, %s\",%d\n", node->q3_count->to_airport_name, node->q3_count->to_airport_icao_unique_code,
+                                                  node->q3_count->to_airport_city, node->q3_count->to_airport_country, node->count);
+    }
+    count_table_free(&table);
+
+    // Close the file
+    fclose(file);
+    return 0;
+}
+
+/**
+ * @brief This function builds the partial count list of one partition for q3.
+ *        It reads the routes of the yaml file into a general sorted linked list and compiles that into
+ *        a count list, freeing the route list before returning.
+ *
+ * @param data_file The yaml file full of airline route information.
+ * @param filter The predicates a route must pass to be counted.
+ * @param counts The arena the count list is allocated from.
+ * @return q3_count_node*: The head of the count list, or NULL if the file has no matching routes.
+ *
+ */
+q3_count_node *q3_count_file(const char *data_file, const route_filter *filter, count_arena *counts) {
+    node_t *head = NULL;
+    node_arena arena;
+    node_arena_init(&arena);
+    perf_mark mark;
+
+    //read the yaml file
+    perf_begin(&mark);
+    read_yaml(data_file, &head, &arena, 3, filter);
+    perf_end(&mark, PERF_INGEST);
+
+    // Compile the route list into the count list
+    perf_begin(&mark);
+    q3_count_node *count_head = make_q3_count_list(head, NULL, counts);
+    perf_end(&mark, PERF_COUNT);
+
+    // Free the nodes of the original list
+    node_arena_free(&arena);
+    return count_head;
+}
+
+/**
+ * @brief This function is the pool task that ingests one q3 partition.
+ *
+ * @param arg The partition to ingest.
+ * @return void: nothing.
+ *
+ */
+void q3_partition_worker(void *arg) {
+    partition *part = (partition *)arg;
+    part->partial = q3_count_file(part->data_file, part->filter, &part->counts);
+}
+
+/**
+ * @brief This function is the pool task that merges the q3 count list of one partition into another's.
+ *
+ * @param arg The partition_pair to merge.
+ * @return void: nothing.
+ *
+ */
+void q3_merge_task(void *arg) {
+    partition_pair *pair = (partition_pair *)arg;
+    perf_mark mark;
+    perf_begin(&mark);
+    pair->into->partial = q3_count_merge((q3_count_node *)pair->into->partial, (q3_count_node *)pair->from->partial);
+    perf_end(&mark, PERF_MERGE);
+    count_arena_join(&pair->into->counts, &pair->from->counts);
+    pair->from->partial = NULL;
+}
+
+/**
+ * @brief This function answers q3: What are the top N destination airports?
+ *        Every data file is ingested into a partial count list by its own pool task, the partial lists are
+ *        merged into one, and the merged list is outputted into output.csv.
+ *
+ * @param pool The pool running the parse and merge tasks.
+ * @param data_files The yaml files full of airline route information.
+ * @param n The number of elements that will be outputted.
+ * @param filter The predicates a route must pass to be counted.
+ * @return void: nothing.
+ *
+ */
+void q3(thread_pool *pool, glob_t *data_files, int n, const route_filter *filter) {
+    int count = (int)data_files->gl_pathc;
+    partition *parts = (partition *)emalloc(count * sizeof(partition));
+
+    // Read every partition in parallel, then merge the partial count lists into parts[0]
+    ingest_partitions(pool, data_files, parts, q3_partition_worker, filter);
+    merge_partitions(pool, parts, count, q3_merge_task);
+    q3_count_node *count_head = (q3_count_node *)parts[0].partial;
+
+    // Print the count linked list
+    q3_count_node *count_temp = count_head;
+    perf_mark mark;
+    perf_begin(&mark);
+    q3_output_vals(count_temp, n);
+    perf_end(&mark, PERF_OUTPUT);
+
+    // Free the allocated memory for the count list
+    count_arena_free(&parts[0].counts);
+    free(parts);
+}
+
+/**
+ * @brief This function answers and outputs the altitude statistics of each group in a formatted manner,
+ *        starting from the group with the highest mean altitude
+ *
+ * @param q4_counts the array of per-country altitude statistics
+ * @param groups the number of entries in q4_counts
+ * @param n the number of elements that will be outputted
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int q4_output_vals(Q4_count *q4_counts, int groups, int n) {
+    // Open the file "output.csv" for writing
+    FILE *file = fopen("output.csv", "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file for writing\n");
+        return 1;
+    }
+
+    // Write the CSV header, one column per histogram bucket
+    fputs("subject,min,max,mean,invalid", file);
+    for (int b = 0; b < ALTITUDE_BUCKETS - 1; b++) {
+        fprintf(file, ",%.0f-%.0f", b * ALTITUDE_BUCKET_WIDTH, (b + 1) * ALTITUDE_BUCKET_WIDTH - 1);
+    }
+    fprintf(file, ",%.0f+\n", (ALTITUDE_BUCKETS - 1) * ALTITUDE_BUCKET_WIDTH);
+
+    // Flags marking the groups that have already been written
+    char *written = (char *)emalloc(groups > 0 ? groups : 1);
+    memset(written, 0, groups);
+
+    for (int i = 0; i < n && i < groups; i++) {
+        // Find the remaining group with the highest mean altitude
+        int max_mean = -1;
+        for (int g = 0; g < groups; g++) {
+            if (!written[g] && (max_mean == -1 || q4_counts[g].stats.mean > q4_counts[max_mean].stats.mean)) {
+                max_mean = g;
+            }
+        }
+
+        // Print the group's aggregates to the file
+        altitude_stats *stats = &q4_counts[max_mean].stats;
+        fprintf(file, "%s,%.1f,%.1f,%.1f,%d", q4_counts[max_mean].to_airport_country, stats->min, stats->max, stats->mean,
+                                             stats->invalid);
+        for (int b = 0; b < ALTITUDE_BUCKETS; b++) {
+            fprintf(file, ",%d", stats->buckets[b]);
+        }
+        fputc('\n', file);
+        written[max_mean] = 1;
+    }
+
+    // Close the file
+    free(written);
+    fclose(file);
+    return 0;
+}
+
+/**
+ * @brief This function builds the per-country altitude statistics of one partition for q4.
+ *        It reads the routes of the yaml file into a general linked list sorted by country, packs the
+ *        parsed altitudes into contiguous columns, and runs the aggregation kernel over each country's slice.
+ *
+ * @param data_file the yaml file full of airline route information
+ * @param filter the predicates a route must pass to be aggregated
+ * @param groups set to the number of countries found
+ * @return Q4_count*: the statistics of each country, sorted by country
+ *
+ */
+Q4_count *q4_count_file(const char *data_file, const route_filter *filter, int *groups) {
+    node_t *head = NULL;
+    node_arena arena;
+    node_arena_init(&arena);
+    //read the yaml file
+    read_yaml(data_file, &head, &arena, 4, filter);
+
+    // Count the countries so the group arrays can be allocated once
+    int group_count = 0;
+    char *last_country = "";
+    for (node_t *temp = head; temp != NULL; temp = temp->next) {
+        if (strcmp(temp->route.to_airport_country, last_country) != 0) {
+            last_country = temp->route.to_airport_country;
+            group_count++;
+        }
+    }
+
+    Q4_count *q4_counts = (Q4_count *)emalloc((group_count > 0 ? group_count : 1) * sizeof(Q4_count));
+    int *group_start = (int *)emalloc((group_count + 1) * sizeof(int));
+
+    // Pack the altitudes into columns; the list is sorted, so each country is one contiguous slice
+    altitude_columns cols;
+    altitude_columns_init(&cols);
+    group_count = 0;
+    last_country = "";
+    for (node_t *temp = head; temp != NULL; temp = temp->next) {
+        if (strcmp(temp->route.to_airport_country, last_country) != 0) {
+            last_country = temp->route.to_airport_country;
+            strcpy(q4_counts[group_count].to_airport_country, last_country);
+            group_start[group_count] = cols.size;
+            group_count++;
+        }
+        altitude_columns_append(&cols, temp->route.from_altitude, temp->route.to_altitude, temp->route.altitude_flags);
+    }
+    group_start[group_count] = cols.size;
+
+    // Run the aggregation kernel over each country's slice of the destination column
+    for (int g = 0; g < group_count; g++) {
+        int start = group_start[g];
+        altitude_group_stats(cols.to_altitude + start, cols.to_valid + start, group_start[g + 1] - start, &q4_counts[g].stats);
+    }
+
+    // Free the nodes of the original list
+    node_arena_free(&arena);
+
+    // Free the columns and the group boundaries
+    altitude_columns_free(&cols);
+    free(group_start);
+
+    *groups = group_count;
+    return q4_counts;
+}
+
+/**
+ * @brief this function merges two arrays of per-country statistics, both sorted by country
+ *
+ * @param a the first array, freed by this function
+ * @param a_groups the number of entries in a
+ * @param b the second array, freed by this function
+ * @param b_groups the number of entries in b
+ * @param groups set to the number of entries in the merged array
+ * @return Q4_count*: the merged array, sorted by country
+ *
+ */
+Q4_count *q4_count_merge(Q4_count *a, int a_groups, Q4_count *b, int b_groups, int *groups) {
+    Q4_count *merged = (Q4_count *)emalloc((a_groups + b_groups > 0 ? a_groups + b_groups : 1) * sizeof(Q4_count));
+    int i = 0, j = 0, k = 0;
+
+    // Walk both arrays in country order, combining the statistics of countries found in both
+    while (i < a_groups || j < b_groups) {
+        int cmp;
+        if (i == a_groups) {
+            cmp = 1;
+        } else if (j == b_groups) {
+            cmp = -1;
+        } else {
+            cmp = strcmp(a[i].to_airport_country, b[j].to_airport_country);
+        }
+
+        if (cmp < 0) {
+            merged[k++] = a[i++];
+        } else if (cmp > 0) {
+            merged[k++] = b[j++];
+        } else {
+            merged[k] = a[i++];
+            altitude_stats_merge(&merged[k++].stats, &b[j++].stats);
+        }
+    }
+
+    free(a);
+    free(b);
+    *groups = k;
+    return merged;
+}
+
+/**
+ * @brief This function is the pool task that ingests one q4 partition.
+ *
+ * @param arg The partition to ingest.
+ * @return void: nothing
+ *
+ */
+void q4_partition_worker(void *arg) {
+    partition *part = (partition *)arg;
+    part->partial = q4_count_file(part->data_file, part->filter, &part->size);
+}
+
+/**
+ * @brief This function is the pool task that merges the q4 statistics of one partition into another's.
+ *
+ * @param arg The partition_pair to merge.
+ * @return void: nothing
+ *
+ */
+void q4_merge_task(void *arg) {
+    partition_pair *pair = (partition_pair *)arg;
+    pair->into->partial = q4_count_merge((Q4_count *)pair->into->partial, pair->into->size,
+                                         (Q4_count *)pair->from->partial, pair->from->size, &pair->into->size);
+    pair->from->partial = NULL;
+    pair->from->size = 0;
+}
+
+/**
+ * @brief This function answers q4: What are the destination airport altitudes (min, max, mean and histogram)
+ *        of each destination country?
+ *        Every data file is aggregated by its own pool task and the per-country statistics are merged.
+ *
+ * @param pool the pool running the parse and merge tasks
+ * @param data_files the yaml files full of airline route information
+ * @param n the number of elements that will be outputted
+ * @param filter the predicates a route must pass to be aggregated
+ * @return void: nothing
+ *
+ */
+void q4(thread_pool *pool, glob_t *data_files, int n, const route_filter *filter) {
+    int count = (int)data_files->gl_pathc;
+    partition *parts = (partition *)emalloc(count * sizeof(partition));
+
+    // Read every partition in parallel, then merge the partial statistics into parts[0]
+    ingest_partitions(pool, data_files, parts, q4_partition_worker, filter);
+    merge_partitions(pool, parts, count, q4_merge_task);
+    Q4_count *q4_counts = (Q4_count *)parts[0].partial;
+    int groups = parts[0].size;
+    free(parts);
+
+    q4_output_vals(q4_counts, groups, n);
+    free(q4_counts);
+}
+
+/**
+ * @brief Struct representing the group-by fed by read_yaml_records under --MEMORY_LIMIT.
+ */
+typedef struct {
+    spill_aggregator agg;
+    int question;
+} spill_query;
+
+/**
+ * @brief this function counts one parsed route towards its group for questions 1 to 3 under --MEMORY_LIMIT
+ *
+ * @param route the parsed route
+ * @param ctx the spill_query being answered
+ * @return void: nothing
+ *
+ */
+void spill_visit_route(Route *route, void *ctx) {
+    spill_query *query = (spill_query *)ctx;
+    char label[ROUTE_LABEL_SIZE];
+    const char *key, *tie;
+
+    if (route_group(route, query->question, &key, &tie, label)) {
+        spill_add(&query->agg, key, tie, label);
+    }
+}
+
+/**
+ * @brief this function answers questions 1 to 3 within a memory budget. The groups are counted in a table that
+ *        spills sorted runs to temporary files whenever it outgrows the budget, and the runs are combined with a
+ *        k-way merge, so the output matches the in-memory path for any number of groups.
+ *
+ * @param data_files the yaml files full of airline route information
+ * @param question the question number that is being answered
+ * @param n the number of elements that will be outputted
+ * @param memory_limit the number of bytes the groups may use
+ * @param filter the predicates a route must pass to be counted
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int spill_answer(glob_t *data_files, int question, int n, size_t memory_limit, const route_filter *filter) {
+    spill_query query;
+    query.question = question;
+
+    // q2 ranks the least frequent groups first, q3 breaks ties on descending airport name
+    spill_init(&query.agg, memory_limit, question != 2, question == 3);
+
+    // Stream every partition through the group-by; only one record is held at a time
+    for (size_t i = 0; i < data_files->gl_pathc; i++) {
+        read_yaml_routes(data_files->gl_pathv[i], question_fields(question), filter, spill_visit_route, &query);
+    }
+
+    spill_row **top = (spill_row **)emalloc((n > 0 ? n : 1) * sizeof(spill_row *));
+    int rows = spill_top(&query.agg, top, n);
+
+    // Open the file "output.csv" for writing
+    FILE *file = fopen("output.csv", "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file for writing\n");
+        spill_free(&query.agg);
+        return 1;
+    }
+
+    // Write the CSV header and the selected groups
+    fputs("subject,statistic\n", file);
+    for (int i = 0; i < rows; i++) {
+        fprintf(file, "%s,%d\n", top[i]->label, top[i]->count);
+        free(top[i]);
+    }
+
+    // Close the file
+    fclose(file);
+    free(top);
+    spill_free(&query.agg);
+    return 0;
+}
+
+/**
+ * @brief Struct representing a question answered with the shared concurrent map backend.
+ */
+typedef struct {
+    concurrent_map *map;
+    int question;
+    const route_filter *filter;     // The predicates a route must pass to be counted
+} hash_query;
+
+/**
+ * @brief Struct representing one data file ingested into the shared map by a pool task.
+ */
+typedef struct {
+    const char *data_file;
+    hash_query *query;
+} hash_partition;
+
+/**
+ * @brief this function fills in the Q1_count stored with a new airline in the map
+ *
+ * @param value the Q1_count to fill in
+ * @param ctx the route that introduced the airline
+ * @return void: nothing
+ *
+ */
+void init_q1_count_value(void *value, const void *ctx) {
+    const Route *src = (const Route *)ctx;
+    Q1_count *dst = (Q1_count *)value;
+    memset(dst, 0, sizeof(Q1_count));
+    Q1_COUNT_FIELDS(COUNT_FIELD_COPY)
+}
+
+/**
+ * @brief this function fills in the Q2_count stored with a new country in the map
+ *
+ * @param value the Q2_count to fill in
+ * @param ctx the route that introduced the country
+ * @return void: nothing
+ *
+ */
+void init_q2_count_value(void *value, const void *ctx) {
+    const Route *src = (const Route *)ctx;
+    Q2_count *dst = (Q2_count *)value;
+    memset(dst, 0, sizeof(Q2_count));
+    Q2_COUNT_FIELDS(COUNT_FIELD_COPY)
+}
+
+/**
+ * @brief this function fills in the Q3_count stored with a new airport in the map
+ *
+ * @param value the Q3_count to fill in
+ * @param ctx the route that introduced the airport
+ * @return void: nothing
+ *
+ */
+void init_q3_count_value(void *value, const void *ctx) {
+    const Route *src = (const Route *)ctx;
+    Q3_count *dst = (Q3_count *)value;
+    memset(dst, 0, sizeof(Q3_count));
+    Q3_COUNT_FIELDS(COUNT_FIELD_COPY)
+}
+
+/**
+ * @brief this function counts one parsed route in the shared map
+ *
+ * @param route the parsed route
+ * @param ctx the hash_query being answered
+ * @return void: nothing
+ *
+ */
+void hash_visit_route(Route *route, void *ctx) {
+    hash_query *query = (hash_query *)ctx;
+    map_entry *entry = NULL;
+
+    if (query->question == 1) {
+        entry = concurrent_map_add(query->map, route->airline_name, 1, init_q1_count_value, route, sizeof(Q1_count));
+    } else if (query->question == 2) {
+        entry = concurrent_map_add(query->map, route->to_airport_country, 1, init_q2_count_value, route, sizeof(Q2_count));
+    } else if (query->question == 3) {
+        entry = concurrent_map_add(query->map, route->to_airport_name, 1, init_q3_count_value, route, sizeof(Q3_count));
+    } else {
+        return;
+    }
+
+    if (entry == NULL) {
+        fprintf(stderr, "Error: out of memory adding to the concurrent map\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * @brief this function is the pool task that parses one data file into the shared map
+ *
+ * @param arg the hash_partition to ingest
+ * @return void: nothing
+ *
+ */
+void hash_partition_worker(void *arg) {
+    hash_partition *part = (hash_partition *)arg;
+    read_yaml_routes(part->data_file, question_fields(part->query->question), part->query->filter, hash_visit_route, part->query);
+}
+
+/**
+ * @brief qsort comparators putting map entries in the order of the q1, q2 and q3 count lists
+ *
+ */
+int compare_q1_entries(const void *a, const void *b) {
+    return q1_count_compare((*(map_entry *const *)a)->value, (*(map_entry *const *)b)->value);
+}
+
+int compare_q2_entries(const void *a, const void *b) {
+    return q2_count_compare((*(map_entry *const *)a)->value, (*(map_entry *const *)b)->value);
+}
+
+int compare_q3_entries(const void *a, const void *b) {
+    return q3_count_compare((*(map_entry *const *)a)->value, (*(map_entry *const *)b)->value);
+}
+
+/**
+ * @brief this function writes the top n groups of a filled shared map to output.csv. The map is turned into
+ *        the usual count list so the output matches the list backend.
+ *
+ * @param query the hash_query whose map every partition has been parsed into
+ * @param n the number of elements that will be outputted
+ * @return void: nothing
+ *
+ */
+void hash_output(hash_query *query, int n) {
+    int question = query->question;
+
+    // Sort the entries into count list order
+    size_t entry_count;
+    map_entry **entries = concurrent_map_entries(query->map, &entry_count);
+    int (*compare)(const void *, const void *) = (question == 1) ? compare_q1_entries
+                                               : (question == 2) ? compare_q2_entries : compare_q3_entries;
+    qsort(entries, entry_count, sizeof(map_entry *), compare);
+
+    // Build the count list back to front, then output and free it
+    count_arena counts;
+    count_arena_init(&counts);
+    if (question == 1) {
+        q1_count_node *count_head = NULL;
+        for (size_t i = entry_count; i > 0; i--) {
+            q1_count_node *node = q1_count_new_node(&counts, (Q1_count *)entries[i - 1]->value, entries[i - 1]->count);
+            node->next = count_head;
+            count_head = node;
+        }
+        q1_output_vals(count_head, n);
+    } else if (question == 2) {
+        q2_count_node *count_head = NULL;
+        for (size_t i = entry_count; i > 0; i--) {
+            q2_count_node *node = q2_count_new_node(&counts, (Q2_count *)entries[i - 1]->value, entries[i - 1]->count);
+            node->next = count_head;
+            count_head = node;
+        }
+        q2_output_vals(count_head, n);
+    } else {
+        q3_count_node *count_head = NULL;
+        for (size_t i = entry_count; i > 0; i--) {
+            q3_count_node *node = q3_count_new_node(&counts, (Q3_count *)entries[i - 1]->value, entries[i - 1]->count);
+            node->next = count_head;
+            count_head = node;
+        }
+        q3_output_vals(count_head, n);
+    }
+    count_arena_free(&counts);
+
+    free(entries);
+}
+
+/**
+ * @brief this function parses every partition in parallel, each in its own pool task, into the shared map
+ *        of a hash_query
+ *
+ * @param pool the pool running the parse tasks
+ * @param data_files the yaml files full of airline route information
+ * @param query the hash_query to fill
+ * @return void: nothing
+ *
+ */
+void hash_ingest(thread_pool *pool, glob_t *data_files, hash_query *query) {
+    int count = (int)data_files->gl_pathc;
+
+    hash_partition *parts = (hash_partition *)emalloc((count > 0 ? count : 1) * sizeof(hash_partition));
+    for (int i = 0; i < count; i++) {
+        parts[i].data_file = data_files->gl_pathv[i];
+        parts[i].query = query;
+    }
+    task_group group;
+    task_group_init(&group);
+    thread_pool_submit_batch(pool, &group, hash_partition_worker, parts, count, sizeof(hash_partition));
+    thread_pool_wait(pool, &group);
+    task_group_destroy(&group);
+    free(parts);
+}
+
+/**
+ * @brief this function answers questions 1 to 3 with --BACKEND=hash: every partition is parsed by its own pool
+ *        task straight into one lock-free map, so no per-file count lists have to be built or merged.
+ *
+ * @param pool the pool running the parse tasks
+ * @param data_files the yaml files full of airline route information
+ * @param question the question number that is being answered
+ * @param n the number of elements that will be outputted
+ * @param filter the predicates a route must pass to be counted
+ * @return void: nothing
+ *
+ */
+void hash_answer(thread_pool *pool, glob_t *data_files, int question, int n, const route_filter *filter) {
+    hash_query query = { concurrent_map_create(0), question, filter };
+
+    hash_ingest(pool, data_files, &query);
+    hash_output(&query, n);
+    concurrent_map_free(query.map);
+}
+
+/**
+ * @brief this function writes the subject of a q1, q2 or q3 count as output.csv shows it, without the quotes
+ *        output.csv puts around q3 subjects, since the writers quote what needs it
+ *
+ * @param question the question number
+ * @param value the Q1_count, Q2_count or Q3_count
+ * @param label the buffer of ROUTE_LABEL_SIZE bytes to write to
+ * @return void: nothing
+ *
+ */
+void count_subject(int question, const void *value, char *label) {
+    if (question == 1) {
+        const Q1_count *c = (const Q1_count *)value;
+        snprintf(label, ROUTE_LABEL_SIZE, "%s (%s)", c->airline_name, c->airline_icao_unique_code);
+    } else if (question == 2) {
+        const Q2_count *c = (const Q2_count *)value;
+        snprintf(label, ROUTE_LABEL_SIZE, "%s", c->to_airport_country);
+    } else {
+        const Q3_count *c = (const Q3_count *)value;
+        snprintf(label, ROUTE_LABEL_SIZE, "%s (%s), %s, %s", c->to_airport_name, c->to_airport_icao_unique_code,
+                 c->to_airport_city, c->to_airport_country);
+    }
+}
+
+/**
+ * @brief Ranking order of the map entries, set by rank_entries for compare_ranked_entries.
+ */
+static int (*rank_order)(const void *, const void *);
+static int rank_descending;
+
+/**
+ * @brief qsort comparator ranking map entries like the output of their question: by count, then by the order
+ *        of the count list, which is the order output.csv breaks ties in
+ *
+ */
+int compare_ranked_entries(const void *a, const void *b) {
+    int x = (*(map_entry *const *)a)->count;
+    int y = (*(map_entry *const *)b)->count;
+
+    if (x != y) {
+        return ((x > y) == rank_descending) ? -1 : 1;
+    }
+    return rank_order(a, b);
+}
+
+/**
+ * @brief this function sorts the map entries of every group of question 1, 2 or 3 into the order output.csv
+ *        ranks them in; q2 ranks the least frequent groups first
+ *
+ * @param question the question number
+ * @param entries the entries of the shared map
+ * @param entry_count the number of entries
+ * @return void: nothing
+ *
+ */
+void rank_entries(int question, map_entry **entries, size_t entry_count) {
+    rank_order = (question == 1) ? compare_q1_entries : (question == 2) ? compare_q2_entries : compare_q3_entries;
+    rank_descending = (question != 2);
+    qsort(entries, entry_count, sizeof(map_entry *), compare_ranked_entries);
+}
+
+/**
+ * @brief this function writes ranked map entries of question 1, 2 or 3 as a "subject,statistic" table
+ *
+ * @param question the question number
+ * @param entries the entries, in the order they are written
+ * @param entry_count the number of entries
+ * @param path the file the table is written to
+ * @param format how the rows are written
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int export_entries(int question, map_entry **entries, size_t entry_count, const char *path, export_format format) {
+    static const char *names[] = { "subject", "statistic" };
+    char label[ROUTE_LABEL_SIZE];
+    const char *text[] = { label };
+    exporter out;
+
+    if (export_open(&out, path, format, names, 1) != 0) {
+        return 1;
+    }
+    for (size_t i = 0; i < entry_count; i++) {
+        count_subject(question, entries[i]->value, label);
+        export_row(&out, text, entries[i]->count);
+    }
+    return export_close(&out);
+}
+
+/**
+ * @brief this function answers --EXPORT= for questions 1 to 3: every group is counted in the shared map and the
+ *        complete ranked table, not only the top n, is written to the export path in the export format
+ *
+ * @param pool the pool running the parse tasks
+ * @param data_files the yaml files full of airline route information
+ * @param question the question number that is being answered
+ * @param filter the predicates a route must pass to be counted
+ * @param path the file the table is written to
+ * @param format how the rows are written
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int export_answer(thread_pool *pool, glob_t *data_files, int question, const route_filter *filter, const char *path,
+                  export_format format) {
+    perf_mark mark;
+
+    if ((question < 1) || (question > 3)) {
+        fprintf(stderr, "Error: --EXPORT exports questions 1 to 3 and --PIVOT\n");
+        return 1;
+    }
+    hash_query query = { concurrent_map_create(0), question, filter };
+    hash_ingest(pool, data_files, &query);
+
+    // Rank every group like the output of the question, then write them all
+    perf_begin(&mark);
+    size_t entry_count;
+    map_entry **entries = concurrent_map_entries(query.map, &entry_count);
+    rank_entries(question, entries, entry_count);
+    int result = export_entries(question, entries, entry_count, path, format);
+    perf_end(&mark, PERF_OUTPUT);
+
+    free(entries);
+    concurrent_map_free(query.map);
+    return result;
+}
+
+/**
+ * @brief this function writes the cache query of an exact or sampled answer to questions 1 to 4
+ *
+ * @param query the buffer to write to
+ * @param size the size of the buffer
+ * @param question the question number
+ * @param sample_fraction the fraction given with --SAMPLE=, or 0
+ * @param sample_size the reservoir given with --SAMPLE_SIZE=, or 0
+ * @param where the --WHERE= predicates as written by filter_describe
+ * @return int the length of the whole query, like snprintf; size or more means it did not fit
+ *
+ */
+int question_cache_query(char *query, size_t size, int question, double sample_fraction, int sample_size, const char *where) {
+    // Sampled answers differ from exact ones, so the sample is part of the query
+    return snprintf(query, size, "question=%d sample=%g sample_size=%d where=%s", question, sample_fraction, sample_size, where);
+}
+
+/**
+ * @brief Struct representing one snapshot of a diff: its files, and its full aggregate in the cache or a map.
+ */
+typedef struct {
+    glob_t *data_files;
+    char path[64];          // The "subject,statistic" csv of every group of the snapshot, when it is cached
+    cache_entry entry;
+    hash_query query;       // Used when the aggregate is not cached
+    route_filter where;     // The --WHERE= predicates with the snapshot's own --DEDUP set
+    route_filter filter;    // The predicates of the question over where
+} diff_side;
+
+/**
+ * @brief Struct representing one group of a diff and its count in both snapshots.
+ */
+typedef struct {
+    long counts[2];         // The count in the old and the new snapshot
+} diff_counts;
+
+/**
+ * @brief this function zeroes the counts of a group new to the diff
+ *
+ * @param value the diff_counts to fill in
+ * @param ctx unused
+ * @return void: nothing
+ *
+ */
+void init_diff_counts(void *value, const void *ctx) {
+    (void)ctx;
+    memset(value, 0, sizeof(diff_counts));
+}
+
+/**
+ * @brief this function adds the count of a group in one snapshot to the groups of the diff
+ *
+ * @param map the groups of the diff
+ * @param subject the group as output.csv names it, without csv quotes
+ * @param side 0 for the old snapshot, 1 for the new one
+ * @param count the count of the group in the snapshot
+ * @return void: nothing
+ *
+ */
+void diff_add(concurrent_map *map, const char *subject, int side, long count) {
+    map_entry *entry = concurrent_map_add(map, subject, 0, init_diff_counts, NULL, sizeof(diff_counts));
+    if (entry == NULL) {
+        fprintf(stderr, "Error: out of memory adding to the concurrent map\n");
+        exit(EXIT_FAILURE);
+    }
+    ((diff_counts *)entry->value)->counts[side] += count;
+}
+
+/**
+ * @brief this function reads a cached "subject,statistic" csv into the counts of one snapshot. The statistic
+ *        follows the last comma, since a subject may itself hold commas; a quoted subject is unquoted.
+ *
+ * @param path the csv file
+ * @param map the groups of the diff
+ * @param side 0 for the old snapshot, 1 for the new one
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int read_diff_side(const char *path, concurrent_map *map, int side) {
+    char line[ROUTE_LABEL_SIZE + 64];
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file\n");
+        return 1;
+    }
+    // Skip the header
+    if (fgets(line, sizeof(line), file) == NULL) {
+        fclose(file);
+        return 0;
+    }
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\n")] = '\0';
+        char *comma = strrchr(line, ',');
+        if (comma == NULL) {
+            continue;
+        }
+        *comma = '\0';
+
+        // Drop the quotes around the subject and undouble the quotes inside it
+        char *subject = line;
+        if ((subject[0] == '"') && (comma > subject + 1) && (comma[-1] == '"')) {
+            comma[-1] = '\0';
+            char *to = ++subject;
+            for (const char *from = subject; *from != '\0'; from++) {
+                *to++ = *from;
+                if ((from[0] == '"') && (from[1] == '"')) {
+                    from++;
+                }
+            }
+            *to = '\0';
+        }
+        diff_add(map, subject, side, atol(comma + 1));
+    }
+    fclose(file);
+    return 0;
+}
+
+/**
+ * @brief this function writes a csv field, in double quotes with its quotes doubled if it holds a comma or quote
+ *
+ * @param file the file to write to
+ * @param text the field
+ * @return void: nothing
+ *
+ */
+void write_csv_field(FILE *file, const char *text) {
+    if (strpbrk(text, ",\"") == NULL) {
+        fputs(text, file);
+        return;
+    }
+    fputc('"', file);
+    for (; *text != '\0'; text++) {
+        if (*text == '"') {
+            fputc('"', file);
+        }
+        fputc(*text, file);
+    }
+    fputc('"', file);
+}
+
+/**
+ * @brief Ranking order of the diff, set by diff_answer for compare_diff_entries.
+ */
+static int diff_by_relative;
+
+/**
+ * @brief this function returns the change of a group relative to its old count, or HUGE_VAL for a new group
+ *
+ */
+double diff_relative(const diff_counts *d) {
+    if (d->counts[0] == 0) {
+        return HUGE_VAL;
+    }
+    return (double)(d->counts[1] - d->counts[0]) / d->counts[0];
+}
+
+/**
+ * @brief qsort comparator ranking the groups of a diff by the size of their absolute or relative change,
+ *        then by the other one, then by subject
+ *
+ */
+int compare_diff_entries(const void *a, const void *b) {
+    const map_entry *x = *(map_entry *const *)a;
+    const map_entry *y = *(map_entry *const *)b;
+    const diff_counts *dx = (const diff_counts *)x->value;
+    const diff_counts *dy = (const diff_counts *)y->value;
+    long ax = labs(dx->counts[1] - dx->counts[0]), ay = labs(dy->counts[1] - dy->counts[0]);
+    double rx = fabs(diff_relative(dx)), ry = fabs(diff_relative(dy));
+
+    if (diff_by_relative && rx != ry) {
+        return (rx > ry) ? -1 : 1;
+    }
+    if (ax != ay) {
+        return (ax > ay) ? -1 : 1;
+    }
+    if (!diff_by_relative && rx != ry) {
+        return (rx > ry) ? -1 : 1;
+    }
+    return strcmp(x->key, y->key);
+}
+
+/**
+ * @brief this function compares the q1, q2 or q3 groups of an old snapshot (--DIFF=) with those of the new one
+ *        (--DATA=) and writes the n groups that changed most as "subject,old,new,change,relative". Both full
+ *        aggregates come from the result cache when it holds them; the snapshots that are not cached are
+ *        parsed in one parallel pass and then cached, under the same key as an ordinary run of the question.
+ *
+ * @param pool the pool running the parse tasks
+ * @param old_files the yaml files of the old snapshot
+ * @param new_files the yaml files of the new snapshot
+ * @param question the question number that is being answered
+ * @param n the number of groups that will be outputted
+ * @param by_relative 1 to rank by relative change, 0 by absolute change
+ * @param cache the result cache directory, or NULL
+ * @param where the --WHERE= predicates
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int diff_answer(thread_pool *pool, glob_t *old_files, glob_t *new_files, int question, int n, int by_relative,
+                const char *cache, const route_filter *where) {
+    diff_side sides[2];
+    glob_t *files[2] = { old_files, new_files };
+    const char *names[2] = { "old", "new" };
+    char description[1024];
+    char query[sizeof(sides[0].entry.query)];
+    int missing = 0;
+
+    if ((question < 1) || (question > 3)) {
+        fprintf(stderr, "Error: --DIFF answers questions 1 to 3\n");
+        return 1;
+    }
+    filter_describe(where, description, sizeof(description));
+    if ((question_cache_query(query, sizeof(query), question, 0, 0, description) >= (int)sizeof(query)) && (cache != NULL)) {
+        fprintf(stderr, "Error: the query is too long to be cached\n");
+        return 1;
+    }
+
+    // Take each snapshot's full aggregate from the cache, or prepare to parse it
+    int total_files = 0;
+    for (int s = 0; s < 2; s++) {
+        sides[s].data_files = files[s];
+        snprintf(sides[s].path, sizeof(sides[s].path), "output.csv.%s.%ld.tmp", names[s], (long)getpid());
+        sides[s].query.map = NULL;
+        if (cache != NULL) {
+            cache_entry_init(&sides[s].entry, cache, query, files[s], CACHE_ALL_ROWS);
+            if (cache_load(&sides[s].entry, sides[s].path)) {
+                continue;
+            }
+        }
+        // A route in both snapshots is counted in both, so each snapshot drops only its own repeats
+        sides[s].where = *where;
+        if (where->dedup != NULL) {
+            sides[s].where.dedup = dedup_create(max_groups(files[s]));
+        }
+        question_filter(question, &sides[s].where, &sides[s].filter);
+        sides[s].query.map = concurrent_map_create(0);
+        sides[s].query.question = question;
+        sides[s].query.filter = &sides[s].filter;
+        total_files += (int)files[s]->gl_pathc;
+        missing++;
+    }
+
+    // Parse the files of both snapshots in one batch, each into the map of its snapshot
+    if (missing > 0) {
+        hash_partition *parts = (hash_partition *)emalloc((total_files > 0 ? total_files : 1) * sizeof(hash_partition));
+        int count = 0;
+        for (int s = 0; s < 2; s++) {
+            for (size_t i = 0; sides[s].query.map != NULL && i < files[s]->gl_pathc; i++) {
+                parts[count].data_file = files[s]->gl_pathv[i];
+                parts[count].query = &sides[s].query;
+                count++;
+            }
+        }
+        task_group group;
+        task_group_init(&group);
+        thread_pool_submit_batch(pool, &group, hash_partition_worker, parts, count, sizeof(hash_partition));
+        thread_pool_wait(pool, &group);
+        task_group_destroy(&group);
+        free(parts);
+    }
+
+    // Join the two aggregates by subject
+    concurrent_map *map = concurrent_map_create(0);
+    int result = 0;
+    for (int s = 0; s < 2; s++) {
+        if (sides[s].query.map == NULL) {
+            result |= read_diff_side(sides[s].path, map, s);
+            remove(sides[s].path);
+            continue;
+        }
+        size_t side_count;
+        map_entry **side_entries = concurrent_map_entries(sides[s].query.map, &side_count);
+        char label[ROUTE_LABEL_SIZE];
+        for (size_t i = 0; i < side_count; i++) {
+            count_subject(question, side_entries[i]->value, label);
+            diff_add(map, label, s, side_entries[i]->count);
+        }
+
+        // Cache every group of a parsed snapshot ranked like an ordinary run, so the cache can answer those too
+        if (cache != NULL) {
+            rank_entries(question, side_entries, side_count);
+            if (export_entries(question, side_entries, side_count, sides[s].path, EXPORT_CSV) == 0) {
+                cache_store(&sides[s].entry, sides[s].path);
+                remove(sides[s].path);
+            }
+        }
+        free(side_entries);
+        concurrent_map_free(sides[s].query.map);
+        if (sides[s].where.dedup != NULL) {
+            where->dedup->removed += sides[s].where.dedup->removed;
+            dedup_free(sides[s].where.dedup);
+        }
+    }
+
+    // Rank the groups by how much they changed
+    size_t entry_count;
+    map_entry **entries = concurrent_map_entries(map, &entry_count);
+    diff_by_relative = by_relative;
+    qsort(entries, entry_count, sizeof(map_entry *), compare_diff_entries);
+
+    // Open the file "output.csv" for writing
+    FILE *file = fopen("output.csv", "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file for writing\n");
+        free(entries);
+        concurrent_map_free(map);
+        return 1;
+    }
+
+    // A group missing from the old snapshot has no relative change
+    fputs("subject,old,new,change,relative\n", file);
+    for (size_t i = 0; i < entry_count && i < (size_t)n; i++) {
+        const diff_counts *d = (const diff_counts *)entries[i]->value;
+        write_csv_field(file, entries[i]->key);
+        fprintf(file, ",%ld,%ld,%+ld,", d->counts[0], d->counts[1], d->counts[1] - d->counts[0]);
+        if (d->counts[0] == 0) {
+            fputs("new\n", file);
+        } else {
+            fprintf(file, "%+.4f\n", diff_relative(d));
+        }
+    }
+
+    fclose(file);
+    free(entries);
+    concurrent_map_free(map);
+    return result;
+}
+
+/**
+ * @brief Struct representing one input file and the pivot table built from it by its pool task.
+ */
+typedef struct {
+    const char *data_file;
+    size_t row_offset;      // Offset in Route of the row field
+    size_t col_offset;      // Offset in Route of the column field
+    route_fields fields;    // The row and column fields, the only ones parsed
+    const route_filter *filter; // The predicates a route must pass to be counted
+    pivot_table table;
+} pivot_partition;
+
+/**
+ * @brief this function counts one parsed route in the cell of its two pivot fields
+ *
+ * @param route the parsed route
+ * @param ctx the pivot_partition being built
+ * @return void: nothing
+ *
+ */
+void pivot_visit_route(Route *route, void *ctx) {
+    pivot_partition *part = (pivot_partition *)ctx;
+    pivot_add(&part->table, ROUTE_FIELD_VALUE(route, part->row_offset), ROUTE_FIELD_VALUE(route, part->col_offset), 1);
+}
+
+/**
+ * @brief this function is the pool task that builds the pivot table of one data file
+ *
+ * @param arg the pivot_partition to ingest
+ * @return void: nothing
+ *
+ */
+void pivot_partition_worker(void *arg) {
+    pivot_partition *part = (pivot_partition *)arg;
+    read_yaml_routes(part->data_file, part->fields, part->filter, pivot_visit_route, part);
+}
+
+/**
+ * @brief this function answers --PIVOT=row_field,column_field and --GROUP_TOP=outer_field,inner_field: it counts
+ *        the routes of every pair of values of the two fields in a single pass and writes the n cells with the
+ *        most routes, the whole matrix with --PIVOT_MATRIX, or the n cells with the most routes of every row
+ *        value with --GROUP_TOP= to output.csv. With --EXPORT= every non-empty cell is written instead, ranked
+ *        by the most routes, to the export path in the export format
+ *
+ * @param pool the pool running the parse tasks
+ * @param data_files the yaml files full of airline route information
+ * @param pivot the two field names separated by a comma
+ * @param output what to write from the table
+ * @param n the number of cells that will be outputted, in all or for every row
+ * @param filter the predicates a route must pass to be counted
+ * @param export_path the file given with --EXPORT=, or NULL
+ * @param format how the rows of the export are written
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int pivot_answer(thread_pool *pool, glob_t *data_files, const char *pivot, pivot_output output, int n,
+                 const route_filter *filter, const char *export_path, export_format format) {
+    char row_field[BUFFER_SIZE];
+    char *col_field;
+
+    // Split and look up the two field names
+    strncpy(row_field, pivot, sizeof(row_field) - 1);
+    row_field[sizeof(row_field) - 1] = '\0';
+    col_field = strchr(row_field, ',');
+    if (col_field == NULL) {
+        fprintf(stderr, "Error: --PIVOT and --GROUP_TOP need two fields separated by a comma\n");
+        return 1;
+    }
+    *col_field++ = '\0';
+    size_t row_offset = route_field_offset(row_field);
+    size_t col_offset = route_field_offset(col_field);
+    if (row_offset == ROUTE_FIELD_NONE || col_offset == ROUTE_FIELD_NONE) {
+        fprintf(stderr, "Error: unknown route field in %s\n", pivot);
+        return 1;
+    }
+
+    // Build one table per partition in parallel
+    int count = (int)data_files->gl_pathc;
+    pivot_partition *parts = (pivot_partition *)emalloc(count * sizeof(pivot_partition));
+    for (int i = 0; i < count; i++) {
+        parts[i].data_file = data_files->gl_pathv[i];
+        parts[i].row_offset = row_offset;
+        parts[i].col_offset = col_offset;
+        parts[i].fields = route_field_mask(row_field) | route_field_mask(col_field);
+        parts[i].filter = filter;
+        pivot_init(&parts[i].table);
+    }
+    task_group group;
+    task_group_init(&group);
+    thread_pool_submit_batch(pool, &group, pivot_partition_worker, parts, count, sizeof(pivot_partition));
+    thread_pool_wait(pool, &group);
+    task_group_destroy(&group);
+
+    // Merge the tables into the first one; each holds at most one cell per pair of values
+    for (int i = 1; i < count; i++) {
+        pivot_merge(&parts[0].table, &parts[i].table);
+        pivot_free(&parts[i].table);
+    }
+
+    // Export the complete table of cells, such as every pair of airports
+    if (export_path != NULL) {
+        const char *names[] = { row_field, col_field, "statistic" };
+        exporter out;
+        int result = export_open(&out, export_path, format, names, 2);
+        if (result == 0) {
+            int cell_count;
+            pivot_cell *cells = pivot_ranked_cells(&parts[0].table, &cell_count);
+            for (int i = 0; i < cell_count; i++) {
+                const char *text[] = { cells[i].row, cells[i].col };
+                export_row(&out, text, cells[i].count);
+            }
+            free(cells);
+            result = export_close(&out);
+        }
+        pivot_free(&parts[0].table);
+        free(parts);
+        return result;
+    }
+
+    FILE *file = fopen("output.csv", "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening file!\n");
+        pivot_free(&parts[0].table);
+        free(parts);
+        return 1;
+    }
+    if (output == PIVOT_FULL_MATRIX) {
+        char corner[2 * BUFFER_SIZE];
+        snprintf(corner, sizeof(corner), "%s\\%s", row_field, col_field);
+        pivot_write_matrix(&parts[0].table, file, corner);
+    } else if (output == PIVOT_TOP_PER_ROW) {
+        fputs("subject,statistic\n", file);
+        pivot_write_top_per_row(&parts[0].table, file, n);
+    } else {
+        fprintf(file, "%s,%s,statistic\n", row_field, col_field);
+        pivot_write_top(&parts[0].table, file, n);
+    }
+    fclose(file);
+
+    pivot_free(&parts[0].table);
+    free(parts);
+    return 0;
+}
+
+/**
+ * @brief Struct representing a question answered from a sample.
+ */
+typedef struct {
+    sampler *s;
+    int question;
+} sample_query;
+
+/**
+ * @brief this function counts one sampled route in its group
+ *
+ * @param route the parsed route
+ * @param ctx the sample_query being answered
+ * @return void: nothing
+ *
+ */
+void sample_visit_route(Route *route, void *ctx) {
+    sample_query *query = (sample_query *)ctx;
+    char label[ROUTE_LABEL_SIZE];
+    const char *key, *tie;
+
+    if (route_group(route, query->question, &key, &tie, label)) {
+        sample_count(query->s, key, tie, label);
+    }
+}
+
+/**
+ * @brief this function picks the next block of a --SAMPLE= read at random
+ *
+ * @param ctx the sample_query being answered
+ * @return int 1: The block is read; 0: It is skipped.
+ *
+ */
+int sample_choose_block(void *ctx) {
+    return sample_next_block(((sample_query *)ctx)->s);
+}
+
+/**
+ * @brief this function offers every route of a yaml file to a uniform reservoir of s->reservoir_size routes.
+ *        Whether a route enters the reservoir is decided at its first line, so the routes that do not are
+ *        skipped without being parsed.
+ *
+ * @param data_file the yaml file containing routes of airplanes
+ * @param s the sampler, which counts the routes offered
+ * @param reservoir the routes kept so far
+ * @param fields the route fields to parse; the others are left empty
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int read_yaml_reservoir(const char *data_file, sampler *s, Route *reservoir, route_fields fields) {
+    char line[256];
+    Route *target = NULL;   // The reservoir slot the current route is parsed into, or NULL to skip it
+
+    FILE *file = fopen(data_file, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file\n");
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        if (strstr(line, "- airline_name") != NULL) {
+            // The i-th route replaces a random slot with probability k / i
+            long slot = s->population++;
+            if (slot >= s->reservoir_size) {
+                slot = (long)(sample_random(s) * s->population);
+            }
+            target = (slot < s->reservoir_size) ? &reservoir[slot] : NULL;
+            if (target != NULL) {
+                memset(target, 0, sizeof(Route));
+            }
+        }
+        if (target != NULL) {
+            parse_line(line, target, fields);
+        }
+    }
+
+    fclose(file);
+    return 0;
+}
+
+/**
+ * @brief this function answers questions 1 to 3 approximately from a sample: --SAMPLE= reads a fraction of
+ *        the blocks of every file and --SAMPLE_SIZE= keeps a reservoir of routes. Every output row gets the
+ *        estimated count in the whole input and its 95% confidence interval.
+ *
+ * @param data_files the yaml files full of airline route information
+ * @param question the question number that is being answered
+ * @param n the number of elements that will be outputted
+ * @param fraction the fraction of blocks to read, or 0 to use the reservoir
+ * @param reservoir_size the number of routes to keep in the reservoir
+ * @param filter the predicates a route must pass to be counted
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int sample_answer(glob_t *data_files, int question, int n, double fraction, int reservoir_size, const route_filter *filter) {
+    sampler s;
+    sample_query query = { &s, question };
+
+    if ((fraction > 0) ? (fraction > 1) : (reservoir_size <= 0)) {
+        fprintf(stderr, "Error: --SAMPLE needs a fraction in (0, 1] and --SAMPLE_SIZE a positive count\n");
+        return 1;
+    }
+    sample_init(&s, fraction, reservoir_size);
+
+    if (fraction > 0) {
+        // Count the routes of the chosen blocks as they are read; a pipe has no blocks to choose from
+        for (size_t i = 0; i < data_files->gl_pathc; i++) {
+            if (read_yaml_blocks(data_files->gl_pathv[i], SAMPLE_BLOCK, sample_choose_block, question_fields(question),
+                                 filter, sample_visit_route, &query) < 0) {
+                sample_free(&s);
+                return 1;
+            }
+        }
+    } else {
+        // Fill the reservoir from every file, then count the routes that stayed in it and pass the filter.
+        // Routes enter the reservoir before they are parsed, so the filter cannot be checked any sooner.
+        Route *reservoir = (Route *)emalloc(reservoir_size * sizeof(Route));
+        for (size_t i = 0; i < data_files->gl_pathc; i++) {
+            read_yaml_reservoir(data_files->gl_pathv[i], &s, reservoir, question_fields(question) | filter->fields);
+        }
+        for (long i = 0; i < s.population && i < reservoir_size; i++) {
+            if (filter_accepts(filter, ROUTE_ALL_FIELDS, &reservoir[i])) {
+                sample_visit_route(&reservoir[i], &query);
+            }
+        }
+        free(reservoir);
+    }
+
+    // Open the file "output.csv" for writing
+    FILE *file = fopen("output.csv", "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file for writing\n");
+        sample_free(&s);
+        return 1;
+    }
+
+    // q2 ranks the least frequent groups first, q3 breaks ties on descending airport name
+    fputs("subject,statistic,ci_low,ci_high\n", file);
+    sample_write(&s, file, n, question != 2, question == 3);
+
+    fclose(file);
+    sample_free(&s);
+    return 0;
+}
+
+/**
+ * @brief this function adds one parsed route to the route index
+ *
+ * @param route the parsed route
+ * @param ctx the route_index being built
+ * @return void: nothing
+ *
+ */
+void index_visit_route(Route *route, void *ctx) {
+    route_index_add((route_index *)ctx, route->airline_icao_unique_code, route->from_airport_icao_unique_code,
+                    route->to_airport_icao_unique_code);
+}
+
+/**
+ * @brief this function answers every --LOOKUP=airline,from,to with the number of routes the airline flies
+ *        between the two airports, or every airline does when the airline is left empty. The index is read
+ *        from --INDEX= when that file was built from the same input, and otherwise built and saved there.
+ *
+ * @param data_files the yaml files full of airline route information
+ * @param lookups the "airline,from,to" ICAO codes
+ * @param lookup_count the number of lookups
+ * @param index_path the index file, or NULL to build the index for this run only
+ * @param where the predicates a route must pass to be indexed
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int index_answer(glob_t *data_files, const char *const *lookups, int lookup_count, const char *index_path,
+                 const route_filter *where) {
+    char description[1024];
+    route_index index;
+
+    filter_describe(where, description, sizeof(description));
+    unsigned long long fingerprint = route_index_fingerprint(data_files, description);
+    if (index_path == NULL || !route_index_load(&index, index_path, fingerprint)) {
+        // Build the index from the three codes of every route
+        route_fields fields = ROUTE_FIELD_BIT(airline_icao_unique_code) | ROUTE_FIELD_BIT(from_airport_icao_unique_code)
+                            | ROUTE_FIELD_BIT(to_airport_icao_unique_code);
+        route_index_init(&index, fingerprint);
+        for (size_t i = 0; i < data_files->gl_pathc; i++) {
+            read_yaml_routes(data_files->gl_pathv[i], fields, where, index_visit_route, &index);
+        }
+        route_index_finish(&index);
+        if (index_path != NULL) {
+            route_index_save(&index, index_path);
+        }
+    }
+
+    // Open the file "output.csv" for writing
+    FILE *file = fopen("output.csv", "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file for writing\n");
+        route_index_free(&index);
+        return 1;
+    }
+
+    fputs("airline,from,to,statistic\n", file);
+    for (int i = 0; i < lookup_count; i++) {
+        char codes[3][BUFFER_SIZE] = { "", "", "" };
+        const char *start = lookups[i];
+
+        // Split the lookup at its commas
+        for (int c = 0; c < 3 && start != NULL; c++) {
+            const char *comma = strchr(start, ',');
+            size_t length = (comma != NULL) ? (size_t)(comma - start) : strlen(start);
+            if (length >= BUFFER_SIZE) {
+                length = BUFFER_SIZE - 1;
+            }
+            memcpy(codes[c], start, length);
+            codes[c][length] = '\0';
+            start = (comma != NULL) ? comma + 1 : NULL;
+        }
+        fprintf(file, "%s,%s,%s,%u\n", codes[0], codes[1], codes[2], route_index_count(&index, codes[0], codes[1], codes[2]));
+    }
+
+    fclose(file);
+    route_index_free(&index);
+    return 0;
+}
+
+/**
+ * @brief Struct representing the name trie being built by prefix_answer.
+ */
+typedef struct {
+    name_trie *trie;
+    int question;
+} trie_query;
+
+/**
+ * @brief this function counts one parsed route under its group's name in the name trie
+ *
+ * @param route the parsed route
+ * @param ctx the trie_query being built
+ * @return void: nothing
+ *
+ */
+void trie_visit_route(Route *route, void *ctx) {
+    trie_query *query = (trie_query *)ctx;
+    char label[ROUTE_LABEL_SIZE];
+    const char *key, *tie;
+
+    if (route_group(route, query->question, &key, &tie, label)) {
+        // The q3 subject comes quoted for output.csv; the trie keeps the plain name and quotes it on write
+        if (query->question == 3) {
+            snprintf(label, sizeof(label), "%s (%s), %s, %s", route->to_airport_name, route->to_airport_icao_unique_code,
+                     route->to_airport_city, route->to_airport_country);
+        }
+        name_trie_add(query->trie, key, tie, label);
+    }
+}
+
+/**
+ * @brief this function answers every --PREFIX= with the top n names of the question's groups that start with
+ *        it, ranked like the question: q1 over airline names, q2 over countries and q3 over airport names.
+ *        The names are put in a radix trie once, so each prefix only visits the names it matches.
+ *
+ * @param data_files the yaml files full of airline route information
+ * @param question the question number that is being answered
+ * @param prefixes the name prefixes
+ * @param prefix_count the number of prefixes
+ * @param n the number of names written for each prefix
+ * @param filter the predicates a route must pass to be counted
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int prefix_answer(glob_t *data_files, int question, const char *const *prefixes, int prefix_count, int n,
+                  const route_filter *filter) {
+    name_trie trie;
+    trie_query query = { &trie, question };
+
+    if ((question < 1) || (question > 3)) {
+        fprintf(stderr, "Error: --PREFIX answers questions 1 to 3\n");
+        return 1;
+    }
+
+    // Count every route under its group's name
+    name_trie_init(&trie);
+    for (size_t i = 0; i < data_files->gl_pathc; i++) {
+        read_yaml_routes(data_files->gl_pathv[i], question_fields(question), filter, trie_visit_route, &query);
+    }
+
+    // Open the file "output.csv" for writing
+    FILE *file = fopen("output.csv", "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file for writing\n");
+        name_trie_free(&trie);
+        return 1;
+    }
+
+    // q2 ranks the least frequent groups first, q3 breaks ties on descending airport name
+    fputs("prefix,subject,statistic\n", file);
+    for (int i = 0; i < prefix_count; i++) {
+        name_trie_write(&trie, prefixes[i], file, n, question != 2, question == 3);
+    }
+
+    fclose(file);
+    name_trie_free(&trie);
+    return 0;
+}
+
+/**
+ * @brief this function returns the time in milliseconds since an arbitrary start, unaffected by clock changes
+ *
+ * @return long long the time
+ *
+ */
+long long monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * @brief this function answers questions 1 to 3 over a stream of yaml routes that may never end. Every
+ *        route is counted in its group as soon as the next one begins, and the top n groups replace
+ *        output.csv every snapshot_seconds seconds or snapshot_records routes, and once more when the
+ *        stream ends. With a window, a route stops being counted after window snapshots.
+ *
+ * @param path "-" for stdin, or the path of a FIFO
+ * @param question the question number that is being answered
+ * @param n the number of elements that will be outputted
+ * @param snapshot_seconds the seconds between snapshots, or 0
+ * @param snapshot_records the routes read between snapshots, or 0
+ * @param window the snapshots a route stays counted for, or 0 to count every route until the end
+ * @param filter the predicates a route must pass to be counted
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int stream_answer(const char *path, int question, int n, double snapshot_seconds, long snapshot_records, int window,
+                  const route_filter *filter) {
+    static stream_reader reader;    // Holds the 64K read buffer, so it stays off the stack
+    stream_counts counts;
+    char line[256];
+    char label[ROUTE_LABEL_SIZE];
+    const char *key, *tie;
+    Route route;
+    int has_route = 0;          // Flag to check if a route has been started
+    int accepted = 0;           // Flag to check if the route may still pass the filter
+    route_fields pending = 0;   // Filtered fields the route has not had yet
+    long records = 0;           // Routes finished since the last snapshot
+    long long interval_ms = (long long)(snapshot_seconds * 1000);
+
+    if ((question < 1) || (question > 3)) {
+        fprintf(stderr, "Error: --STREAM answers questions 1 to 3\n");
+        return 1;
+    }
+    if ((window > 0) && (interval_ms <= 0) && (snapshot_records <= 0)) {
+        fprintf(stderr, "Error: --WINDOW needs --SNAPSHOT_SECONDS or --SNAPSHOT_RECORDS\n");
+        return 1;
+    }
+    if (stream_reader_open(&reader, path) != 0) {
+        return 1;
+    }
+
+    // q2 ranks the least frequent groups first, q3 breaks ties on descending airport name
+    stream_init(&counts, window, question != 2, question == 3);
+    route_fields fields = question_fields(question) | filter->fields;
+    long long next_snapshot = monotonic_ms() + interval_ms;
+
+    for (;;) {
+        // Wait for the next line no longer than the next timed snapshot
+        int timeout_ms = -1;
+        if (interval_ms > 0) {
+            long long left = next_snapshot - monotonic_ms();
+            timeout_ms = (left > 0) ? (int)left : 0;
+        }
+        int status = stream_read_line(&reader, line, sizeof(line), timeout_ms);
+
+        if (status == 1 && strstr(line, "- airline_name") != NULL) {
+            // A new route begins: count the previous one; fields it never had are checked as empty. The
+            // previous route is only finished now, so it counts towards this interval's records
+            if (has_route && accepted && filter_accepts(filter, pending, &route)
+                && route_group(&route, question, &key, &tie, label)) {
+                stream_add(&counts, key, tie, label);
+            }
+            if (has_route) {
+                records++;
+            }
+            has_route = 1;
+            accepted = 1;
+            pending = filter->fields;
+            memset(&route, 0, sizeof(Route));
+        }
+        if (status == 1 && has_route && accepted) {
+            accepted = parse_filtered_line(line, &route, fields, filter, &pending);
+        }
+        if (status == -1) {
+            break;
+        }
+
+        // Replace the snapshot when the interval is over, then start the next interval
+        if (((interval_ms > 0) && (monotonic_ms() >= next_snapshot))
+            || ((snapshot_records > 0) && (records >= snapshot_records))) {
+            stream_snapshot(&counts, "output.csv", n);
+            stream_advance(&counts);
+            records = 0;
+            next_snapshot = monotonic_ms() + interval_ms;
+        }
+    }
+
+    // Count the last route and write the final snapshot
+    if (has_route && accepted && filter_accepts(filter, pending, &route)
+        && route_group(&route, question, &key, &tie, label)) {
+        stream_add(&counts, key, tie, label);
+    }
+    int result = stream_snapshot(&counts, "output.csv", n);
+
+    stream_reader_close(&reader);
+    stream_free(&counts);
+    return result;
+}
+
+/**
+ * @brief The main function and entry point of the program.
+ *
+ * @param argc The number of arguments passed to the program.
+ * @param argv The list of arguments passed to the program.
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int main(int argc, char *argv[]) {
+    options opts;
+
+    // Initialize the variables
+    memset(&opts, 0, sizeof(opts));
+    filter_init(&opts.where);
+
+    // Parse the command-line arguments
+    parse_arguments(argc, argv, &opts);
+    hugemem_configure(opts.huge_pages, opts.numa);
+
+    // A stream is answered as it arrives, without the cache or the pool
+    if (opts.stream != NULL) {
+        route_filter filter;
+        question_filter(opts.question, &opts.where, &filter);
+        int result = stream_answer(opts.stream, opts.question, opts.n, opts.snapshot_seconds, opts.snapshot_records,
+                                   opts.window, &filter);
+        globfree(&opts.data_files);
+        globfree(&opts.diff_files);
+        return result;
+    }
+    if (opts.data_files.gl_pathc == 0) {
+        fprintf(stderr, "No data file given\n");
+        return 1;
+    }
+
+    // Drop repeated routes in every reader; a route takes more than 256 bytes, so max_groups bounds them too
+    if (opts.dedup) {
+        opts.where.dedup = dedup_create(max_groups(&opts.data_files));
+    }
+
+    // Answer from the result cache when it holds a valid result for this query and filter
+    char where[1024];
+    filter_describe(&opts.where, where, sizeof(where));
+    cache_entry entry;
+    int cacheable = (opts.cache != NULL) && (opts.lookup_count == 0) && (opts.prefix_count == 0) && (opts.diff_files.gl_pathc == 0) && (opts.export_path == NULL) && ((opts.pivot != NULL) || (opts.group_top != NULL) || ((opts.question >= 1) && (opts.question <= 4)));
+    if (cacheable) {
+        char query[sizeof(entry.query)];
+        int length;
+        if (opts.group_top != NULL) {
+            // N applies to every group, so the rows of a smaller N are not a prefix: N is part of the query
+            length = snprintf(query, sizeof(query), "group_top=%s n=%d where=%s", opts.group_top, opts.n, where);
+        } else if (opts.pivot != NULL) {
+            length = snprintf(query, sizeof(query), "pivot=%s matrix=%d where=%s", opts.pivot, opts.pivot_matrix, where);
+        } else {
+            length = question_cache_query(query, sizeof(query), opts.question, opts.sample_fraction, opts.sample_size, where);
+        }
+
+        // A query cut short could share its entry with another query: refuse it rather than risk a wrong answer
+        if (length >= (int)sizeof(query)) {
+            fprintf(stderr, "Error: the query is too long to be cached\n");
+            if (opts.where.dedup != NULL) {
+                dedup_free(opts.where.dedup);
+            }
+            globfree(&opts.data_files);
+            return 1;
+        }
+        int rows = ((opts.group_top != NULL) || opts.pivot_matrix) ? CACHE_ALL_ROWS : opts.n;
+        cache_entry_init(&entry, opts.cache, query, &opts.data_files, rows);
+        if (cache_load(&entry, "output.csv")) {
+            if (opts.where.dedup != NULL) {
+                dedup_free(opts.where.dedup);
+            }
+            globfree(&opts.data_files);
+            return 0;
+        }
+    }
+
+    // Measure the phases only when asked, since every phase then makes system calls
+    if (opts.perf) {
+        perf_enable();
+    }
+
+    // Start the workers shared by every stage
+    thread_pool *pool = thread_pool_create(opts.threads);
+
+    // Push the question's predicates down into the readers
+    route_filter filter;
+    question_filter(opts.question, &opts.where, &filter);
+
+    // Determine which question to answer based on the command-line arguments
+    int result = 0;
+    if (opts.lookup_count > 0) {
+        result = index_answer(&opts.data_files, opts.lookups, opts.lookup_count, opts.index, &opts.where);
+    } else if (opts.prefix_count > 0) {
+        result = prefix_answer(&opts.data_files, opts.question, opts.prefixes, opts.prefix_count, opts.n, &filter);
+    } else if (opts.diff_files.gl_pathc > 0) {
+        result = diff_answer(pool, &opts.diff_files, &opts.data_files, opts.question, opts.n, opts.diff_relative, opts.cache, &opts.where);
+    } else if (opts.group_top != NULL) {
+        result = pivot_answer(pool, &opts.data_files, opts.group_top, PIVOT_TOP_PER_ROW, opts.n, &opts.where, opts.export_path,
+                     opts.export_format);
+    } else if (opts.pivot != NULL) {
+        result = pivot_answer(pool, &opts.data_files, opts.pivot, opts.pivot_matrix ? PIVOT_FULL_MATRIX : PIVOT_TOP_CELLS, opts.n,
+                     &opts.where, opts.export_path, opts.export_format);
+    } else if (opts.export_path != NULL) {
+        result = export_answer(pool, &opts.data_files, opts.question, &filter, opts.export_path, opts.export_format);
+    } else if (((opts.sample_fraction > 0) || (opts.sample_size > 0)) && (opts.question >= 1) && (opts.question <= 3)) {
+        result = sample_answer(&opts.data_files, opts.question, opts.n, opts.sample_fraction, opts.sample_size, &filter);
+    } else if ((opts.memory_limit > 0) && (opts.question >= 1) && (opts.question <= 3)) {
+        result = spill_answer(&opts.data_files, opts.question, opts.n, opts.memory_limit, &filter);
+    } else if (opts.hash_backend && (opts.question >= 1) && (opts.question <= 3)) {
+        hash_answer(pool, &opts.data_files, opts.question, opts.n, &filter);
+    } else if (opts.question == 1) {
+        q1(pool, &opts.data_files, opts.n, &filter);
+    } else if (opts.question == 2) {
+        q2(pool, &opts.data_files, opts.n, &filter);
+    } else if (opts.question == 3) {
+        q3(pool, &opts.data_files, opts.n, &filter);
+    } else if (opts.question == 4) {
+        q4(pool, &opts.data_files, opts.n, &filter);
+    }
+
+    // Keep the result for later runs over the same input, unless answering it failed
+    if (cacheable && (result == 0)) {
+        cache_store(&entry, "output.csv");
+    }
+
+    if (opts.where.dedup != NULL) {
+        fprintf(stderr, "Removed %ld duplicate routes\n", opts.where.dedup->removed);
+        dedup_free(opts.where.dedup);
+    }
+    if (opts.pool_stats) {
+        thread_pool_report(pool, stderr);
+    }
+    if (opts.perf) {
+        perf_report(stderr);
+        perf_shutdown();
+    }
+    thread_pool_destroy(pool);
+    globfree(&opts.data_files);
+    globfree(&opts.diff_files);
+    return result;
+}
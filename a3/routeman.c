@@ -0,0 +1,252 @@
+/** @file routeman.c
+ *  @brief Implementation of routeman.h
+ *
+ *  A query counts its groups in a concurrent map of its own, then sorts
+ *  the groups in the order route_manager writes them: by count (lowest
+ *  first for q2), then in count list order. The library runs inside its
+ *  caller's process, so it allocates without emalloc and reports every
+ *  failure by returning NULL instead of ending the process.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "routeman.h"
+#include "reader.h"
+#include "query.h"
+#include "concurrent_map.h"
+
+// The public header cannot include query.h, so check that the sizes agree
+typedef char routeman_subject_size_check[(ROUTEMAN_SUBJECT_SIZE == ROUTE_LABEL_SIZE) ? 1 : -1];
+
+/**
+ * @brief Struct representing an opened dataset: the yaml files a pattern matched.
+ */
+struct routeman_dataset {
+    glob_t data_files;
+};
+
+/**
+ * @brief Struct representing the ranked rows of a query.
+ */
+struct routeman_result {
+    routeman_row *rows;
+    size_t count;
+};
+
+/**
+ * @brief Struct representing one group counted by a query; the group's key is the map key.
+ */
+typedef struct {
+    char tie[BUFFER_SIZE];              // Orders groups with equal counts before the key does
+    char label[ROUTE_LABEL_SIZE];       // The subject of the row
+} group_value;
+
+/**
+ * @brief Struct representing what a query hands to the reader and to the group initializer.
+ */
+typedef struct {
+    concurrent_map *groups;
+    int question;
+    const char *tie;
+    const char *label;
+    int failed;         // 1 once a group could not be added; the remaining routes are skipped
+} group_query;
+
+/**
+ * @brief Fills in a new group from the route that introduced it.
+ *
+ */
+static void init_group(void *value, const void *ctx) {
+    const group_query *query = (const group_query *)ctx;
+    group_value *group = (group_value *)value;
+
+    memset(group, 0, sizeof(group_value));
+    strncpy(group->tie, query->tie, sizeof(group->tie) - 1);
+    strncpy(group->label, query->label, sizeof(group->label) - 1);
+}
+
+/**
+ * @brief Counts one route in its group.
+ *
+ */
+static void visit_route(Route *route, void *ctx) {
+    group_query *query = (group_query *)ctx;
+    char label[ROUTE_LABEL_SIZE];
+    const char *key;
+
+    if (!query->failed && route_group(route, query->question, &key, &query->tie, label)) {
+        query->label = label;
+        if (concurrent_map_add(query->groups, key, 1, init_group, query, sizeof(group_value)) == NULL) {
+            fprintf(stderr, "Error: out of memory adding to the group map\n");
+            query->failed = 1;
+        }
+    }
+}
+
+/**
+ * @brief qsort comparators ranking the groups of q1, q2 and q3 like their count lists are written.
+ *
+ */
+static int compare_tie_key(const map_entry *x, const map_entry *y, int key_descending) {
+    int cmp = strcmp(((const group_value *)x->value)->tie, ((const group_value *)y->value)->tie);
+    if (cmp != 0) {
+        return cmp;
+    }
+    cmp = strcmp(x->key, y->key);
+    return key_descending ? -cmp : cmp;
+}
+
+static int compare_q1_groups(const void *a, const void *b) {
+    const map_entry *x = *(map_entry *const *)a, *y = *(map_entry *const *)b;
+    return (x->count != y->count) ? ((x->count > y->count) ? -1 : 1) : compare_tie_key(x, y, 0);
+}
+
+static int compare_q2_groups(const void *a, const void *b) {
+    const map_entry *x = *(map_entry *const *)a, *y = *(map_entry *const *)b;
+    return (x->count != y->count) ? ((x->count < y->count) ? -1 : 1) : compare_tie_key(x, y, 0);
+}
+
+static int compare_q3_groups(const void *a, const void *b) {
+    const map_entry *x = *(map_entry *const *)a, *y = *(map_entry *const *)b;
+    return (x->count != y->count) ? ((x->count > y->count) ? -1 : 1) : compare_tie_key(x, y, 1);
+}
+
+/**
+ * @brief Opens the yaml files matched by a pattern, as given with --DATA=.
+ *
+ * @param pattern The file name or glob pattern.
+ * @return routeman_dataset* The dataset, or NULL if no file matched or it could not be allocated.
+ *
+ */
+routeman_dataset *routeman_open(const char *pattern) {
+    routeman_dataset *dataset = (routeman_dataset *)malloc(sizeof(routeman_dataset));
+
+    if (dataset == NULL) {
+        fprintf(stderr, "Error: out of memory opening %s\n", pattern);
+        return NULL;
+    }
+    if (glob(pattern, GLOB_BRACE, NULL, &dataset->data_files) != 0) {
+        fprintf(stderr, "Error: no data file matches %s\n", pattern);
+        free(dataset);
+        return NULL;
+    }
+    return dataset;
+}
+
+/**
+ * @brief Answers a question over a dataset on the calling thread.
+ *
+ * @param dataset The dataset.
+ * @param query The question, the number of rows and the predicates.
+ * @return routeman_result* The ranked rows, or NULL if the query is not valid, a file could not be read or
+ *         memory ran out.
+ *
+ */
+routeman_result *routeman_run(const routeman_dataset *dataset, const routeman_query *query) {
+    static int (*const compare[])(const void *, const void *) = { compare_q1_groups, compare_q2_groups, compare_q3_groups };
+    route_filter where, filter;
+
+    if (query->question < 1 || query->question > 3 || query->n < 0) {
+        fprintf(stderr, "Error: the library answers questions 1 to 3 with n >= 0\n");
+        return NULL;
+    }
+    filter_init(&where);
+    for (int i = 0; i < query->where_count; i++) {
+        if (filter_add(&where, query->where[i]) != 0) {
+            return NULL;
+        }
+    }
+    question_filter(query->question, &where, &filter);
+
+    // Count every file into the query's own map
+    const glob_t *data_files = &dataset->data_files;
+    group_query groups = { concurrent_map_try_create(0), query->question, NULL, NULL, 0 };
+    if (groups.groups == NULL) {
+        fprintf(stderr, "Error: out of memory creating the group map\n");
+        return NULL;
+    }
+    for (size_t i = 0; i < data_files->gl_pathc && !groups.failed; i++) {
+        if (read_yaml_records(data_files->gl_pathv[i], question_fields(query->question), &filter, visit_route, &groups) < 0) {
+            groups.failed = 1;
+        }
+    }
+
+    // Rank the groups and keep the first n
+    size_t count;
+    map_entry **entries = groups.failed ? NULL : concurrent_map_try_entries(groups.groups, &count);
+    routeman_result *result = (entries != NULL) ? (routeman_result *)malloc(sizeof(routeman_result)) : NULL;
+    if (result != NULL) {
+        result->count = (count < (size_t)query->n) ? count : (size_t)query->n;
+        result->rows = (routeman_row *)malloc((result->count > 0 ? result->count : 1) * sizeof(routeman_row));
+    }
+    if (result == NULL || result->rows == NULL) {
+        if (!groups.failed) {
+            fprintf(stderr, "Error: out of memory ranking the groups\n");
+        }
+        free(result);
+        free(entries);
+        concurrent_map_free(groups.groups);
+        return NULL;
+    }
+    qsort(entries, count, sizeof(map_entry *), compare[query->question - 1]);
+    for (size_t i = 0; i < result->count; i++) {
+        memcpy(result->rows[i].subject, ((group_value *)entries[i]->value)->label, ROUTEMAN_SUBJECT_SIZE);
+        result->rows[i].statistic = entries[i]->count;
+    }
+
+    free(entries);
+    concurrent_map_free(groups.groups);
+    return result;
+}
+
+/**
+ * @brief Returns the number of rows of a result.
+ *
+ * @param result The result.
+ * @return size_t The number of rows.
+ *
+ */
+size_t routeman_result_count(const routeman_result *result) {
+    return result->count;
+}
+
+/**
+ * @brief Returns one row of a result, in rank order.
+ *
+ * @param result The result.
+ * @param i The rank of the row, from 0.
+ * @return const routeman_row* The row, or NULL past the last row. It lives as long as the result.
+ *
+ */
+const routeman_row *routeman_result_row(const routeman_result *result, size_t i) {
+    return (i < result->count) ? &result->rows[i] : NULL;
+}
+
+/**
+ * @brief Frees a result and its rows.
+ *
+ * @param result The result.
+ * @return void: nothing
+ *
+ */
+void routeman_result_free(routeman_result *result) {
+    if (result != NULL) {
+        free(result->rows);
+        free(result);
+    }
+}
+
+/**
+ * @brief Closes a dataset. Its results stay valid.
+ *
+ * @param dataset The dataset.
+ * @return void: nothing
+ *
+ */
+void routeman_close(routeman_dataset *dataset) {
+    if (dataset != NULL) {
+        globfree(&dataset->data_files);
+        free(dataset);
+    }
+}
\ No newline at end of file
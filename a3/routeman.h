@@ -0,0 +1,52 @@
+/** @file routeman.h
+ *  @brief librouteman: the route_manager questions as a reentrant library with results in memory.
+ *
+ *  A dataset names the yaml files once; every query reads them again on
+ *  the calling thread and ranks the groups exactly like route_manager, but
+ *  returns the rows instead of writing output.csv. Nothing is shared
+ *  between calls, so any number of threads may query the same dataset.
+ *
+ *  The library never ends the process: a call that fails, whether from a
+ *  bad query, an unreadable file, a full group map or a failed allocation,
+ *  writes what went wrong to stderr and returns NULL.
+ *
+ */
+#ifndef ROUTEMAN_H
+#define ROUTEMAN_H
+
+#include <stddef.h>
+
+#define ROUTEMAN_SUBJECT_SIZE (4 * 256 + 16)  // Longest subject of a row, with its terminator
+
+typedef struct routeman_dataset routeman_dataset;
+typedef struct routeman_result routeman_result;
+
+/**
+ * @brief Struct representing a question to answer over a dataset.
+ */
+typedef struct {
+    int question;               // 1 to 3, as with --QUESTION=
+    int n;                      // The number of rows to return, as with --N=
+    const char *const *where;   // Predicates as given with --WHERE=, or NULL
+    int where_count;            // The number of predicates in where
+} routeman_query;
+
+/**
+ * @brief Struct representing one ranked row of a result, as "subject,statistic" in output.csv.
+ */
+typedef struct {
+    char subject[ROUTEMAN_SUBJECT_SIZE];
+    long statistic;
+} routeman_row;
+
+/**
+ * Function protypes associated with the library.
+ */
+routeman_dataset *routeman_open(const char *pattern);
+routeman_result *routeman_run(const routeman_dataset *dataset, const routeman_query *query);
+size_t routeman_result_count(const routeman_result *result);
+const routeman_row *routeman_result_row(const routeman_result *result, size_t i);
+void routeman_result_free(routeman_result *result);
+void routeman_close(routeman_dataset *dataset);
+
+#endif // ROUTEMAN_H
\ No newline at end of file
@@ -0,0 +1,210 @@
+/** @file sample.c
+ *  @brief Implementation of sample.h
+ *
+ *  With --SAMPLE=f every 64 KiB block of the input is read with probability
+ *  f, and a group seen c times is estimated at c / f. Routes of one block
+ *  are not independent, so the variance is estimated from the per-block
+ *  counts: (1 - f) / f^2 times the sum of their squares.
+ *
+ *  With --SAMPLE_SIZE=k a uniform reservoir of k routes is kept out of the
+ *  N routes offered, and a group seen c times is estimated at N c / k, with
+ *  the binomial variance of c / k and the finite population correction.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sample.h"
+#include "emalloc.h"
+
+/**
+ * @brief Struct representing what sample_count hands to the group initializer.
+ */
+typedef struct {
+    const char *key;
+    const char *tie;
+    const char *label;
+} group_fields;
+
+/**
+ * @brief Initializes the state of a sampled query.
+ *
+ * @param s The sampler to initialize.
+ * @param fraction The fraction of blocks to read, or 0.
+ * @param reservoir_size The number of routes to keep, or 0.
+ * @return void: nothing
+ *
+ */
+void sample_init(sampler *s, double fraction, int reservoir_size) {
+    s->fraction = fraction;
+    s->reservoir_size = reservoir_size;
+    s->rng = 0x9E3779B97F4A7C15ULL;     // Fixed seed, so repeated runs pick the same sample
+    s->population = 0;
+    s->block = 0;
+    s->groups = concurrent_map_create(0);
+}
+
+/**
+ * @brief Returns a pseudo-random number in [0, 1).
+ *
+ * @param s The sampler whose generator is advanced.
+ * @return double The number.
+ *
+ */
+double sample_random(sampler *s) {
+    s->rng ^= s->rng << 13;
+    s->rng ^= s->rng >> 7;
+    s->rng ^= s->rng << 17;
+    return (s->rng >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief Moves on to the next block of the input and decides whether it is read.
+ *
+ * @param s The sampler, which numbers the blocks across files.
+ * @return int 1: The block is read; 0: It is skipped.
+ *
+ */
+int sample_next_block(sampler *s) {
+    s->block++;
+    return sample_random(s) < s->fraction;
+}
+
+/**
+ * @brief Fills in a new group from its fields.
+ *
+ */
+static void init_group(void *value, const void *ctx) {
+    const group_fields *fields = (const group_fields *)ctx;
+    sample_group *group = (sample_group *)value;
+
+    memset(group, 0, sizeof(sample_group));
+    strncpy(group->key, fields->key, sizeof(group->key) - 1);
+    strncpy(group->tie, fields->tie, sizeof(group->tie) - 1);
+    strncpy(group->label, fields->label, sizeof(group->label) - 1);
+    group->last_block = -1;
+}
+
+/**
+ * @brief Closes the block count of a group, adding its square to the group's sum.
+ *
+ */
+static void close_block(sample_group *group) {
+    group->sum_squares += (double)group->block_count * group->block_count;
+    group->block_count = 0;
+}
+
+/**
+ * @brief Counts one sampled route in its group, in the block being read.
+ *
+ * @param s The sampler.
+ * @param key The group identity.
+ * @param tie Orders groups with equal counts before the key does.
+ * @param label The subject written to output.csv.
+ * @return void: nothing
+ *
+ */
+void sample_count(sampler *s, const char *key, const char *tie, const char *label) {
+    group_fields fields = { key, tie, label };
+    map_entry *entry = concurrent_map_add(s->groups, key, 1, init_group, &fields, sizeof(sample_group));
+    if (entry == NULL) {
+        fprintf(stderr, "Error: too many groups in the sample\n");
+        exit(EXIT_FAILURE);
+    }
+
+    sample_group *group = (sample_group *)entry->value;
+    if (group->last_block != s->block) {
+        close_block(group);
+        group->last_block = s->block;
+    }
+    group->block_count++;
+    group->count++;
+}
+
+/**
+ * @brief Ranking order of the groups, set by sample_write for compare_groups.
+ */
+static int rank_descending;
+static int rank_key_descending;
+
+/**
+ * @brief qsort comparator ranking groups by count, then tie, then key.
+ *
+ */
+static int compare_groups(const void *a, const void *b) {
+    const sample_group *x = (const sample_group *)(*(map_entry *const *)a)->value;
+    const sample_group *y = (const sample_group *)(*(map_entry *const *)b)->value;
+
+    if (x->count != y->count) {
+        return ((x->count > y->count) == rank_descending) ? -1 : 1;
+    }
+    int cmp = strcmp(x->tie, y->tie);
+    if (cmp != 0) {
+        return cmp;
+    }
+    cmp = strcmp(x->key, y->key);
+    return rank_key_descending ? -cmp : cmp;
+}
+
+/**
+ * @brief Writes the n best ranked groups as csv lines of "subject,estimate,ci_low,ci_high": the estimated
+ *        number of routes in the whole input and its 95% confidence interval.
+ *
+ * @param s The sampler.
+ * @param file The file to write to.
+ * @param n The number of groups to write.
+ * @param descending 1 to rank groups by the highest count, 0 by the lowest.
+ * @param key_descending 1 if equal counts and ties rank the larger key first.
+ * @return int The number of groups written.
+ *
+ */
+int sample_write(sampler *s, FILE *file, int n, int descending, int key_descending) {
+    size_t count;
+    map_entry **entries = concurrent_map_entries(s->groups, &count);
+
+    rank_descending = descending;
+    rank_key_descending = key_descending;
+    qsort(entries, count, sizeof(map_entry *), compare_groups);
+
+    int written = 0;
+    for (size_t i = 0; i < count && written < n; i++, written++) {
+        sample_group *group = (sample_group *)entries[i]->value;
+        double estimate, variance;
+        close_block(group);
+
+        if (s->fraction > 0) {
+            // Block sample: scale up by the fraction of blocks read
+            estimate = group->count / s->fraction;
+            variance = (1 - s->fraction) / (s->fraction * s->fraction) * group->sum_squares;
+        } else {
+            // Reservoir: scale the share of the sample up to the population
+            double kept = (s->population < s->reservoir_size) ? s->population : s->reservoir_size;
+            double share = group->count / kept;
+            estimate = s->population * share;
+            variance = (s->population > 1)
+                     ? (double)s->population * s->population * share * (1 - share) / kept
+                       * (s->population - kept) / (s->population - 1)
+                     : 0;
+        }
+
+        // The group holds at least the routes that were seen
+        double margin = SAMPLE_Z * sqrt(variance);
+        double low = (estimate - margin > group->count) ? estimate - margin : group->count;
+        fprintf(file, "%s,%.0f,%.0f,%.0f\n", group->label, estimate, low, estimate + margin);
+    }
+
+    free(entries);
+    return written;
+}
+
+/**
+ * @brief Frees the groups of a sampler.
+ *
+ * @param s The sampler.
+ * @return void: nothing
+ *
+ */
+void sample_free(sampler *s) {
+    concurrent_map_free(s->groups);
+}
\ No newline at end of file
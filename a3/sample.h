@@ -0,0 +1,50 @@
+/** @file sample.h
+ *  @brief Approximate group counts from a block or reservoir sample, with confidence intervals.
+ *
+ */
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <stdio.h>
+#include "route.h"
+#include "concurrent_map.h"
+
+#define SAMPLE_BLOCK (64 * 1024)    // Bytes of yaml in one sampling block
+#define SAMPLE_Z 1.96               // Normal quantile of the 95% confidence intervals
+
+/**
+ * @brief Struct representing one group of the sample.
+ */
+typedef struct {
+    char key[BUFFER_SIZE];              // The group identity
+    char tie[BUFFER_SIZE];              // Orders groups with equal counts before the key does
+    char label[4 * BUFFER_SIZE + 16];   // The subject written to output.csv
+    long count;                         // Sampled routes in the group
+    long block_count;                   // Sampled routes of the group in block last_block
+    long last_block;
+    double sum_squares;                 // Sum of block_count squared over the earlier blocks
+} sample_group;
+
+/**
+ * @brief Struct representing the state of a sampled query.
+ */
+typedef struct {
+    double fraction;            // Fraction of blocks read with --SAMPLE=, or 0
+    int reservoir_size;         // Routes kept with --SAMPLE_SIZE=, or 0
+    unsigned long long rng;     // xorshift64 state
+    long population;            // Routes offered to the reservoir
+    long block;                 // Number of the block being read, counted across files from 1
+    concurrent_map *groups;     // Only used by one thread, so the map never contends
+} sampler;
+
+/**
+ * Function protypes associated with sampling.
+ */
+void sample_init(sampler *s, double fraction, int reservoir_size);
+double sample_random(sampler *s);
+int sample_next_block(sampler *s);
+void sample_count(sampler *s, const char *key, const char *tie, const char *label);
+int sample_write(sampler *s, FILE *file, int n, int descending, int key_descending);
+void sample_free(sampler *s);
+
+#endif // SAMPLE_H
\ No newline at end of file
@@ -0,0 +1,532 @@
+/** @file spill.c
+ *  @brief Implementation of spill.h
+ *
+ *  Groups are counted in an in-memory hash table until it uses more than
+ *  the memory limit. The table is then sorted by key and written out as a
+ *  run to a temporary file at level 0. Once SPILL_TIER runs of one level
+ *  exist they are merged into one run of the next level, so every group is
+ *  rewritten once per level rather than once per spill, and the number of
+ *  open files stays bounded as well. The final
+ *  k-way merge adds up the counts of equal keys and feeds each group to a
+ *  top-N selection, which only ever holds N groups.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "spill.h"
+#include "emalloc.h"
+
+#define SPILL_INITIAL_TABLE 1024    // Number of slots of a fresh hash table
+
+/**
+ * @brief Struct representing where the rows produced by a merge go.
+ */
+typedef struct {
+    void (*emit)(spill_row *row, void *ctx);   // Takes ownership of each merged row
+    void *ctx;
+} spill_sink;
+
+/**
+ * @brief Struct representing the top-N selection fed by the final merge.
+ */
+typedef struct {
+    spill_aggregator *agg;
+    spill_row **top;    // The best rows so far, best first
+    int n;
+    int size;
+} spill_selection;
+
+/**
+ * @brief Parses a byte count with an optional K, M or G suffix, such as 512M.
+ *
+ * @param value The text to parse.
+ * @return size_t The number of bytes, or 0 if the text is not a positive size: anything but digits and
+ *         one suffix, such as 512MB, is rejected rather than read as a prefix.
+ *
+ */
+size_t parse_memory_limit(const char *value) {
+    char *end;
+    if (!isdigit((unsigned char)value[0])) {
+        return 0;
+    }
+    unsigned long long bytes = strtoull(value, &end, 10);
+
+    // Apply the unit suffix, if any
+    switch (*end) {
+        case 'G': case 'g': bytes <<= 10; /* fall through */
+        case 'M': case 'm': bytes <<= 10; /* fall through */
+        case 'K': case 'k': bytes <<= 10; end++; break;
+        default: break;
+    }
+    return (*end == '\0') ? (size_t)bytes : 0;
+}
+
+/**
+ * @brief Computes the FNV-1a hash of a string.
+ *
+ * @param str The string to hash.
+ * @return unsigned int The hash.
+ *
+ */
+static unsigned int hash_key(const char *str) {
+    unsigned int hash = 2166136261u;
+    while (*str != '\0') {
+        hash ^= (unsigned char)*str++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Allocates a row holding copies of its strings.
+ *
+ * @return spill_row* The new row.
+ *
+ */
+static spill_row *new_row(const char *key, const char *tie, const char *label, int count) {
+    size_t key_len = strlen(key) + 1;
+    size_t tie_len = strlen(tie) + 1;
+    size_t label_len = strlen(label) + 1;
+    spill_row *row = (spill_row *)emalloc(sizeof(spill_row) + key_len + tie_len + label_len);
+
+    // Lay the three strings out one after the other
+    row->count = count;
+    row->key = row->text;
+    row->tie = row->key + key_len;
+    row->label = row->tie + tie_len;
+    memcpy(row->key, key, key_len);
+    memcpy(row->tie, tie, tie_len);
+    memcpy(row->label, label, label_len);
+    return row;
+}
+
+/**
+ * @brief Returns the number of bytes a row uses.
+ *
+ */
+static size_t row_size(const spill_row *row) {
+    return sizeof(spill_row) + (row->label + strlen(row->label) + 1 - row->text);
+}
+
+/**
+ * @brief Writes a row to a run as its count followed by three length-prefixed strings.
+ *
+ */
+static void write_row(FILE *run, const spill_row *row) {
+    const char *strings[3] = { row->key, row->tie, row->label };
+
+    fwrite(&row->count, sizeof(int), 1, run);
+    for (int i = 0; i < 3; i++) {
+        int len = (int)strlen(strings[i]);
+        fwrite(&len, sizeof(int), 1, run);
+        fwrite(strings[i], 1, len, run);
+    }
+}
+
+/**
+ * @brief Reads the next row of a run.
+ *
+ * @return spill_row* The row, or NULL at the end of the run.
+ *
+ */
+static spill_row *read_row(FILE *run) {
+    int count;
+    int len[3];
+    char *strings[3];
+
+    if (fread(&count, sizeof(int), 1, run) != 1) {
+        return NULL;
+    }
+
+    // Read the three strings into temporary buffers, then build the row from them
+    for (int i = 0; i < 3; i++) {
+        if (fread(&len[i], sizeof(int), 1, run) != 1) {
+            fprintf(stderr, "Error: truncated spill run\n");
+            exit(EXIT_FAILURE);
+        }
+        strings[i] = (char *)emalloc(len[i] + 1);
+        if (fread(strings[i], 1, len[i], run) != (size_t)len[i]) {
+            fprintf(stderr, "Error: truncated spill run\n");
+            exit(EXIT_FAILURE);
+        }
+        strings[i][len[i]] = '\0';
+    }
+    spill_row *row = new_row(strings[0], strings[1], strings[2], count);
+
+    for (int i = 0; i < 3; i++) {
+        free(strings[i]);
+    }
+    return row;
+}
+
+/**
+ * @brief qsort comparator ordering rows by key.
+ *
+ */
+static int compare_keys(const void *a, const void *b) {
+    return strcmp((*(spill_row *const *)a)->key, (*(spill_row *const *)b)->key);
+}
+
+/**
+ * @brief Allocates an empty hash table.
+ *
+ */
+static void reset_table(spill_aggregator *agg, int table_size) {
+    agg->table = (spill_row **)emalloc(table_size * sizeof(spill_row *));
+    memset(agg->table, 0, table_size * sizeof(spill_row *));
+    agg->table_size = table_size;
+    agg->rows = 0;
+    agg->memory_used = table_size * sizeof(spill_row *);
+}
+
+/**
+ * @brief Initializes an empty group-by.
+ *
+ * @param agg The group-by to initialize.
+ * @param memory_limit Bytes the in-memory groups may use before they are spilled.
+ * @param descending 1 to rank groups by the highest count, 0 by the lowest.
+ * @param key_descending 1 if, among equal counts and ties, the larger key ranks first.
+ * @return void: nothing
+ *
+ */
+void spill_init(spill_aggregator *agg, size_t memory_limit, int descending, int key_descending) {
+    agg->memory_limit = memory_limit;
+    agg->descending = descending;
+    agg->key_descending = key_descending;
+    agg->run_count = 0;
+    reset_table(agg, SPILL_INITIAL_TABLE);
+}
+
+/**
+ * @brief Moves the rows of the table to the front of it, sorted by key.
+ *
+ * @return int The number of rows.
+ *
+ */
+static int sort_table(spill_aggregator *agg) {
+    int rows = 0;
+    for (int i = 0; i < agg->table_size; i++) {
+        if (agg->table[i] != NULL) {
+            spill_row *row = agg->table[i];
+            agg->table[i] = NULL;
+            agg->table[rows++] = row;
+        }
+    }
+    qsort(agg->table, rows, sizeof(spill_row *), compare_keys);
+    return rows;
+}
+
+/**
+ * @brief Writes each row it receives to the run given as context.
+ *
+ */
+static void emit_to_run(spill_row *row, void *ctx) {
+    write_row((FILE *)ctx, row);
+    free(row);
+}
+
+/**
+ * @brief Restores the heap order of the merge heads below position i.
+ *
+ */
+static void sift_down(spill_row **heads, int *sources, int size, int i) {
+    for (;;) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < size && strcmp(heads[left]->key, heads[smallest]->key) < 0) smallest = left;
+        if (right < size && strcmp(heads[right]->key, heads[smallest]->key) < 0) smallest = right;
+        if (smallest == i) {
+            return;
+        }
+
+        spill_row *row = heads[i];
+        int source = sources[i];
+        heads[i] = heads[smallest];
+        sources[i] = sources[smallest];
+        heads[smallest] = row;
+        sources[smallest] = source;
+        i = smallest;
+    }
+}
+
+/**
+ * @brief Merges sorted runs with a min-heap over their current rows, adding up the counts of
+ *        equal keys and passing each merged group to the sink in key order.
+ *
+ * @param runs The runs to merge, rewound to their start.
+ * @param k The number of runs.
+ * @param sink Where the merged rows go.
+ * @return void: nothing
+ *
+ */
+static void merge_runs(FILE **runs, int k, spill_sink *sink) {
+    spill_row *heads[SPILL_FANIN + 1];
+    int sources[SPILL_FANIN + 1];
+    int size = 0;
+    spill_row *pending = NULL;
+
+    // Load the first row of every run into the heap
+    for (int i = 0; i < k; i++) {
+        spill_row *row = read_row(runs[i]);
+        if (row != NULL) {
+            heads[size] = row;
+            sources[size++] = i;
+        }
+    }
+    for (int i = size / 2 - 1; i >= 0; i--) {
+        sift_down(heads, sources, size, i);
+    }
+
+    // Repeatedly take the smallest key and replace it with the next row of its run
+    while (size > 0) {
+        spill_row *row = heads[0];
+        spill_row *next = read_row(runs[sources[0]]);
+        if (next != NULL) {
+            heads[0] = next;
+        } else {
+            heads[0] = heads[--size];
+            sources[0] = sources[size];
+        }
+        sift_down(heads, sources, size, 0);
+
+        // Combine equal keys before passing the group on
+        if (pending != NULL && strcmp(pending->key, row->key) == 0) {
+            pending->count += row->count;
+            free(row);
+        } else {
+            if (pending != NULL) {
+                sink->emit(pending, sink->ctx);
+            }
+            pending = row;
+        }
+    }
+    if (pending != NULL) {
+        sink->emit(pending, sink->ctx);
+    }
+}
+
+/**
+ * @brief Merges the runs from first on into one run of the given level, which replaces them.
+ *
+ */
+static void merge_tail(spill_aggregator *agg, int first, int level) {
+    FILE *merged = tmpfile();
+    if (merged == NULL) {
+        fprintf(stderr, "Error: could not create a spill file\n");
+        exit(EXIT_FAILURE);
+    }
+    spill_sink sink = { emit_to_run, merged };
+    merge_runs(agg->runs + first, agg->run_count - first, &sink);
+    for (int i = first; i < agg->run_count; i++) {
+        fclose(agg->runs[i]);
+    }
+    rewind(merged);
+    agg->runs[first] = merged;
+    agg->levels[first] = level;
+    agg->run_count = first + 1;
+}
+
+/**
+ * @brief Writes the in-memory groups out as a sorted run of level 0 and empties the table.
+ *        Whenever SPILL_TIER runs share a level they are merged into one run of the next level.
+ *
+ */
+static void spill_table(spill_aggregator *agg) {
+    FILE *run = tmpfile();
+    if (run == NULL) {
+        fprintf(stderr, "Error: could not create a spill file\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Write the sorted rows and free them
+    int rows = sort_table(agg);
+    for (int i = 0; i < rows; i++) {
+        emit_to_run(agg->table[i], run);
+    }
+    free(agg->table);
+    reset_table(agg, SPILL_INITIAL_TABLE);
+
+    rewind(run);
+    agg->runs[agg->run_count] = run;
+    agg->levels[agg->run_count++] = 0;
+
+    // Merge the newest runs while SPILL_TIER of them share a level; levels never rise along runs, so
+    // the runs of one level are always the newest ones
+    for (;;) {
+        int level = agg->levels[agg->run_count - 1];
+        int same = 1;
+        while (same < agg->run_count && agg->levels[agg->run_count - 1 - same] == level) {
+            same++;
+        }
+        if (same == SPILL_TIER) {
+            merge_tail(agg, agg->run_count - same, level + 1);
+        } else if (agg->run_count == SPILL_FANIN) {
+            // Only after more than SPILL_TIER^4 spills: keep the open runs bounded by merging all of them
+            merge_tail(agg, 0, agg->levels[0] + 1);
+        } else {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Doubles the size of the hash table, re-inserting every row.
+ *
+ */
+static void grow_table(spill_aggregator *agg) {
+    spill_row **old_table = agg->table;
+    int old_size = agg->table_size;
+    size_t rows_memory = agg->memory_used - old_size * sizeof(spill_row *);
+    int rows = agg->rows;
+
+    reset_table(agg, old_size * 2);
+    for (int i = 0; i < old_size; i++) {
+        if (old_table[i] != NULL) {
+            unsigned int slot = hash_key(old_table[i]->key) & (agg->table_size - 1);
+            while (agg->table[slot] != NULL) {
+                slot = (slot + 1) & (agg->table_size - 1);
+            }
+            agg->table[slot] = old_table[i];
+        }
+    }
+    agg->rows = rows;
+    agg->memory_used += rows_memory;
+    free(old_table);
+}
+
+/**
+ * @brief Counts one record towards its group, spilling the table if it grows past the memory limit.
+ *
+ * @param agg The group-by.
+ * @param key The group the record belongs to.
+ * @param tie The tie-break text of the group.
+ * @param label The subject written for the group.
+ * @return void: nothing
+ *
+ */
+void spill_add(spill_aggregator *agg, const char *key, const char *tie, const char *label) {
+    unsigned int slot = hash_key(key) & (agg->table_size - 1);
+
+    // Linear probing: stop at the group or at the first empty slot
+    while (agg->table[slot] != NULL) {
+        if (strcmp(agg->table[slot]->key, key) == 0) {
+            agg->table[slot]->count++;
+            return;
+        }
+        slot = (slot + 1) & (agg->table_size - 1);
+    }
+
+    // New group
+    spill_row *row = new_row(key, tie, label, 1);
+    agg->table[slot] = row;
+    agg->rows++;
+    agg->memory_used += row_size(row);
+
+    // Keep the table at most half full
+    if (agg->rows * 2 > agg->table_size) {
+        grow_table(agg);
+    }
+
+    if (agg->memory_used > agg->memory_limit) {
+        spill_table(agg);
+    }
+}
+
+/**
+ * @brief Returns 1 if row a ranks before row b in the output.
+ *
+ */
+static int ranks_before(const spill_aggregator *agg, const spill_row *a, const spill_row *b) {
+    if (a->count != b->count) {
+        return agg->descending ? a->count > b->count : a->count < b->count;
+    }
+    int cmp = strcmp(a->tie, b->tie);
+    if (cmp != 0) {
+        return cmp < 0;
+    }
+    cmp = strcmp(a->key, b->key);
+    return agg->key_descending ? cmp > 0 : cmp < 0;
+}
+
+/**
+ * @brief Inserts a merged row into the top-N selection, or frees it if it does not rank.
+ *
+ */
+static void emit_to_selection(spill_row *row, void *ctx) {
+    spill_selection *sel = (spill_selection *)ctx;
+
+    // Discard rows that rank behind a full selection
+    if (sel->size == sel->n && !ranks_before(sel->agg, row, sel->top[sel->n - 1])) {
+        free(row);
+        return;
+    }
+    if (sel->size == sel->n) {
+        free(sel->top[--sel->size]);
+    }
+
+    // Shift worse rows back to make room
+    int i = sel->size++;
+    while (i > 0 && ranks_before(sel->agg, row, sel->top[i - 1])) {
+        sel->top[i] = sel->top[i - 1];
+        i--;
+    }
+    sel->top[i] = row;
+}
+
+/**
+ * @brief Finishes the group-by and selects the n best groups.
+ *
+ * @param agg The group-by.
+ * @param top Filled with up to n rows, best first; the caller frees each row.
+ * @param n The number of groups wanted.
+ * @return int The number of rows written to top.
+ *
+ */
+int spill_top(spill_aggregator *agg, spill_row **top, int n) {
+    spill_selection sel = { agg, top, n, 0 };
+    spill_sink sink = { emit_to_selection, &sel };
+
+    if (n <= 0) {
+        return 0;
+    }
+
+    if (agg->run_count == 0) {
+        // Everything fit in memory: select straight from the table
+        int rows = sort_table(agg);
+        for (int i = 0; i < rows; i++) {
+            emit_to_selection(agg->table[i], &sel);
+            agg->table[i] = NULL;
+        }
+        agg->rows = 0;
+    } else {
+        // Spill what is left and merge every run
+        if (agg->rows > 0) {
+            spill_table(agg);
+        }
+        merge_runs(agg->runs, agg->run_count, &sink);
+    }
+    return sel.size;
+}
+
+/**
+ * @brief Frees the memory and temporary files held by the group-by.
+ *
+ * @param agg The group-by to free.
+ * @return void: nothing
+ *
+ */
+void spill_free(spill_aggregator *agg) {
+    for (int i = 0; i < agg->table_size; i++) {
+        free(agg->table[i]);
+    }
+    free(agg->table);
+    agg->table = NULL;
+
+    for (int i = 0; i < agg->run_count; i++) {
+        fclose(agg->runs[i]);
+    }
+    agg->run_count = 0;
+}
\ No newline at end of file
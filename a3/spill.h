@@ -0,0 +1,52 @@
+/** @file spill.h
+ *  @brief Memory-bounded group-by that spills sorted runs to temporary files.
+ *
+ */
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define SPILL_FANIN 32          // Maximum number of runs kept open
+#define SPILL_TIER 8            // Runs of one level merged into a single run of the next level
+
+/**
+ * @brief Struct representing one group: its key, its output text and its count.
+ *        The strings live in the same allocation as the struct.
+ */
+typedef struct {
+    int count;
+    char *key;      // The group identity; runs are sorted by key
+    char *tie;      // Orders groups with equal counts before the key does
+    char *label;    // The subject written to output.csv
+    char text[];    // Storage for key, tie and label
+} spill_row;
+
+/**
+ * @brief Struct representing the state of a memory-bounded group-by.
+ */
+typedef struct {
+    size_t memory_limit;        // Bytes the in-memory groups may use before they are spilled
+    size_t memory_used;         // Bytes currently used by the in-memory groups
+    int descending;             // 1 to rank groups by the highest count, 0 by the lowest
+    int key_descending;         // 1 if equal counts and ties rank the larger key first
+    spill_row **table;          // Open-addressing hash table of the in-memory groups
+    int table_size;             // Number of slots in table (a power of two)
+    int rows;                   // Number of groups in table
+    FILE *runs[SPILL_FANIN];    // Sorted runs spilled so far, oldest first
+    int levels[SPILL_FANIN];    // levels[i] is the number of merges behind runs[i]; never rises along runs
+    int run_count;
+} spill_aggregator;
+
+/**
+ * Function protypes associated with the spilling group-by.
+ */
+size_t parse_memory_limit(const char *value);
+
+void spill_init(spill_aggregator *agg, size_t memory_limit, int descending, int key_descending);
+void spill_add(spill_aggregator *agg, const char *key, const char *tie, const char *label);
+int spill_top(spill_aggregator *agg, spill_row **top, int n);
+void spill_free(spill_aggregator *agg);
+
+#endif // SPILL_H
\ No newline at end of file
@@ -0,0 +1,333 @@
+/** @file stream.c
+ *  @brief Implementation of stream.h
+ *
+ *  The window is kept as a ring of interval counts in every group: a route
+ *  is counted in the current interval, and stream_advance moves to the next
+ *  one, taking the counts it held off the group totals. Snapshots rank the
+ *  groups the same way the q1-q3 count lists are written.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include "stream.h"
+#include "emalloc.h"
+
+#define STREAM_MIN_TABLE 64     // Smallest number of slots in the group table
+
+/**
+ * @brief Opens a stream of yaml routes.
+ *
+ * @param reader The reader to open.
+ * @param path "-" for stdin, or the path of a FIFO or file.
+ * @return int 0: No errors; 1: The path could not be opened.
+ *
+ */
+int stream_reader_open(stream_reader *reader, const char *path) {
+    reader->fd = (strcmp(path, "-") == 0) ? STDIN_FILENO : open(path, O_RDONLY);
+    reader->start = 0;
+    reader->end = 0;
+    reader->eof = 0;
+    if (reader->fd < 0) {
+        fprintf(stderr, "Could not open stream %s\n", path);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Reads one line of the stream, waiting at most timeout_ms for it to arrive. Like fgets, a line
+ *        longer than size - 1 bytes is returned in pieces.
+ *
+ * @param reader The reader.
+ * @param line Filled in with the line, including its '\n'.
+ * @param size The size of line.
+ * @param timeout_ms The longest wait for more input in milliseconds, or -1 to wait for as long as it takes.
+ * @return int 1: A line was read; 0: The wait timed out; -1: The stream has ended.
+ *
+ */
+int stream_read_line(stream_reader *reader, char *line, size_t size, int timeout_ms) {
+    for (;;) {
+        // Return a complete line, or what is left at the end of the stream
+        size_t available = reader->end - reader->start;
+        char *newline = memchr(reader->buffer + reader->start, '\n', available);
+        if (newline != NULL || available >= size - 1 || (reader->eof && available > 0)) {
+            size_t length = (newline != NULL) ? (size_t)(newline - (reader->buffer + reader->start)) + 1 : available;
+            if (length > size - 1) {
+                length = size - 1;
+            }
+            memcpy(line, reader->buffer + reader->start, length);
+            line[length] = '\0';
+            reader->start += length;
+            return 1;
+        }
+        if (reader->eof) {
+            return -1;
+        }
+
+        // Move the partial line to the front to make room
+        memmove(reader->buffer, reader->buffer + reader->start, available);
+        reader->start = 0;
+        reader->end = available;
+
+        // Wait for input, then read whatever has arrived
+        if (timeout_ms >= 0) {
+            struct pollfd waiting = { reader->fd, POLLIN, 0 };
+            int ready = poll(&waiting, 1, timeout_ms);
+            if (ready == 0 || (ready < 0 && errno == EINTR)) {
+                return 0;
+            }
+        }
+        ssize_t got = read(reader->fd, reader->buffer + reader->end, STREAM_BUFFER - reader->end);
+        if (got > 0) {
+            reader->end += (size_t)got;
+        } else if (got == 0 || errno != EINTR) {
+            reader->eof = 1;
+        }
+    }
+}
+
+/**
+ * @brief Closes a stream opened by stream_reader_open.
+ *
+ * @param reader The reader.
+ * @return void: nothing
+ *
+ */
+void stream_reader_close(stream_reader *reader) {
+    if (reader->fd > STDIN_FILENO) {
+        close(reader->fd);
+    }
+}
+
+/**
+ * @brief Computes the FNV-1a hash of a string.
+ *
+ */
+static unsigned int hash_key(const char *str) {
+    unsigned int hash = 2166136261u;
+    while (*str != '\0') {
+        hash ^= (unsigned char)*str++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Returns the slot of a key in the group table: its group, or the empty slot where it belongs.
+ *
+ */
+static stream_group **find_slot(stream_counts *counts, const char *key) {
+    size_t slot = hash_key(key) & (counts->table_size - 1);
+    while (counts->table[slot] != NULL && strcmp(counts->table[slot]->key, key) != 0) {
+        slot = (slot + 1) & (counts->table_size - 1);
+    }
+    return &counts->table[slot];
+}
+
+/**
+ * @brief Moves the groups with a count into a table of table_size slots and frees the others.
+ *
+ */
+static void rebuild_table(stream_counts *counts, size_t table_size) {
+    stream_group **old_table = counts->table;
+    size_t old_size = counts->table_size;
+
+    counts->table_size = table_size;
+    counts->table = (stream_group **)emalloc(table_size * sizeof(stream_group *));
+    memset(counts->table, 0, table_size * sizeof(stream_group *));
+    counts->groups = 0;
+
+    for (size_t i = 0; i < old_size; i++) {
+        if (old_table[i] == NULL) {
+            continue;
+        }
+        if (old_table[i]->total > 0) {
+            *find_slot(counts, old_table[i]->key) = old_table[i];
+            counts->groups++;
+        } else {
+            free(old_table[i]);
+        }
+    }
+    free(old_table);
+}
+
+/**
+ * @brief Initializes the group counts of a stream.
+ *
+ * @param counts The counts to initialize.
+ * @param window The number of snapshot intervals a route stays counted, or 0 to keep every route.
+ * @param descending 1 to rank groups by the highest count, 0 by the lowest.
+ * @param key_descending 1 if equal counts and ties rank the larger key first.
+ * @return void: nothing
+ *
+ */
+void stream_init(stream_counts *counts, int window, int descending, int key_descending) {
+    counts->window = (window > 0) ? window : 0;
+    counts->current = 0;
+    counts->descending = descending;
+    counts->key_descending = key_descending;
+    counts->table_size = STREAM_MIN_TABLE;
+    counts->table = (stream_group **)emalloc(STREAM_MIN_TABLE * sizeof(stream_group *));
+    memset(counts->table, 0, STREAM_MIN_TABLE * sizeof(stream_group *));
+    counts->groups = 0;
+}
+
+/**
+ * @brief Counts one route of the stream in its group, in the current interval.
+ *
+ * @param counts The counts.
+ * @param key The group identity.
+ * @param tie Orders groups with equal counts before the key does.
+ * @param label The subject written to the snapshot.
+ * @return void: nothing
+ *
+ */
+void stream_add(stream_counts *counts, const char *key, const char *tie, const char *label) {
+    if (2 * (counts->groups + 1) > counts->table_size) {
+        rebuild_table(counts, counts->table_size * 2);
+    }
+
+    stream_group **slot = find_slot(counts, key);
+    if (*slot == NULL) {
+        // New group: the counts come first, then the three strings
+        int intervals = (counts->window > 0) ? counts->window : 1;
+        size_t key_size = strlen(key) + 1, tie_size = strlen(tie) + 1, label_size = strlen(label) + 1;
+        stream_group *group = (stream_group *)emalloc(sizeof(stream_group) + intervals * sizeof(long)
+                                                      + key_size + tie_size + label_size);
+        memset(group->counts, 0, intervals * sizeof(long));
+        group->total = 0;
+        group->key = (char *)(group->counts + intervals);
+        group->tie = group->key + key_size;
+        group->label = group->tie + tie_size;
+        memcpy(group->key, key, key_size);
+        memcpy(group->tie, tie, tie_size);
+        memcpy(group->label, label, label_size);
+        *slot = group;
+        counts->groups++;
+    }
+    (*slot)->counts[(counts->window > 0) ? counts->current : 0]++;
+    (*slot)->total++;
+}
+
+/**
+ * @brief Ranking order of the groups, set by stream_snapshot for compare_groups.
+ */
+static int rank_descending;
+static int rank_key_descending;
+
+/**
+ * @brief qsort comparator ranking groups by total, then tie, then key.
+ *
+ */
+static int compare_groups(const void *a, const void *b) {
+    const stream_group *x = *(stream_group *const *)a;
+    const stream_group *y = *(stream_group *const *)b;
+
+    if (x->total != y->total) {
+        return ((x->total > y->total) == rank_descending) ? -1 : 1;
+    }
+    int cmp = strcmp(x->tie, y->tie);
+    if (cmp != 0) {
+        return cmp;
+    }
+    cmp = strcmp(x->key, y->key);
+    return rank_key_descending ? -cmp : cmp;
+}
+
+/**
+ * @brief Writes the n best ranked groups as csv lines of "subject,statistic". The snapshot is written to a
+ *        temporary file that then replaces path, so a reader of path never sees half a snapshot.
+ *
+ * @param counts The counts.
+ * @param path The snapshot file, such as "output.csv".
+ * @param n The number of groups to write.
+ * @return int 0: No errors; 1: Errors produced.
+ *
+ */
+int stream_snapshot(stream_counts *counts, const char *path, int n) {
+    char temp_path[4096];
+    size_t live = 0;
+
+    // Gather the groups that still have routes in the window
+    stream_group **ranked = (stream_group **)emalloc((counts->groups + 1) * sizeof(stream_group *));
+    for (size_t i = 0; i < counts->table_size; i++) {
+        if (counts->table[i] != NULL && counts->table[i]->total > 0) {
+            ranked[live++] = counts->table[i];
+        }
+    }
+    rank_descending = counts->descending;
+    rank_key_descending = counts->key_descending;
+    qsort(ranked, live, sizeof(stream_group *), compare_groups);
+
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld.tmp", path, (long)getpid());
+    FILE *file = fopen(temp_path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open file for writing\n");
+        free(ranked);
+        return 1;
+    }
+    fputs("subject,statistic\n", file);
+    for (size_t i = 0; i < live && i < (size_t)n; i++) {
+        fprintf(file, "%s,%ld\n", ranked[i]->label, ranked[i]->total);
+    }
+    free(ranked);
+
+    if (fclose(file) != 0 || rename(temp_path, path) != 0) {
+        fprintf(stderr, "Could not write snapshot %s\n", path);
+        remove(temp_path);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Starts the next interval of the window: the routes counted window intervals ago expire, and groups
+ *        left without routes are dropped. Does nothing without a window.
+ *
+ * @param counts The counts.
+ * @return void: nothing
+ *
+ */
+void stream_advance(stream_counts *counts) {
+    if (counts->window == 0) {
+        return;
+    }
+    counts->current = (counts->current + 1) % counts->window;
+
+    // Expire the oldest interval, which becomes the current one
+    size_t live = 0;
+    for (size_t i = 0; i < counts->table_size; i++) {
+        stream_group *group = counts->table[i];
+        if (group != NULL) {
+            group->total -= group->counts[counts->current];
+            group->counts[counts->current] = 0;
+            live += (group->total > 0);
+        }
+    }
+
+    // Drop the empty groups, shrinking the table to the groups that are left
+    size_t table_size = STREAM_MIN_TABLE;
+    while (table_size < 4 * live) {
+        table_size *= 2;
+    }
+    rebuild_table(counts, table_size);
+}
+
+/**
+ * @brief Frees the groups of a stream.
+ *
+ * @param counts The counts.
+ * @return void: nothing
+ *
+ */
+void stream_free(stream_counts *counts) {
+    for (size_t i = 0; i < counts->table_size; i++) {
+        free(counts->table[i]);
+    }
+    free(counts->table);
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+/** @file stream.h
+ *  @brief Incremental group counts over an endless stream of routes, with an optional sliding window.
+ *
+ */
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stddef.h>
+
+#define STREAM_BUFFER (64 * 1024)   // Bytes read from the stream at a time
+
+/**
+ * @brief Struct representing a line reader over stdin or a FIFO that can wait for input with a timeout.
+ */
+typedef struct {
+    int fd;
+    char buffer[STREAM_BUFFER];
+    size_t start;           // First unread byte of buffer
+    size_t end;             // One past the last byte read into buffer
+    int eof;
+} stream_reader;
+
+/**
+ * @brief Struct representing one group: its count in every interval of the window.
+ *        The strings live in the same allocation as the struct, after the counts.
+ */
+typedef struct {
+    long total;         // Sum of the interval counts
+    char *key;          // The group identity
+    char *tie;          // Orders groups with equal counts before the key does
+    char *label;        // The subject written to the snapshot
+    long counts[];      // One count per interval of the window, the current one at stream_counts.current
+} stream_group;
+
+/**
+ * @brief Struct representing the group counts of a stream. With a window of W intervals a route is counted
+ *        until W snapshots have been taken after it, and groups are dropped once their count falls to 0, so
+ *        memory is bounded by the number of groups seen in the window.
+ */
+typedef struct {
+    int window;                 // Intervals a route stays counted, or 0 to keep every route
+    int current;                // Interval that new routes are counted in
+    int descending;             // 1 to rank groups by the highest count, 0 by the lowest
+    int key_descending;         // 1 if equal counts and ties rank the larger key first
+    stream_group **table;       // Open-addressing hash table of the groups
+    size_t table_size;          // Number of slots in table (a power of two)
+    size_t groups;              // Number of groups in table
+} stream_counts;
+
+/**
+ * Function protypes associated with streaming.
+ */
+int stream_reader_open(stream_reader *reader, const char *path);
+int stream_read_line(stream_reader *reader, char *line, size_t size, int timeout_ms);
+void stream_reader_close(stream_reader *reader);
+
+void stream_init(stream_counts *counts, int window, int descending, int key_descending);
+void stream_add(stream_counts *counts, const char *key, const char *tie, const char *label);
+int stream_snapshot(stream_counts *counts, const char *path, int n);
+void stream_advance(stream_counts *counts);
+void stream_free(stream_counts *counts);
+
+#endif // STREAM_H
\ No newline at end of file
@@ -0,0 +1,398 @@
+/** @file thread_pool.c
+ *  @brief Implementation of thread_pool.h
+ *
+ *  Each worker owns a deque. Tasks submitted from a worker go onto its own
+ *  deque and are popped newest first, which keeps a task's children on the
+ *  core that produced their data. Idle workers steal the oldest task from
+ *  the other deques. A thread waiting on a task group runs queued tasks
+ *  itself instead of blocking, so tasks can wait on tasks they submitted.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "thread_pool.h"
+#include "emalloc.h"
+
+#define DEQUE_INITIAL_CAPACITY 64
+
+static __thread thread_pool *current_pool = NULL;  // Pool of the calling worker thread
+static __thread int current_worker = -1;            // Index of the calling worker thread
+
+/**
+ * @brief Returns the current monotonic time in seconds.
+ *
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Returns the number of online processors, used when no thread count is given.
+ *
+ * @return int The number of processors, at least 1.
+ *
+ */
+int default_thread_count(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+/**
+ * @brief Appends a task at the tail of a deque, growing it when full.
+ *
+ */
+static void deque_push(worker_deque *deque, task t) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->size == deque->capacity) {
+        // Unroll the ring into a buffer twice as large
+        task *tasks = (task *)emalloc(2 * deque->capacity * sizeof(task));
+        for (int i = 0; i < deque->size; i++) {
+            tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->head = 0;
+        deque->capacity *= 2;
+    }
+    deque->tasks[(deque->head + deque->size) % deque->capacity] = t;
+    deque->size++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+/**
+ * @brief Takes a task from a deque: the newest one for the owner, the oldest one for a thief.
+ *
+ * @return int 1 if a task was taken, 0 if the deque was empty.
+ *
+ */
+static int deque_take(worker_deque *deque, int from_tail, task *t) {
+    int taken = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->size > 0) {
+        if (from_tail) {
+            *t = deque->tasks[(deque->head + deque->size - 1) % deque->capacity];
+        } else {
+            *t = deque->tasks[deque->head];
+            deque->head = (deque->head + 1) % deque->capacity;
+        }
+        deque->size--;
+        taken = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return taken;
+}
+
+/**
+ * @brief Finds a task for the given worker (or for a thread outside the pool when self is -1):
+ *        its own deque first, then the other deques in turn.
+ *
+ * @return int 1 if a task was found, 0 otherwise.
+ *
+ */
+static int find_task(thread_pool *pool, int self, task *t) {
+    if (self >= 0 && deque_take(&pool->deques[self], 1, t)) {
+        goto found;
+    }
+    for (int i = 1; i <= pool->thread_count; i++) {
+        int victim = (self + i + pool->thread_count) % pool->thread_count;
+        if (victim != self && deque_take(&pool->deques[victim], 0, t)) {
+            if (self >= 0) {
+                pool->deques[self].steals++;
+            }
+            goto found;
+        }
+    }
+    return 0;
+
+found:
+    pthread_mutex_lock(&pool->lock);
+    pool->pending--;
+    pthread_mutex_unlock(&pool->lock);
+    return 1;
+}
+
+/**
+ * @brief Runs a task and signals its group when the group has no tasks left.
+ *
+ */
+static void run_task(thread_pool *pool, int self, task *t) {
+    double start = now_seconds();
+    t->fn(t->arg);
+    if (self >= 0) {
+        pool->deques[self].busy_seconds += now_seconds() - start;
+        pool->deques[self].tasks_run++;
+    } else {
+        // Any number of threads outside the pool may be waiting, so they share one locked row
+        pthread_mutex_lock(&pool->lock);
+        pool->caller_busy_seconds += now_seconds() - start;
+        pool->caller_tasks_run++;
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    if (t->group != NULL) {
+        pthread_mutex_lock(&t->group->lock);
+        if (--t->group->remaining == 0) {
+            pthread_cond_broadcast(&t->group->done);
+        }
+        pthread_mutex_unlock(&t->group->lock);
+    }
+}
+
+/**
+ * @brief The loop run by every worker thread until the pool shuts down.
+ *
+ */
+static void *worker_main(void *arg) {
+    thread_pool *pool = ((void **)arg)[0];
+    int self = (int)(long)((void **)arg)[1];
+    free(arg);
+
+    current_pool = pool;
+    current_worker = self;
+
+    for (;;) {
+        task t;
+        if (find_task(pool, self, &t)) {
+            run_task(pool, self, &t);
+            continue;
+        }
+
+        // Sleep until a task is queued somewhere
+        pthread_mutex_lock(&pool->lock);
+        while (pool->pending == 0 && !pool->shutdown) {
+            pthread_cond_wait(&pool->work_available, &pool->lock);
+        }
+        int done = pool->shutdown && pool->pending == 0;
+        pthread_mutex_unlock(&pool->lock);
+        if (done) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Creates a pool and starts its workers.
+ *
+ * @param thread_count The number of workers; values below 1 use default_thread_count().
+ * @return thread_pool* The new pool.
+ *
+ */
+thread_pool *thread_pool_create(int thread_count) {
+    thread_pool *pool = (thread_pool *)emalloc(sizeof(thread_pool));
+    if (thread_count < 1) {
+        thread_count = default_thread_count();
+    }
+
+    pool->thread_count = thread_count;
+    pool->threads = (pthread_t *)emalloc(thread_count * sizeof(pthread_t));
+    pool->deques = (worker_deque *)emalloc(thread_count * sizeof(worker_deque));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_available, NULL);
+    pool->pending = 0;
+    pool->shutdown = 0;
+    pool->next_deque = 0;
+    pool->caller_tasks_run = 0;
+    pool->caller_busy_seconds = 0.0;
+    pool->started = now_seconds();
+
+    // Every deque must exist before any worker can try to steal from it
+    for (int i = 0; i < thread_count; i++) {
+        worker_deque *deque = &pool->deques[i];
+        memset(deque, 0, sizeof(worker_deque));
+        pthread_mutex_init(&deque->lock, NULL);
+        deque->tasks = (task *)emalloc(DEQUE_INITIAL_CAPACITY * sizeof(task));
+        deque->capacity = DEQUE_INITIAL_CAPACITY;
+    }
+
+    for (int i = 0; i < thread_count; i++) {
+        void **arg = (void **)emalloc(2 * sizeof(void *));
+        arg[0] = pool;
+        arg[1] = (void *)(long)i;
+        if (pthread_create(&pool->threads[i], NULL, worker_main, arg) != 0) {
+            fprintf(stderr, "Error: could not start worker thread %d\n", i);
+            exit(EXIT_FAILURE);
+        }
+    }
+    return pool;
+}
+
+/**
+ * @brief Runs every queued task, stops the workers and frees the pool.
+ *
+ * @param pool The pool to destroy.
+ * @return void: nothing
+ *
+ */
+void thread_pool_destroy(thread_pool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_available);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].tasks);
+    }
+    pthread_cond_destroy(&pool->work_available);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->deques);
+    free(pool->threads);
+    free(pool);
+}
+
+/**
+ * @brief Initializes an empty task group.
+ *
+ * @param group The group to initialize.
+ * @return void: nothing
+ *
+ */
+void task_group_init(task_group *group) {
+    pthread_mutex_init(&group->lock, NULL);
+    pthread_cond_init(&group->done, NULL);
+    group->remaining = 0;
+}
+
+/**
+ * @brief Releases the resources of a task group that has no tasks left.
+ *
+ * @param group The group to destroy.
+ * @return void: nothing
+ *
+ */
+void task_group_destroy(task_group *group) {
+    pthread_cond_destroy(&group->done);
+    pthread_mutex_destroy(&group->lock);
+}
+
+/**
+ * @brief Queues a task. From a worker it goes onto that worker's deque, otherwise the deques take turns.
+ *
+ * @param pool The pool to run the task on.
+ * @param group The group the task belongs to, or NULL.
+ * @param fn The function to run.
+ * @param arg The argument passed to fn.
+ * @return void: nothing
+ *
+ */
+void thread_pool_submit(thread_pool *pool, task_group *group, task_fn fn, void *arg) {
+    task t = { fn, arg, group };
+    int target;
+
+    if (group != NULL) {
+        pthread_mutex_lock(&group->lock);
+        group->remaining++;
+        pthread_mutex_unlock(&group->lock);
+    }
+
+    // Pick the deque, then publish the task
+    pthread_mutex_lock(&pool->lock);
+    if (current_pool == pool) {
+        target = current_worker;
+    } else {
+        target = pool->next_deque;
+        pool->next_deque = (pool->next_deque + 1) % pool->thread_count;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    deque_push(&pool->deques[target], t);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->pending++;
+    pthread_cond_signal(&pool->work_available);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief Queues one task per element of an array of arguments.
+ *
+ * @param pool The pool to run the tasks on.
+ * @param group The group the tasks belong to, or NULL.
+ * @param fn The function to run for every element.
+ * @param args The first element.
+ * @param count The number of elements.
+ * @param stride The size of one element in bytes.
+ * @return void: nothing
+ *
+ */
+void thread_pool_submit_batch(thread_pool *pool, task_group *group, task_fn fn, void *args, int count, size_t stride) {
+    for (int i = 0; i < count; i++) {
+        thread_pool_submit(pool, group, fn, (char *)args + i * stride);
+    }
+}
+
+/**
+ * @brief Waits until every task of the group has finished, running queued tasks in the meantime.
+ *
+ * @param pool The pool the tasks were submitted to.
+ * @param group The group to wait for.
+ * @return void: nothing
+ *
+ */
+void thread_pool_wait(thread_pool *pool, task_group *group) {
+    int self = (current_pool == pool) ? current_worker : -1;
+
+    for (;;) {
+        pthread_mutex_lock(&group->lock);
+        int remaining = group->remaining;
+        pthread_mutex_unlock(&group->lock);
+        if (remaining == 0) {
+            return;
+        }
+
+        // Help with queued work rather than blocking a thread
+        task t;
+        if (find_task(pool, self, &t)) {
+            run_task(pool, self, &t);
+            continue;
+        }
+
+        // Nothing queued: the group's last tasks are running elsewhere. The timeout picks up
+        // tasks those may still submit.
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        pthread_mutex_lock(&group->lock);
+        if (group->remaining > 0) {
+            pthread_cond_timedwait(&group->done, &group->lock, &deadline);
+        }
+        pthread_mutex_unlock(&group->lock);
+    }
+}
+
+/**
+ * @brief Prints how many tasks each worker ran and stole and how busy it was since the pool was created, then
+ *        the same for the tasks that threads outside the pool ran while waiting on a group.
+ *
+ * @param pool The pool to report on.
+ * @param out The stream to print to.
+ * @return void: nothing
+ *
+ */
+void thread_pool_report(thread_pool *pool, FILE *out) {
+    double elapsed = now_seconds() - pool->started;
+    if (elapsed <= 0.0) {
+        elapsed = 1e-9;
+    }
+
+    for (int i = 0; i < pool->thread_count; i++) {
+        worker_deque *deque = &pool->deques[i];
+        fprintf(out, "worker %d: %ld tasks, %ld stolen, %.3f s busy (%.1f%%)\n", i, deque->tasks_run, deque->steals,
+                deque->busy_seconds, 100.0 * deque->busy_seconds / elapsed);
+    }
+    fprintf(out, "caller: %ld tasks, %.3f s busy (%.1f%%)\n", pool->caller_tasks_run, pool->caller_busy_seconds,
+            100.0 * pool->caller_busy_seconds / elapsed);
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+/** @file thread_pool.h
+ *  @brief A work-stealing task pool shared by the parse, aggregate and output stages.
+ *
+ */
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+/**
+ * @brief Function run by a task.
+ */
+typedef void (*task_fn)(void *arg);
+
+/**
+ * @brief Struct representing a set of tasks that can be waited on together.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    int remaining;          // Tasks submitted to the group that have not finished
+} task_group;
+
+/**
+ * @brief Struct representing one queued task.
+ */
+typedef struct {
+    task_fn fn;
+    void *arg;
+    task_group *group;
+} task;
+
+/**
+ * @brief Struct representing the deque and statistics of one worker.
+ *        The owner pushes and pops at the tail; thieves take from the head.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    task *tasks;            // Ring buffer of queued tasks
+    int capacity;
+    int head;               // Index of the oldest task
+    int size;               // Number of queued tasks
+    long tasks_run;         // Tasks this worker has run
+    long steals;            // Tasks this worker took from another worker's deque
+    double busy_seconds;    // Time spent inside tasks
+} worker_deque;
+
+/**
+ * @brief Struct representing the pool.
+ */
+typedef struct {
+    int thread_count;
+    pthread_t *threads;
+    worker_deque *deques;       // One deque per worker
+    pthread_mutex_t lock;       // Guards pending, shutdown and next_deque
+    pthread_cond_t work_available;
+    int pending;                // Tasks queued on any deque
+    int shutdown;
+    int next_deque;             // Deque that receives the next task submitted from outside the pool
+    long caller_tasks_run;      // Tasks run by threads outside the pool while they waited, guarded by lock
+    double caller_busy_seconds; // Time those threads spent inside tasks, guarded by lock
+    double started;             // Time the pool was created
+} thread_pool;
+
+/**
+ * Function protypes associated with the thread pool.
+ */
+int default_thread_count(void);
+
+thread_pool *thread_pool_create(int thread_count);
+void thread_pool_destroy(thread_pool *pool);
+
+void task_group_init(task_group *group);
+void task_group_destroy(task_group *group);
+
+void thread_pool_submit(thread_pool *pool, task_group *group, task_fn fn, void *arg);
+void thread_pool_submit_batch(thread_pool *pool, task_group *group, task_fn fn, void *args, int count, size_t stride);
+void thread_pool_wait(thread_pool *pool, task_group *group);
+
+void thread_pool_report(thread_pool *pool, FILE *out);
+
+#endif // THREAD_POOL_H
\ No newline at end of file
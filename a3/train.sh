@@ -0,0 +1,90 @@
+#!/bin/sh
+# @file train.sh
+# @brief Training workload for the optimized builds: generates synthetic route yaml and runs the
+#        common questions and backends over it.
+#
+# Usage: ./train.sh BINARY [BASELINE]
+#   With one binary the workload is only run, such as to collect a PGO profile.
+#   With a baseline too, both are timed and their runtimes are printed. The workload is short, so
+#   the runtimes vary from run to run by about as much as the builds differ; compare several runs.
+#
+# ROUTES sets the number of generated routes (default 10000). FLAGS are added to every run of BINARY and
+# BASELINE_FLAGS to every run of BASELINE, so one binary can be compared with itself, such as
+#   FLAGS="--HUGEPAGES --NUMA=interleave" ./train.sh ./route_manager_release ./route_manager_release
+
+set -e
+
+ROUTES=${ROUTES:-10000}
+
+# Resolve the binaries before leaving the build directory
+binary=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+baseline=
+if [ -n "$2" ]; then
+    baseline=$(cd "$(dirname "$2")" && pwd)/$(basename "$2")
+fi
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# Generate routes over a fixed set of airlines and airports. The destinations are skewed like real
+# traffic, so a few airports and countries dominate the counts.
+awk -v routes="$ROUTES" 'BEGIN {
+    srand(42);
+    split("Canada China Sweden Poland Greece Ireland Hungary Brazil Chile Peru Japan Kenya Fiji", countries, " ");
+    split("Air Canada|WestJet|Ryanair|Sichuan Airlines|Wizz Air|Porter Airlines|Delta Air Lines|LATAM|Air China|Flair", names, "|");
+    split("ACA WJA RYR CSC WZZ POE DAL LAN CCA FLE", codes, " ");
+    split("Canada Canada Ireland China Hungary Canada United_States Chile China Canada", homes, " ");
+    for (i = 0; i < 400; i++) {
+        country[i] = countries[int(rand() * 13) + 1];
+        altitude[i] = (i % 37) ? sprintf("%.1f", rand() * 4000 - 50) : "abc";
+    }
+    print "routes:";
+    for (r = 0; r < routes; r++) {
+        a = int(rand() * 10) + 1;
+        f = int(rand() * 400);
+        t = int(-40 * log(1 - rand())) % 400;
+        home = homes[a];
+        gsub("_", " ", home);
+        printf "- airline_name: %s\n  airline_icao_unique_code: %s\n  airline_country: %s\n", names[a], codes[a], home;
+        printf "  from_airport_name: Airport %03d\n  from_airport_city: City %d\n  from_airport_country: %s\n", f, f % 97, country[f];
+        printf "  from_airport_icao_unique_code: A%03d\n  from_airport_altitude: '\''%s'\''\n", f, altitude[f];
+        printf "  to_airport_name: Airport %03d\n  to_airport_city: City %d\n  to_airport_country: %s\n", t, t % 97, country[t];
+        printf "  to_airport_icao_unique_code: A%03d\n  to_airport_altitude: '\''%s'\''\n", t, altitude[t];
+    }
+}' > "$work/routes.yaml"
+
+# Run every question with the default backend, then the hash, spill, pivot, filtered and export paths.
+# The flags are left unquoted so they split into separate arguments.
+workload() {
+    cd "$work"
+    for question in 1 2 3 4; do
+        "$1" $2 --DATA=routes.yaml --QUESTION=$question --N=10
+    done
+    "$1" $2 --DATA=routes.yaml --QUESTION=2 --N=10 --BACKEND=hash
+    "$1" $2 --DATA=routes.yaml --QUESTION=3 --N=10 --MEMORY_LIMIT=4M
+    "$1" $2 --DATA=routes.yaml --PIVOT=airline_name,to_airport_country --N=10
+    "$1" $2 --DATA=routes.yaml --QUESTION=2 --N=10 --WHERE=airline_country=Canada --DEDUP 2>/dev/null
+    "$1" $2 --DATA=routes.yaml --PIVOT=from_airport_icao_unique_code,to_airport_icao_unique_code --EXPORT=pairs.bin --EXPORT_FORMAT=binary
+    cd - > /dev/null
+}
+
+# Prints the seconds the workload takes with a binary and its flags
+timed() {
+    start=$(date +%s.%N)
+    workload "$1" "$2"
+    end=$(date +%s.%N)
+    echo "$start $end" | awk '{ printf "%.3f", $2 - $1 }'
+}
+
+if [ -z "$baseline" ]; then
+    workload "$binary" "$FLAGS"
+    exit 0
+fi
+
+base_seconds=$(timed "$baseline" "$BASELINE_FLAGS")
+seconds=$(timed "$binary" "$FLAGS")
+echo "$base_seconds $seconds" | awk -v base="$(basename "$baseline") $BASELINE_FLAGS" -v new="$(basename "$binary") $FLAGS" -v routes="$ROUTES" '{
+    printf "Training workload over %d routes\n", routes;
+    printf "  %-48s %8.3f s\n", base, $1;
+    printf "  %-48s %8.3f s\n", new, $2;
+}'